@@ -23,16 +23,91 @@
 
 /* This class is a singleton that caches textures that may be loaded multiple
  * times - for instance theme textures.
+ *
+ * Textures are indexed by their full path.  Every actor we hand out that
+ * shows a cached texture (clone or sub-texture) counts as a user of it.
+ * When a texture loses its last user it is put on an LRU list, and the
+ * least recently used ones are dropped while the cache takes up more
+ * than its memory budget.  Textures in use are never dropped.
+ *
+ * Unless disabled in transitions.ini the pixels are decoded in a worker
+ * thread by ClutterTexture.  The size of the image is known right away,
+ * so the texture can be handed out immediately; it is transparent until
+ * the pixels arrive.  A reload after a theme change keeps showing the old
+ * pixels until the new ones are uploaded on the main loop.
+ *
+ * The small theme images the title bar, home and the switcher use all
+ * the time are packed into a few atlas textures when the theme is
+ * loaded, so drawing them doesn't need a texture switch for each.
+ * Images in the atlas are handed out as TidySubTexture:s of an atlas
+ * page; their users are moved to the new pages when the theme changes.
+ * Except when the cache is created the images of the atlas are decoded
+ * in a thread too, and the old pages are shown until they are ready.
  */
 
+#include <string.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
 #include "tidy/tidy-sub-texture.h"
 
 #include "hd-clutter-cache.h"
 #include "hd-render-manager.h"
+#include "hd-transition.h"
+#include "hd-theme.h"
+#include "hildon-desktop.h"
+
+/* Default for [clutter_cache] budget_kb in transitions.ini. */
+#define HD_CLUTTER_CACHE_DEFAULT_BUDGET_KB 4096
+
+/* Default for [clutter_cache] atlas_max_size: images larger than this
+ * in either direction are not put in the atlas. */
+#define HD_CLUTTER_CACHE_DEFAULT_ATLAS_MAX  128
+/* Width and maximal height of an atlas page. */
+#define HD_CLUTTER_CACHE_ATLAS_SIZE         512
+
+typedef struct
+{
+  gchar        *path;
+  /* The texture the image is in, either its own or an atlas page. */
+  ClutterActor *texture;
+  /* Where the image is in @texture. */
+  ClutterGeometry rect;
+  /* @texture is an atlas page.  These entries are never evicted. */
+  gboolean      in_atlas;
+  /* Number of actors showing @texture. */
+  guint         users;
+  /* The TidySubTexture:s among them, to move when the atlas is rebuilt. */
+  GSList       *subs;
+  gsize         bytes;
+  /* Our link in HdClutterCachePrivate::lru if @users is 0. */
+  GList        *lru_link;
+} HdClutterCacheEntry;
 
 struct _HdClutterCachePrivate
 {
+  /* path -> HdClutterCacheEntry */
+  GHashTable   *entries;
+  /* Unused HdClutterCacheEntry:s, least recently used first. */
+  GQueue        lru;
+
+  /* Unused textures are dropped while we take more memory than this. */
+  gsize         budget;
+  gsize         bytes_resident;
+  gsize         bytes_unused;
 
+  /* Load the textures in a thread. */
+  gboolean      async;
+  guint         loads_pending;
+  /* The decoding of the new atlas images, if it's in progress. */
+  struct _HdClutterCacheAtlasLoad *atlas_load;
+
+  /* ClutterTexture:s the small images are packed into. */
+  GPtrArray    *atlas;
+  gint          atlas_max;
+  guint         atlas_images;
+  gsize         atlas_bytes;
+
+  guint         hits, misses, evictions;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -49,14 +124,129 @@ static HdClutterCache *the_clutter_cache = 0;
 #define HD_CLUTTER_CACHE_THEME_PATH "/etc/hildon/theme/images/"
 #define HD_CLUTTER_CACHE_FALLBACK_THEME_PATH "/usr/share/themes/default/images/"
 
+/* Theme images which go to the atlas if they are small enough.
+ * Not HD_THEME_IMG_PROGRESS, hd-transition.c animates its region. */
+static const char *const hd_clutter_cache_atlas_images[] =
+{
+  HD_THEME_IMG_TASK_LAUNCHER,
+  HD_THEME_IMG_TASK_LAUNCHER_PRESSED,
+  HD_THEME_IMG_TASK_SWITCHER,
+  HD_THEME_IMG_TASK_SWITCHER_PRESSED,
+  HD_THEME_IMG_TASK_SWITCHER_HIGHLIGHT,
+  HD_THEME_IMG_LEFT_ATTACHED,
+  HD_THEME_IMG_LEFT_END,
+  HD_THEME_IMG_LEFT_PRESSED,
+  HD_THEME_IMG_LEFT_ATTACHED_PRESSED,
+  HD_THEME_IMG_RIGHT_END,
+  HD_THEME_IMG_RIGHT_PRESSED,
+  HD_THEME_IMG_BACK,
+  HD_THEME_IMG_BACK_PRESSED,
+  HD_THEME_IMG_CLOSE,
+  HD_THEME_IMG_CLOSE_PRESSED,
+  HD_THEME_IMG_SEPARATOR,
+  HD_THEME_IMG_MENU_INDICATOR,
+  HD_THEME_IMG_CLOSING_PARTICLE,
+  HD_THEME_IMG_EDIT_ICON,
+  HD_THEME_IMG_BUTTON_LEFT_HALF,
+  HD_THEME_IMG_BUTTON_RIGHT_HALF,
+  "AppletCloseButton.png",
+  "AppletConfigureButton.png",
+  "TaskSwitcherThumbnailTitleLeft.png",
+  "TaskSwitcherThumbnailTitleCenter.png",
+  "TaskSwitcherThumbnailTitleRight.png",
+  "TaskSwitcherThumbnailBorderLeft.png",
+  "TaskSwitcherThumbnailBorderRight.png",
+  "TaskSwitcherThumbnailBottomLeft.png",
+  "TaskSwitcherThumbnailBottomCenter.png",
+  "TaskSwitcherThumbnailBottomRight.png",
+  "TaskSwitcherThumbnailTitleCloseIcon.png",
+  "TaskSwitcherNotificationThumbnailCloseIcon.png",
+  "TaskSwitcherNotificationThumbnailSeparator.png",
+  NULL
+};
+
+/* An image being packed by hd_clutter_cache_build_atlas(). */
+typedef struct
+{
+  gchar           *path;
+  GdkPixbuf       *pixbuf;
+  guint            page;
+  ClutterGeometry  rect;
+} HdClutterCacheAtlasImage;
+
+/* The images of the atlas being decoded for hd_clutter_cache_build_atlas(),
+ * in a thread if the cache is async. */
+typedef struct _HdClutterCacheAtlasLoad
+{
+  HdClutterCache    *cache;
+  /* Where to look for the images first.  The thread doesn't ask
+   * mb_wm_theme_is_broken() itself. */
+  gchar             *theme_path;
+  /* HdClutterCacheAtlasImage:s, with only the path and pixbuf set. */
+  GSList            *images;
+  /* The theme changed again meanwhile, drop the result. */
+  volatile gboolean  cancelled;
+} HdClutterCacheAtlasLoad;
+
 /* ------------------------------------------------------------------------- */
 
+static void hd_clutter_cache_build_atlas (HdClutterCache *cache,
+                                          gboolean async);
+
+static void
+hd_clutter_cache_entry_free (HdClutterCacheEntry *entry)
+{
+  g_slist_free (entry->subs);
+  g_free (entry->path);
+  g_free (entry);
+}
+
+static gsize
+hd_clutter_cache_texture_bytes (ClutterActor *texture)
+{
+  gint w, h;
+
+  clutter_texture_get_base_size (CLUTTER_TEXTURE (texture), &w, &h);
+  return (gsize)w * h * 4;
+}
+
+/* Make @texture the own texture of @entry, showing all of it. */
+static void
+hd_clutter_cache_entry_set_texture (HdClutterCacheEntry *entry,
+                                    ClutterActor *texture)
+{
+  gint w, h;
+
+  clutter_texture_get_base_size (CLUTTER_TEXTURE (texture), &w, &h);
+  entry->texture = texture;
+  entry->in_atlas = FALSE;
+  entry->rect.x = entry->rect.y = 0;
+  entry->rect.width = w;
+  entry->rect.height = h;
+}
+
 static void
 hd_clutter_cache_init (HdClutterCache *cache)
 {
   ClutterActor *stage;
- /* HdClutterCachePrivate *priv = cache->priv =
-    HD_CLUTTER_CACHE_GET_PRIVATE(cache);*/
+  HdClutterCachePrivate *priv = cache->priv =
+    HD_CLUTTER_CACHE_GET_PRIVATE(cache);
+
+  priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                            (GDestroyNotify)hd_clutter_cache_entry_free);
+  g_queue_init (&priv->lru);
+  priv->budget = hd_transition_get_int ("clutter_cache", "budget_kb",
+                                        HD_CLUTTER_CACHE_DEFAULT_BUDGET_KB)
+                 * 1024;
+  priv->async = hd_transition_get_int ("clutter_cache", "async", 1)
+    && !hd_disable_threads ();
+
+  priv->atlas = g_ptr_array_new ();
+  /* Leave room for the 1-pixel border around the images. */
+  priv->atlas_max = hd_transition_get_int ("clutter_cache", "atlas_max_size",
+                                           HD_CLUTTER_CACHE_DEFAULT_ATLAS_MAX);
+  priv->atlas_max = CLAMP (priv->atlas_max, 0,
+                           HD_CLUTTER_CACHE_ATLAS_SIZE - 2);
 
   clutter_actor_hide(CLUTTER_ACTOR(cache));
   clutter_actor_set_name(CLUTTER_ACTOR(cache), "HdClutterCache");
@@ -70,6 +260,25 @@ hd_clutter_cache_init (HdClutterCache *cache)
 static void
 hd_clutter_cache_dispose (GObject *obj)
 {
+  HdClutterCachePrivate *priv = HD_CLUTTER_CACHE (obj)->priv;
+
+  if (priv->atlas_load)
+    {
+      priv->atlas_load->cancelled = TRUE;
+      priv->atlas_load = NULL;
+    }
+  if (priv->entries)
+    {
+      g_queue_clear (&priv->lru);
+      g_hash_table_destroy (priv->entries);
+      priv->entries = NULL;
+    }
+  if (priv->atlas)
+    {
+      g_ptr_array_free (priv->atlas, TRUE);
+      priv->atlas = NULL;
+    }
+
   G_OBJECT_CLASS (hd_clutter_cache_parent_class)->dispose (obj);
 }
 
@@ -78,23 +287,650 @@ hd_clutter_cache_class_init (HdClutterCacheClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
+  g_type_class_add_private (klass, sizeof (HdClutterCachePrivate));
+
   gobject_class->dispose = hd_clutter_cache_dispose;
 }
 
 static HdClutterCache *hd_get_clutter_cache()
 {
   if (!the_clutter_cache)
-    the_clutter_cache = HD_CLUTTER_CACHE(g_object_ref (
-        g_object_new (HD_TYPE_CLUTTER_CACHE, NULL)));
+    {
+      the_clutter_cache = HD_CLUTTER_CACHE(g_object_ref (
+          g_object_new (HD_TYPE_CLUTTER_CACHE, NULL)));
+      /* The images are asked for right after this, so they must
+       * be in the atlas already. */
+      hd_clutter_cache_build_atlas (the_clutter_cache, FALSE);
+    }
   return the_clutter_cache;
 }
 
+/* Drop the least recently used unused textures until the cache fits
+ * into @budget or there are no unused textures left. */
+static void
+hd_clutter_cache_evict (HdClutterCachePrivate *priv, gsize budget)
+{
+  HdClutterCacheEntry *entry;
+
+  while (priv->bytes_resident > budget
+         && (entry = g_queue_pop_head (&priv->lru)) != NULL)
+    {
+      priv->bytes_unused   -= entry->bytes;
+      priv->bytes_resident -= entry->bytes;
+      priv->evictions++;
+
+      g_object_set_data (G_OBJECT (entry->texture),
+                         "HD-ClutterCacheEntry", NULL);
+      /* It won't finish loading now. */
+      if (g_object_get_data (G_OBJECT (entry->texture),
+                             "HD-ClutterCacheLoading"))
+        priv->loads_pending--;
+      clutter_actor_destroy (entry->texture);
+      g_hash_table_remove (priv->entries, entry->path);
+    }
+}
+
+/* Weak reference notification of the actors using a cached texture. */
+static void
+hd_clutter_cache_user_gone (HdClutterCacheEntry *entry, GObject *user)
+{
+  HdClutterCachePrivate *priv;
+
+  if (!the_clutter_cache || !(priv = the_clutter_cache->priv)->entries)
+    return;
+
+  entry->subs = g_slist_remove (entry->subs, user);
+
+  g_assert (entry->users > 0);
+  if (--entry->users > 0 || entry->in_atlas)
+    return;
+
+  g_queue_push_tail (&priv->lru, entry);
+  entry->lru_link = priv->lru.tail;
+  priv->bytes_unused += entry->bytes;
+  hd_clutter_cache_evict (priv, priv->budget);
+}
+
+/* Make @user count as a user of @entry, until it's destroyed.
+ * If @user is a TidySubTexture of an atlas page @region is the part
+ * of the image it shows. */
+static void
+hd_clutter_cache_add_user (HdClutterCacheEntry *entry, ClutterActor *user,
+                           const ClutterGeometry *region)
+{
+  HdClutterCachePrivate *priv = the_clutter_cache->priv;
+
+  if (entry->users++ == 0 && entry->lru_link)
+    {
+      g_queue_delete_link (&priv->lru, entry->lru_link);
+      entry->lru_link = NULL;
+      priv->bytes_unused -= entry->bytes;
+    }
+
+  if (region && entry->in_atlas)
+    {
+      g_object_set_data_full (G_OBJECT (user), "HD-ClutterCacheRegion",
+                              g_memdup (region, sizeof (*region)), g_free);
+      entry->subs = g_slist_prepend (entry->subs, user);
+    }
+
+  g_object_set_data (G_OBJECT (user), "HD-ClutterCacheUser", entry);
+  g_object_weak_ref (G_OBJECT (user),
+                     (GWeakNotify)hd_clutter_cache_user_gone, entry);
+}
+
+/* Returns the part of the image of @entry @geo refers to.  Atlas
+ * images are clipped to their bounds, so they don't show the neighbours;
+ * an empty @geo means the whole image. */
+static ClutterGeometry
+hd_clutter_cache_entry_region (const HdClutterCacheEntry *entry,
+                               const ClutterGeometry *geo)
+{
+  ClutterGeometry region;
+
+  if (geo && geo->width && geo->height && !entry->in_atlas)
+    return *geo;
+
+  region.x = region.y = 0;
+  region.width  = entry->rect.width;
+  region.height = entry->rect.height;
+  if (geo && geo->width && geo->height)
+    {
+      gint x2, y2;
+
+      x2 = MIN (geo->x + (gint)geo->width,  (gint)region.width);
+      y2 = MIN (geo->y + (gint)geo->height, (gint)region.height);
+      if (x2 > MAX (geo->x, 0) && y2 > MAX (geo->y, 0))
+        {
+          region.x = MAX (geo->x, 0);
+          region.y = MAX (geo->y, 0);
+          region.width  = x2 - region.x;
+          region.height = y2 - region.y;
+        }
+    }
+
+  return region;
+}
+
+/* Point the atlas users of @entry at its current place. */
+static void
+hd_clutter_cache_move_users (HdClutterCacheEntry *entry)
+{
+  GSList *li;
+
+  for (li = entry->subs; li; li = li->next)
+    {
+      TidySubTexture *sub = li->data;
+      ClutterGeometry region;
+
+      region = hd_clutter_cache_entry_region (entry,
+                      g_object_get_data (G_OBJECT (sub),
+                                         "HD-ClutterCacheRegion"));
+      region.x += entry->rect.x;
+      region.y += entry->rect.y;
+      tidy_sub_texture_set_parent_texture (sub,
+                                           CLUTTER_TEXTURE (entry->texture));
+      tidy_sub_texture_set_region (sub, &region);
+    }
+}
+
+/* Returns a TidySubTexture showing @geo of the image of @entry,
+ * or all of it if @geo is NULL or empty. */
+static ClutterActor *
+hd_clutter_cache_new_sub_texture (HdClutterCacheEntry *entry,
+                                  const ClutterGeometry *geo)
+{
+  TidySubTexture *tex;
+  ClutterGeometry region;
+
+  region = hd_clutter_cache_entry_region (entry, geo);
+  tex = tidy_sub_texture_new (CLUTTER_TEXTURE (entry->texture));
+  hd_clutter_cache_add_user (entry, CLUTTER_ACTOR (tex), &region);
+  region.x += entry->rect.x;
+  region.y += entry->rect.y;
+  tidy_sub_texture_set_region (tex, &region);
+
+  return CLUTTER_ACTOR (tex);
+}
+
+/* Called on the main loop when the pixels of an asynchronously
+ * loaded texture have been uploaded. */
+static void
+hd_clutter_cache_load_finished (ClutterTexture *texture,
+                                const GError   *error,
+                                HdClutterCache *cache)
+{
+  HdClutterCachePrivate *priv = cache->priv;
+  HdClutterCacheEntry *entry;
+
+  if (g_object_get_data (G_OBJECT (texture), "HD-ClutterCacheLoading"))
+    {
+      g_object_set_data (G_OBJECT (texture), "HD-ClutterCacheLoading", NULL);
+      priv->loads_pending--;
+    }
+
+  if (error)
+    g_warning ("%s: couldn't load %s: %s", __FUNCTION__,
+               clutter_actor_get_name (CLUTTER_ACTOR (texture)),
+               error->message);
+
+  /* The size may have changed if it was reloaded for a new theme. */
+  if (!(entry = g_object_get_data (G_OBJECT (texture),
+                                   "HD-ClutterCacheEntry")))
+    return;
+
+  priv->bytes_resident -= entry->bytes;
+  if (entry->lru_link)
+    priv->bytes_unused -= entry->bytes;
+  hd_clutter_cache_entry_set_texture (entry, entry->texture);
+  entry->bytes = hd_clutter_cache_texture_bytes (entry->texture);
+  priv->bytes_resident += entry->bytes;
+  if (entry->lru_link)
+    priv->bytes_unused += entry->bytes;
+}
+
+/* (Re)load @texture from @filename.  Returns FALSE if the file
+ * can't be loaded (as far as we can tell synchronously). */
+static gboolean
+hd_clutter_cache_load (HdClutterCache *cache, ClutterActor *texture,
+                       const char *filename)
+{
+  HdClutterCachePrivate *priv = cache->priv;
+  GError *error = NULL;
+
+  if (!clutter_texture_set_from_file (CLUTTER_TEXTURE (texture),
+                                      filename, &error))
+    {
+      g_error_free (error);
+      return FALSE;
+    }
+
+  /* A load replacing one in progress finishes only once. */
+  if (clutter_texture_get_load_data_async (CLUTTER_TEXTURE (texture))
+      && !g_object_get_data (G_OBJECT (texture), "HD-ClutterCacheLoading"))
+    {
+      g_object_set_data (G_OBJECT (texture), "HD-ClutterCacheLoading",
+                         GINT_TO_POINTER (1));
+      priv->loads_pending++;
+    }
+  return TRUE;
+}
+
+/* Returns a new texture of our own loading @filename_real,
+ * or NULL if it can't be loaded. */
 static ClutterActor *
-hd_clutter_cache_get_real_texture(const char *filename, gboolean from_theme)
+hd_clutter_cache_new_texture (HdClutterCache *cache,
+                              const char *filename_real)
+{
+  ClutterActor *texture;
+
+  texture = clutter_texture_new ();
+  if (cache->priv->async)
+    {
+      /* Only the pixels are loaded in the thread, the size is read
+       * synchronously, so nobody needs to relayout when it's done. */
+      clutter_texture_set_load_data_async (CLUTTER_TEXTURE (texture), TRUE);
+      g_signal_connect (texture, "load-finished",
+                        G_CALLBACK (hd_clutter_cache_load_finished), cache);
+    }
+
+  if (!hd_clutter_cache_load (cache, texture, filename_real))
+    {
+      g_object_unref (g_object_ref_sink (texture));
+      return 0;
+    }
+
+  clutter_actor_set_name(texture, filename_real);
+  clutter_actor_add_child (CLUTTER_ACTOR(cache), texture);
+  return texture;
+}
+
+/* Load @filename_real and add it to the cache. */
+static HdClutterCacheEntry *
+hd_clutter_cache_add_texture (HdClutterCache *cache,
+                              const char *filename_real)
+{
+  HdClutterCachePrivate *priv = cache->priv;
+  HdClutterCacheEntry *entry;
+  ClutterActor *texture;
+
+  if (!(texture = hd_clutter_cache_new_texture (cache, filename_real)))
+    return NULL;
+
+  entry = g_new0 (HdClutterCacheEntry, 1);
+  entry->path = g_strdup (filename_real);
+  hd_clutter_cache_entry_set_texture (entry, texture);
+  entry->bytes = hd_clutter_cache_texture_bytes (texture);
+  g_hash_table_insert (priv->entries, entry->path, entry);
+  g_object_set_data (G_OBJECT (texture), "HD-ClutterCacheEntry", entry);
+  priv->bytes_resident += entry->bytes;
+
+  /* Make room for the new texture if we can. */
+  hd_clutter_cache_evict (priv, priv->budget);
+
+  return entry;
+}
+
+/* Copy @src into @atlas at @x, @y, and repeat its edges around it,
+ * so filtering at the edges doesn't pick up the neighbours. */
+static void
+hd_clutter_cache_atlas_copy (GdkPixbuf *atlas, GdkPixbuf *src,
+                             gint x, gint y)
+{
+  gint w, h;
+
+  w = gdk_pixbuf_get_width (src);
+  h = gdk_pixbuf_get_height (src);
+  gdk_pixbuf_copy_area (src, 0, 0, w, h, atlas, x, y);
+
+  gdk_pixbuf_copy_area (atlas, x,       y, 1, h, atlas, x - 1, y);
+  gdk_pixbuf_copy_area (atlas, x+w - 1, y, 1, h, atlas, x + w, y);
+  gdk_pixbuf_copy_area (atlas, x - 1, y,       w + 2, 1, atlas, x - 1, y - 1);
+  gdk_pixbuf_copy_area (atlas, x - 1, y+h - 1, w + 2, 1, atlas, x - 1, y + h);
+}
+
+static gint
+hd_clutter_cache_atlas_image_cmp (gconstpointer a, gconstpointer b)
+{
+  const HdClutterCacheAtlasImage *ia = a, *ib = b;
+
+  /* Tallest first, so the shelves are filled evenly. */
+  return ib->rect.height - ia->rect.height;
+}
+
+/* Decode the small images of hd_clutter_cache_atlas_images[] into
+ * @load->images.  Runs in a thread, so only gdk-pixbuf is used. */
+static void
+hd_clutter_cache_atlas_load_images (HdClutterCacheAtlasLoad *load)
+{
+  guint i;
+
+  for (i = 0; hd_clutter_cache_atlas_images[i] && !load->cancelled; i++)
+    {
+      HdClutterCacheAtlasImage *image;
+      GdkPixbuf *pixbuf;
+      gchar *path;
+
+      path = g_strconcat (load->theme_path,
+                          hd_clutter_cache_atlas_images[i], NULL);
+      if (!(pixbuf = gdk_pixbuf_new_from_file (path, NULL))
+          && strcmp (load->theme_path, HD_CLUTTER_CACHE_FALLBACK_THEME_PATH))
+        {
+          g_free (path);
+          path = g_strconcat (HD_CLUTTER_CACHE_FALLBACK_THEME_PATH,
+                              hd_clutter_cache_atlas_images[i], NULL);
+          pixbuf = gdk_pixbuf_new_from_file (path, NULL);
+        }
+      if (!pixbuf)
+        {
+          g_free (path);
+          continue;
+        }
+
+      image = g_new0 (HdClutterCacheAtlasImage, 1);
+      image->path = path;
+      image->pixbuf = pixbuf;
+      load->images = g_slist_prepend (load->images, image);
+    }
+}
+
+static gboolean hd_clutter_cache_atlas_loaded (gpointer data);
+
+/* The thread decoding the images of the atlas, which tells the main
+ * loop when it's done. */
+static gpointer
+hd_clutter_cache_atlas_thread (gpointer data)
+{
+  hd_clutter_cache_atlas_load_images (data);
+  g_idle_add (hd_clutter_cache_atlas_loaded, data);
+  return NULL;
+}
+
+static void
+hd_clutter_cache_atlas_image_free (HdClutterCacheAtlasImage *image)
+{
+  if (image->pixbuf)
+    g_object_unref (image->pixbuf);
+  g_free (image->path);
+  g_free (image);
+}
+
+static void
+hd_clutter_cache_atlas_load_free (HdClutterCacheAtlasLoad *load)
+{
+  g_slist_foreach (load->images, (GFunc)hd_clutter_cache_atlas_image_free,
+                   NULL);
+  g_slist_free (load->images);
+  g_free (load->theme_path);
+  g_object_unref (load->cache);
+  g_free (load);
+}
+
+/* Returns the decoded images of @load which go to the atlas, sorted
+ * for packing.  Images which have their own texture already are left
+ * alone. */
+static GSList *
+hd_clutter_cache_atlas_take_images (HdClutterCacheAtlasLoad *load)
+{
+  HdClutterCachePrivate *priv = load->cache->priv;
+  GSList *images = NULL;
+
+  while (load->images)
+    {
+      HdClutterCacheAtlasImage *image = load->images->data;
+      HdClutterCacheEntry *entry;
+
+      load->images = g_slist_delete_link (load->images, load->images);
+      entry = g_hash_table_lookup (priv->entries, image->path);
+      if ((entry && !entry->in_atlas)
+          || gdk_pixbuf_get_width  (image->pixbuf) > priv->atlas_max
+          || gdk_pixbuf_get_height (image->pixbuf) > priv->atlas_max)
+        {
+          hd_clutter_cache_atlas_image_free (image);
+          continue;
+        }
+
+      image->rect.width  = gdk_pixbuf_get_width  (image->pixbuf);
+      image->rect.height = gdk_pixbuf_get_height (image->pixbuf);
+      images = g_slist_prepend (images, image);
+    }
+
+  return g_slist_sort (images, hd_clutter_cache_atlas_image_cmp);
+}
+
+static gboolean
+hd_clutter_cache_is_atlas_page (GPtrArray *pages, ClutterActor *texture)
+{
+  guint i;
+
+  for (i = 0; i < pages->len; i++)
+    if (g_ptr_array_index (pages, i) == texture)
+      return TRUE;
+  return FALSE;
+}
+
+/* Pack the decoded images of @load into atlas pages, replacing the
+ * previous ones. */
+static void
+hd_clutter_cache_pack_atlas (HdClutterCacheAtlasLoad *load)
+{
+  HdClutterCache *cache = load->cache;
+  HdClutterCachePrivate *priv = cache->priv;
+  GSList *images, *li;
+  GPtrArray *pixbufs;
+  GHashTableIter iter;
+  HdClutterCacheEntry *entry;
+  GPtrArray *old_pages;
+  gint x, y, shelf;
+  guint i;
+
+  images = hd_clutter_cache_atlas_take_images (load);
+
+  /* Shelf packing, with a pixel of border around each image. */
+  pixbufs = g_ptr_array_new ();
+  x = y = shelf = 0;
+  for (li = images; li; li = li->next)
+    {
+      HdClutterCacheAtlasImage *image = li->data;
+
+      if (x + image->rect.width + 2 > HD_CLUTTER_CACHE_ATLAS_SIZE)
+        {
+          y += shelf;
+          x = shelf = 0;
+        }
+      if (!pixbufs->len
+          || y + image->rect.height + 2 > HD_CLUTTER_CACHE_ATLAS_SIZE)
+        {
+          if (pixbufs->len)
+            g_ptr_array_index (pixbufs, pixbufs->len-1) =
+              GINT_TO_POINTER (y + shelf);
+          g_ptr_array_add (pixbufs, NULL);
+          x = y = shelf = 0;
+        }
+
+      image->page = pixbufs->len - 1;
+      image->rect.x = x + 1;
+      image->rect.y = y + 1;
+      x += image->rect.width + 2;
+      shelf = MAX (shelf, (gint)image->rect.height + 2);
+    }
+  if (pixbufs->len)
+    g_ptr_array_index (pixbufs, pixbufs->len-1) = GINT_TO_POINTER (y + shelf);
+
+  /* Now that we know how tall they are, paint the pages. */
+  for (i = 0; i < pixbufs->len; i++)
+    {
+      GdkPixbuf *pixbuf;
+
+      pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                   HD_CLUTTER_CACHE_ATLAS_SIZE,
+                   GPOINTER_TO_INT (g_ptr_array_index (pixbufs, i)));
+      gdk_pixbuf_fill (pixbuf, 0);
+      g_ptr_array_index (pixbufs, i) = pixbuf;
+    }
+  for (li = images; li; li = li->next)
+    {
+      HdClutterCacheAtlasImage *image = li->data;
+
+      hd_clutter_cache_atlas_copy (g_ptr_array_index (pixbufs, image->page),
+                                   image->pixbuf,
+                                   image->rect.x, image->rect.y);
+    }
+
+  /* Upload them.  The old pages stay alive while anyone uses them. */
+  old_pages = priv->atlas;
+  priv->atlas = g_ptr_array_new ();
+  priv->atlas_images = 0;
+  priv->atlas_bytes = 0;
+  for (i = 0; i < pixbufs->len; i++)
+    {
+      GdkPixbuf *pixbuf = g_ptr_array_index (pixbufs, i);
+      ClutterActor *page;
+      GError *error = NULL;
+      gchar *name;
+
+      page = clutter_texture_new ();
+      if (!clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (page),
+                                  gdk_pixbuf_get_pixels (pixbuf), TRUE,
+                                  gdk_pixbuf_get_width (pixbuf),
+                                  gdk_pixbuf_get_height (pixbuf),
+                                  gdk_pixbuf_get_rowstride (pixbuf), 4,
+                                  CLUTTER_TEXTURE_NONE, &error))
+        {
+          g_warning ("%s: %s", __FUNCTION__, error->message);
+          g_error_free (error);
+        }
+
+      name = g_strdup_printf ("HdClutterCache atlas %u", i);
+      clutter_actor_set_name (page, name);
+      g_free (name);
+      clutter_actor_add_child (CLUTTER_ACTOR (cache), page);
+      g_ptr_array_add (priv->atlas, page);
+      priv->atlas_bytes += hd_clutter_cache_texture_bytes (page);
+      g_object_unref (pixbuf);
+    }
+  g_ptr_array_free (pixbufs, TRUE);
+
+  /* Point the entries to their new places. */
+  for (li = images; li; li = li->next)
+    {
+      HdClutterCacheAtlasImage *image = li->data;
+
+      if (!(entry = g_hash_table_lookup (priv->entries, image->path)))
+        {
+          entry = g_new0 (HdClutterCacheEntry, 1);
+          entry->path = image->path;
+          image->path = NULL;
+          g_hash_table_insert (priv->entries, entry->path, entry);
+        }
+
+      entry->texture = g_ptr_array_index (priv->atlas, image->page);
+      entry->rect = image->rect;
+      entry->in_atlas = TRUE;
+      hd_clutter_cache_move_users (entry);
+      priv->atlas_images++;
+
+      hd_clutter_cache_atlas_image_free (image);
+    }
+  g_slist_free (images);
+
+  /* Images which were in the atlas but aren't anymore (because they
+   * grew too big) get their own textures if they are used. */
+  g_hash_table_iter_init (&iter, priv->entries);
+  while (old_pages && g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry))
+    {
+      ClutterActor *texture;
+
+      if (!entry->in_atlas
+          || !hd_clutter_cache_is_atlas_page (old_pages, entry->texture))
+        continue;
+
+      if (!entry->users)
+        {
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+      if (!(texture = hd_clutter_cache_new_texture (cache, entry->path)))
+        { /* Keep showing the old one. */
+          g_warning ("%s: couldn't load %s", __FUNCTION__, entry->path);
+          continue;
+        }
+
+      hd_clutter_cache_entry_set_texture (entry, texture);
+      g_object_set_data (G_OBJECT (texture), "HD-ClutterCacheEntry", entry);
+      entry->bytes = hd_clutter_cache_texture_bytes (texture);
+      priv->bytes_resident += entry->bytes;
+      hd_clutter_cache_move_users (entry);
+    }
+
+  if (old_pages)
+    {
+      for (i = 0; i < old_pages->len; i++)
+        clutter_actor_remove_child (CLUTTER_ACTOR (cache),
+                                    g_ptr_array_index (old_pages, i));
+      g_ptr_array_free (old_pages, TRUE);
+    }
+}
+
+/* Called on the main loop when the images of @data are decoded. */
+static gboolean
+hd_clutter_cache_atlas_loaded (gpointer data)
+{
+  HdClutterCacheAtlasLoad *load = data;
+
+  if (!load->cancelled)
+    {
+      load->cache->priv->atlas_load = NULL;
+      hd_clutter_cache_pack_atlas (load);
+    }
+  hd_clutter_cache_atlas_load_free (load);
+
+  return FALSE;
+}
+
+/* Pack the small theme images into atlas pages, replacing the previous
+ * ones.  Called when the cache is created and when the theme changes.
+ * If @async the images are decoded in a thread and the old pages are
+ * shown until that's done. */
+static void
+hd_clutter_cache_build_atlas (HdClutterCache *cache, gboolean async)
+{
+  HdClutterCachePrivate *priv = cache->priv;
+  HdClutterCacheAtlasLoad *load;
+
+  if (priv->atlas_load)
+    {
+      priv->atlas_load->cancelled = TRUE;
+      priv->atlas_load = NULL;
+    }
+
+  load = g_new0 (HdClutterCacheAtlasLoad, 1);
+  load->cache = g_object_ref (cache);
+  load->theme_path = g_strdup (mb_wm_theme_is_broken ()
+                                 ? HD_CLUTTER_CACHE_FALLBACK_THEME_PATH
+                                 : HD_CLUTTER_CACHE_THEME_PATH);
+
+  if (!async || !priv->async || priv->atlas_max <= 0)
+    {
+      if (priv->atlas_max > 0)
+        hd_clutter_cache_atlas_load_images (load);
+      hd_clutter_cache_pack_atlas (load);
+      hd_clutter_cache_atlas_load_free (load);
+      return;
+    }
+
+  priv->atlas_load = load;
+  if (!g_thread_create (hd_clutter_cache_atlas_thread, load, FALSE, NULL))
+    { /* Do it here then. */
+      hd_clutter_cache_atlas_thread (load);
+    }
+}
+
+static HdClutterCacheEntry *
+hd_clutter_cache_get_entry(const char *filename, gboolean from_theme)
 {
   HdClutterCache *cache = hd_get_clutter_cache();
-  gint i;
-  ClutterActor *texture, *actor;
+  HdClutterCacheEntry *entry;
   const char *filename_real = filename;
   char *filename_alloc = 0;
 
@@ -112,32 +948,23 @@ hd_clutter_cache_get_real_texture(const char *filename, gboolean from_theme)
 	      HD_CLUTTER_CACHE_FALLBACK_THEME_PATH :
 	      HD_CLUTTER_CACHE_THEME_PATH;
 
-      filename_alloc = g_malloc(strlen(theme_path) + strlen(filename) + 1);
-      if (!filename_alloc)
-        return 0;
-      strcpy(filename_alloc, theme_path);
-      strcat(filename_alloc, filename);
+      filename_alloc = g_strconcat(theme_path, filename, NULL);
       filename_real = filename_alloc;
     }
 
-  for (i = 0, actor = clutter_group_get_nth_child(CLUTTER_GROUP(cache), 0);
-       actor; actor = clutter_group_get_nth_child(CLUTTER_GROUP(cache), ++i))
+  entry = g_hash_table_lookup (cache->priv->entries, filename_real);
+  if (entry)
     {
-      const char *name = clutter_actor_get_name(actor);
-      if (name && g_str_equal(name, filename_real))
-        {
-          if (filename_alloc)
-	    g_free(filename_alloc);
-          return actor;
-        }
+      cache->priv->hits++;
+      g_free(filename_alloc);
+      return entry;
     }
 
-  texture = clutter_texture_new_from_file(filename_real, 0);
-  if (!texture)
+  cache->priv->misses++;
+  entry = hd_clutter_cache_add_texture(cache, filename_real);
+  g_free(filename_alloc);
+  if (!entry)
     {
-      if (filename_alloc)
-        g_free(filename_alloc);
-
       /*
        * If this was the fallback theme path we can not anything else,
        * othwerwise we still can try to load from the fallback path.
@@ -145,31 +972,15 @@ hd_clutter_cache_get_real_texture(const char *filename, gboolean from_theme)
       if (mb_wm_theme_is_broken())
         return 0;
 
-      filename_alloc = g_malloc (strlen(HD_CLUTTER_CACHE_FALLBACK_THEME_PATH) +
-                                 strlen(filename) + 1);
-      if (!filename_alloc)
-        return 0;
-
-      strcpy(filename_alloc, HD_CLUTTER_CACHE_FALLBACK_THEME_PATH);
-      strcat(filename_alloc, filename);
-      filename_real = filename_alloc;
-
-      texture = clutter_texture_new_from_file(filename_real, 0);
-      if (!texture)
-        {
-          if (filename_alloc)
-            g_free(filename_alloc);
-          return 0;
-        }
+      filename_alloc = g_strconcat(HD_CLUTTER_CACHE_FALLBACK_THEME_PATH,
+                                   filename, NULL);
+      if (!(entry = g_hash_table_lookup (cache->priv->entries,
+                                         filename_alloc)))
+        entry = hd_clutter_cache_add_texture(cache, filename_alloc);
+      g_free(filename_alloc);
     }
 
-  clutter_actor_set_name(texture, filename_real);
-  clutter_actor_add_child (CLUTTER_ACTOR(cache), texture);
-
-  if (filename_alloc)
-    g_free(filename_alloc);
-
-  return texture;
+  return entry;
 }
 
 /* Returns an actor representing a broken texture.
@@ -185,12 +996,22 @@ hd_clutter_cache_get_broken_texture()
 ClutterActor *
 hd_clutter_cache_get_texture(const char *filename, gboolean from_theme)
 {
-  ClutterActor *texture = hd_clutter_cache_get_real_texture(filename,
-                                                            from_theme);
-  if (!texture)
+  HdClutterCacheEntry *entry;
+  ClutterActor *texture;
+
+  entry = hd_clutter_cache_get_entry(filename, from_theme);
+  if (!entry)
     texture = hd_clutter_cache_get_broken_texture();
+  else if (entry->in_atlas)
+    {
+      texture = hd_clutter_cache_new_sub_texture(entry, NULL);
+      clutter_actor_set_size(texture, entry->rect.width, entry->rect.height);
+    }
   else
-    texture = clutter_clone_new(texture);
+    {
+      texture = clutter_clone_new(entry->texture);
+      hd_clutter_cache_add_user(entry, texture, NULL);
+    }
   clutter_actor_set_name(texture, filename);
   return texture;
 }
@@ -200,28 +1021,27 @@ hd_clutter_cache_get_sub_texture(const char *filename,
                                  gboolean from_theme,
                                  ClutterGeometry *geo)
 {
-  ClutterActor *texture;
-  TidySubTexture *tex;
+  HdClutterCacheEntry *entry;
+  ClutterActor *tex;
   HdClutterCache *cache = hd_get_clutter_cache();
   if (!cache)
     return 0;
 
-  texture = hd_clutter_cache_get_real_texture(filename, from_theme);
-  if (!texture)
+  entry = hd_clutter_cache_get_entry(filename, from_theme);
+  if (!entry)
     {
-      texture = hd_clutter_cache_get_broken_texture(filename);
-      clutter_actor_set_name(texture, filename);
-      clutter_actor_set_size(texture, geo->width, geo->height);
-      return texture;
+      tex = hd_clutter_cache_get_broken_texture(filename);
+      clutter_actor_set_name(tex, filename);
+      clutter_actor_set_size(tex, geo->width, geo->height);
+      return tex;
     }
 
-  tex = tidy_sub_texture_new(CLUTTER_TEXTURE(texture));
-  tidy_sub_texture_set_region(tex, geo);
-  clutter_actor_set_name(CLUTTER_ACTOR(tex), filename);
-  clutter_actor_set_position(CLUTTER_ACTOR(tex), 0, 0);
-  clutter_actor_set_size(CLUTTER_ACTOR(tex), geo->width, geo->height);
+  tex = hd_clutter_cache_new_sub_texture(entry, geo);
+  clutter_actor_set_name(tex, filename);
+  clutter_actor_set_position(tex, 0, 0);
+  clutter_actor_set_size(tex, geo->width, geo->height);
 
-  return CLUTTER_ACTOR(tex);
+  return tex;
 }
 
 /* like hd_clutter_cache_get_texture, but divides up the texture
@@ -249,14 +1069,13 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
 {
   gboolean extend_x, extend_y;
   gint low_x, low_y, high_x, high_y;
-  ClutterTexture *texture = 0;
+  HdClutterCacheEntry *entry;
   ClutterActor *group = 0;
   ClutterGeometry geo = *geo_;
   gint x,y;
 
-  texture = CLUTTER_TEXTURE(hd_clutter_cache_get_real_texture(filename,
-                                                              from_theme));
-  if (!texture)
+  entry = hd_clutter_cache_get_entry(filename, from_theme);
+  if (!entry)
     {
       ClutterActor *actor = hd_clutter_cache_get_broken_texture();
       clutter_actor_set_name(actor, filename);
@@ -267,13 +1086,10 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
 
   if (geo.width==0 || geo.height==0)
     {
-      gfloat h,w;
-
       geo.x = 0;
       geo.y = 0;
-      clutter_actor_get_size(CLUTTER_ACTOR(texture), &w, &h);
-      geo.width = w;
-      geo.height = h;
+      geo.width = entry->rect.width;
+      geo.height = entry->rect.height;
     }
 
   extend_x = area->width > geo.width;
@@ -282,7 +1098,7 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
   /* no need to extend */
   if (!extend_x && !extend_y)
     {
-      /* ignore the contents of 'texture' as it will be in our cache */
+      /* ignore 'entry' as it will be in our cache */
       ClutterActor *actor =
           hd_clutter_cache_get_sub_texture(filename, from_theme, &geo);
       clutter_actor_set_position(actor, area->x, area->y);
@@ -315,7 +1131,7 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
   for (y=0;y<3;y++)
     for (x=0;x<3;x++)
       {
-        TidySubTexture *tex;
+        ClutterActor *tex;
         ClutterGeometry geot, pos;
         if (x==0)
           {
@@ -362,13 +1178,12 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
 
         if (geot.width>0 && geot.height>0)
           {
-            tex = tidy_sub_texture_new(texture);
-            tidy_sub_texture_set_region(tex, &geot);
+            tex = hd_clutter_cache_new_sub_texture(entry, &geot);
             if (x==1 || y==1)
-              tidy_sub_texture_set_tiled(tex, TRUE);
-            clutter_actor_set_position(CLUTTER_ACTOR(tex), pos.x, pos.y);
-            clutter_actor_set_size(CLUTTER_ACTOR(tex), pos.width, pos.height);
-            clutter_actor_add_child (group, CLUTTER_ACTOR(tex));
+              tidy_sub_texture_set_tiled(TIDY_SUB_TEXTURE(tex), TRUE);
+            clutter_actor_set_position(tex, pos.x, pos.y);
+            clutter_actor_set_size(tex, pos.width, pos.height);
+            clutter_actor_add_child (group, tex);
           }
       }
 
@@ -376,27 +1191,119 @@ hd_clutter_cache_get_sub_texture_for_area(const char *filename,
 }
 
 static void
-reload_texture_cb (ClutterActor *child,
-                   gpointer      data)
+reload_texture_cb (gpointer key, gpointer value, gpointer data)
 {
-  gchar *filename;
-  if (!CLUTTER_IS_TEXTURE(child))
+  HdClutterCacheEntry *entry = value;
+  HdClutterCache *cache = data;
+  HdClutterCachePrivate *priv = cache->priv;
+
+  /* The atlas is rebuilt separately. */
+  if (entry->in_atlas)
+    return;
+
+  /* If it's loaded asynchronously the old pixels stay until the new
+   * ones are uploaded, and the size is updated when that happens. */
+  hd_clutter_cache_load (cache, entry->texture, entry->path);
+  if (clutter_texture_get_load_data_async (CLUTTER_TEXTURE (entry->texture)))
     return;
 
-  /* filename is set in the child's name. clutter_texture_set_from_file sets
-   * the anme to this string, but the string is from the actor in the first
-   * place and it just breaks... */
-  filename = g_strdup(clutter_actor_get_name(child));
-  clutter_texture_set_from_file(CLUTTER_TEXTURE(child), filename, 0);
-  g_free(filename);
+  priv->bytes_resident -= entry->bytes;
+  hd_clutter_cache_entry_set_texture (entry, entry->texture);
+  entry->bytes = hd_clutter_cache_texture_bytes (entry->texture);
+  priv->bytes_resident += entry->bytes;
 }
 
 void hd_clutter_cache_theme_changed(void) {
+  HdClutterCachePrivate *priv;
+
   /* If there is no clutter cache yet then we definitely
    * don't care about reloading stuff */
   if (!the_clutter_cache)
     return;
 
-  clutter_container_foreach (CLUTTER_CONTAINER(the_clutter_cache),
-                             reload_texture_cb, 0);
+  /* Don't bother reloading what nobody uses, it might not even
+   * be used by the new theme. */
+  priv = the_clutter_cache->priv;
+  hd_clutter_cache_evict (priv, 0);
+  g_hash_table_foreach (priv->entries, reload_texture_cb, the_clutter_cache);
+  hd_clutter_cache_build_atlas (the_clutter_cache, TRUE);
+}
+
+/* Count the images and textures the visible cached actors under @actor
+ * show.  Each texture is a bind when they are painted. */
+static void
+hd_clutter_cache_count_binds (ClutterActor *actor, GHashTable *images,
+                              GHashTable *textures, guint *nactors)
+{
+  HdClutterCacheEntry *entry;
+  ClutterActor *child;
+
+  if ((entry = g_object_get_data (G_OBJECT (actor), "HD-ClutterCacheUser")))
+    {
+      (*nactors)++;
+      g_hash_table_insert (images, entry, entry);
+      g_hash_table_insert (textures, entry->texture, entry->texture);
+    }
+
+  for (child = clutter_actor_get_first_child (actor); child;
+       child = clutter_actor_get_next_sibling (child))
+    if (CLUTTER_ACTOR_IS_VISIBLE (child))
+      hd_clutter_cache_count_binds (child, images, textures, nactors);
+}
+
+/* Dump the number of texture binds @scene would take to paint the
+ * cached images of @root and @root2 (both may be NULL), with and without
+ * the atlas.  They are counted even if @root is hidden right now. */
+static void
+hd_clutter_cache_dump_binds (const gchar *scene,
+                             ClutterActor *root, ClutterActor *root2)
+{
+  GHashTable *images, *textures;
+  guint nactors = 0;
+
+  images   = g_hash_table_new (NULL, NULL);
+  textures = g_hash_table_new (NULL, NULL);
+  if (root)
+    hd_clutter_cache_count_binds (root, images, textures, &nactors);
+  if (root2)
+    hd_clutter_cache_count_binds (root2, images, textures, &nactors);
+  g_debug ("  %s: %u cached actors, %u binds without the atlas, %u with it",
+           scene, nactors, g_hash_table_size (images),
+           g_hash_table_size (textures));
+  g_hash_table_destroy (images);
+  g_hash_table_destroy (textures);
+}
+
+void hd_clutter_cache_dump_debug_info (void)
+{
+  HdClutterCachePrivate *priv;
+
+  if (!the_clutter_cache)
+    return;
+
+  priv = the_clutter_cache->priv;
+  g_debug ("HdClutterCache: %u textures (%u unused), "
+           "%" G_GSIZE_FORMAT " bytes resident "
+           "(%" G_GSIZE_FORMAT " unused, budget %" G_GSIZE_FORMAT ")",
+           g_hash_table_size (priv->entries), g_queue_get_length (&priv->lru),
+           priv->bytes_resident, priv->bytes_unused, priv->budget);
+  g_debug ("  %u hits, %u misses, %u evictions, %u loads pending%s",
+           priv->hits, priv->misses, priv->evictions, priv->loads_pending,
+           priv->async ? "" : " (synchronous loading)");
+  g_debug ("  atlas: %u images in %u pages, %" G_GSIZE_FORMAT " bytes",
+           priv->atlas_images, priv->atlas->len, priv->atlas_bytes);
+
+  /* The title bar is painted in both scenes. */
+  {
+    extern HdTaskNavigator *hd_task_navigator;
+    ClutterActor *title_bar = hd_render_manager_get_title_bar ();
+
+    hd_clutter_cache_dump_binds ("home",
+                     CLUTTER_ACTOR (hd_render_manager_get_home ()),
+                     title_bar);
+    hd_clutter_cache_dump_binds ("task navigator",
+                     hd_task_navigator ? CLUTTER_ACTOR (hd_task_navigator)
+                                       : NULL,
+                     title_bar);
+  }
 }
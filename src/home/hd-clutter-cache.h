@@ -55,7 +55,12 @@ GType hd_clutter_cache_get_type (void) G_GNUC_CONST;
 void
 hd_clutter_cache_theme_changed(void);
 
-/* Create a clutter clone texture from a texture in our cache.
+/* Print the cache statistics with g_debug(). */
+void
+hd_clutter_cache_dump_debug_info(void);
+
+/* Create a clutter clone texture from a texture in our cache,
+ * or a TidySubTexture if the image is in the atlas.
  * This is created specially and is not owned by the cache.
  * If from_theme is true, the filename will be appended to the current
  * theme's path.
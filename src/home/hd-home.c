@@ -42,6 +42,7 @@
 #include "hd-launcher-app.h"
 #include "hd-dbus.h"
 #include "hd-title-bar.h"
+#include "hd-frame-stats.h"
 
 #include <clutter/clutter.h>
 #include <clutter/x11/clutter-x11.h>
@@ -2835,3 +2836,9 @@ hd_home_is_desktop_in_portrait_mode (void)
 	return STATE_IS_PORTRAIT (hd_render_manager_get_state ());
 }
 
+/* For D-Bus: the frame time statistics per state. */
+gchar *
+hd_home_get_frame_stats (HdHome *home)
+{
+  return hd_frame_stats_get_report ();
+}
@@ -40,8 +40,12 @@
 #include "hd-launcher.h"
 #include "hd-task-navigator.h"
 #include "hd-transition.h"
+#include "hd-animation.h"
 #include "hd-wm.h"
 #include "hd-util.h"
+#include "hd-frame-stats.h"
+#include "hd-restack.h"
+#include "hd-state-profile.h"
 #include "hd-title-bar.h"
 #include "hd-app.h"
 #include "hd-dialog.h"
@@ -51,6 +55,8 @@
 #include <matchbox/theme-engines/mb-wm-theme.h>
 
 #include <sys/time.h>
+#include <string.h>
+#include <math.h>
 
 #define ZOOM_INCREMENT 0.1
 
@@ -232,11 +238,8 @@ struct _HdRenderManagerPrivate {
 
   ClutterTimeline    *timeline_press;
 
-  ClutterTimeline    *timeline_blur;
-  /* Timeline works by signals, so we get horrible flicker if we ask it if it
-   * is playing right after saying _start() - so we have a boolean to figure
-   * out for ourselves */
-  gboolean            timeline_playing;
+  /* The %HdAnimation tween of the blur transition, 0 if none. */
+  guint               blur_tween;
   gboolean	      press_effect;
 
   gboolean            in_set_state;
@@ -246,6 +249,25 @@ struct _HdRenderManagerPrivate {
   cairo_region_t           *current_input_viewport;
   cairo_region_t           *new_input_viewport;
   guint                input_viewport_callback;
+
+  /* Used by hd_render_manager_set_visibilities() to accumulate the
+   * area covered by opaque actors. */
+  cairo_region_t           *visibility_blockers;
+
+  /* Occlusion culling, see hd_render_manager_cull(): the actors not
+   * to paint in the current stage paint and the area covered by the
+   * opaque windows seen so far. */
+  GHashTable               *culled;
+  cairo_region_t           *cull_blockers;
+
+  /* How many times hd_render_manager_restack() ran and how many
+   * actors it reparented and moved, for the debug dump. */
+  guint                     restacks, restack_reparents, restack_moves;
+
+  /* Times the steps of hd_render_manager_set_state() per state change,
+   * in milliseconds of @state_clock. */
+  HdStateProfile           *state_profile;
+  GTimer                   *state_clock;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -258,18 +280,19 @@ hd_render_manager_captured_event_cb (ClutterActor     *actor,
                                      gpointer *data);
 
 static void
-on_timeline_blur_new_frame(ClutterTimeline *timeline,
-                           guint msecs, gpointer data);
+on_blur_frame(gfloat amt, gpointer data);
 static void
-on_timeline_blur_completed(ClutterTimeline *timeline, gpointer data);
+on_blur_completed(gpointer data);
 
 static void
 hd_render_manager_sync_clutter_before(void);
 static void
 hd_render_manager_sync_clutter_after(void);
 
-static const char *
-hd_render_manager_state_str(HDRMStateEnum state);
+static void
+hd_render_manager_cull(ClutterActor *stage);
+static void
+hd_render_manager_cull_done(ClutterActor *stage);
 
 static void
 hd_render_manager_get_property (GObject    *object,
@@ -426,6 +449,11 @@ hd_render_manager_finalize (GObject *gobject)
   g_object_unref(priv->home);
   g_object_unref(priv->task_nav);
   g_object_unref(priv->title_bar);
+  cairo_region_destroy(priv->visibility_blockers);
+  cairo_region_destroy(priv->cull_blockers);
+  g_hash_table_destroy(priv->culled);
+  hd_state_profile_free(priv->state_profile);
+  g_timer_destroy(priv->state_clock);
   G_OBJECT_CLASS (hd_render_manager_parent_class)->finalize (gobject);
 }
 
@@ -563,14 +591,21 @@ hd_render_manager_init (HdRenderManager *self)
 		    priv);
   priv->press_effect = FALSE;
 
-  priv->timeline_blur = clutter_timeline_new(250);
-  g_signal_connect (priv->timeline_blur, "new-frame",
-                    G_CALLBACK (on_timeline_blur_new_frame), self);
-  g_signal_connect (priv->timeline_blur, "completed",
-                      G_CALLBACK (on_timeline_blur_completed), self);
-  priv->timeline_playing = FALSE;
+  priv->blur_tween = 0;
 
   priv->in_set_state = FALSE;
+
+  priv->visibility_blockers = cairo_region_create();
+
+  priv->culled = g_hash_table_new(g_direct_hash, g_direct_equal);
+  priv->cull_blockers = cairo_region_create();
+  g_signal_connect(stage, "paint",
+                   G_CALLBACK(hd_render_manager_cull), NULL);
+  g_signal_connect_after(stage, "paint",
+                         G_CALLBACK(hd_render_manager_cull_done), NULL);
+
+  priv->state_profile = hd_state_profile_new();
+  priv->state_clock = g_timer_new();
 }
 
 /* ------------------------------------------------------------------------- */
@@ -588,18 +623,50 @@ stage_allocation_changed(ClutterActor *actor, GParamSpec *unused,
                          hd_comp_mgr_get_current_screen_height ());
 }
 
+/* Milliseconds for the state profile. */
+static gdouble
+hd_render_manager_profile_now(void)
+{
+  return g_timer_elapsed(render_manager->priv->state_clock, NULL) * 1000;
+}
+
+static void
+hd_render_manager_profile_start(HdStateSpan span)
+{
+  hd_state_profile_start(render_manager->priv->state_profile, span,
+                         hd_render_manager_profile_now());
+}
+
+static void
+hd_render_manager_profile_end(HdStateSpan span)
+{
+  hd_state_profile_end(render_manager->priv->state_profile, span,
+                       hd_render_manager_profile_now());
+}
+
+static void
+hd_render_manager_profile_background(HdStateSpan span)
+{
+  hd_state_profile_background(render_manager->priv->state_profile, span,
+                              hd_render_manager_profile_now());
+}
+
+static void
+hd_render_manager_profile_cancel(HdStateSpan span)
+{
+  hd_state_profile_cancel(render_manager->priv->state_profile, span,
+                          hd_render_manager_profile_now());
+}
+
 static void
-on_timeline_blur_new_frame(ClutterTimeline *timeline,
-                           guint msecs, gpointer data)
+on_blur_frame(gfloat amt, gpointer data)
 {
   HdRenderManagerPrivate *priv;
-  float amt;
   gint task_opacity, applets_opacity;
   ClutterActor *home_front;
 
   priv = render_manager->priv;
-
-  amt = msecs / (float)clutter_timeline_get_duration(timeline);
+  hd_state_profile_frame(priv->state_profile, HD_STATE_SPAN_BLUR);
 
   range_interpolate(&priv->home_radius, amt);
   range_interpolate(&priv->home_zoom, amt);
@@ -667,17 +734,24 @@ on_timeline_blur_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_timeline_blur_completed (ClutterTimeline *timeline, gpointer data)
+on_blur_completed (gpointer data)
 {
   HdRenderManagerPrivate *priv = render_manager->priv;
 
-  priv->timeline_playing = FALSE;
+  priv->blur_tween = 0;
   hd_comp_mgr_set_effect_running(priv->comp_mgr, FALSE);
+  /* What follows the blur belongs to the state change which started it,
+   * not to the one in progress. */
+  hd_state_profile_start_as(priv->state_profile, HD_STATE_SPAN_SYNC_AFTER,
+                            HD_STATE_SPAN_BLUR,
+                            hd_render_manager_profile_now());
+  hd_render_manager_profile_end(HD_STATE_SPAN_BLUR);
 
   g_signal_emit (render_manager, signals[TRANSITION_COMPLETE], 0);
 
   /* to trigger a change after the transition */
   hd_render_manager_sync_clutter_after();
+  hd_render_manager_profile_end(HD_STATE_SPAN_SYNC_AFTER);
 
   if (STATE_IS_TASK_NAV(priv->state))
     hd_task_navigator_transition_done(priv->task_nav);
@@ -696,17 +770,19 @@ void hd_render_manager_set_blur (HDRMBlurEnum blur)
 
   priv = render_manager->priv;
 
-  if (priv->timeline_playing)
+  if (priv->blur_tween)
     {
-      clutter_timeline_stop(priv->timeline_blur);
+      hd_animation_remove(priv->blur_tween);
+      priv->blur_tween = 0;
       hd_comp_mgr_set_effect_running(priv->comp_mgr, FALSE);
+      hd_render_manager_profile_cancel(HD_STATE_SPAN_BLUR);
     }
 
   priv->current_blur = blur;
 
   /* If we were going to transition to not blurring but didn't get there,
    * make sure we set blur=0 anyway in order to *force* the blurring to
-   * recalculate. The first call to on_timeline_blur_new_frame will set
+   * recalculate. The first call to on_blur_frame will set
    * the correct value anyway. */
   if (priv->home_radius.b == 0 &&
       priv->home_radius.current != 0)
@@ -730,6 +806,9 @@ void hd_render_manager_set_blur (HDRMBlurEnum blur)
 
   blur_home = blur & (HDRM_BLUR_BACKGROUND | HDRM_BLUR_HOME);
 
+  tidy_blur_group_set_pyramid(CLUTTER_ACTOR(priv->home_blur),
+                    hd_transition_get_int("blur", "pyramid", 0));
+
   if (blur_home)
     {
       priv->home_saturation.b =
@@ -783,7 +862,7 @@ void hd_render_manager_set_blur (HDRMBlurEnum blur)
    * ranges are the same, we may have changed 'a' and 'b' together
    * (see applets_opacity). Otherwise it is possible to get a frame
    * of flicker if clutter renders before the timeline. */
-  on_timeline_blur_new_frame(priv->timeline_blur, 0, NULL);
+  on_blur_frame(0, NULL);
 
   /* no point animating if everything is already right */
   if (range_equal(&priv->home_radius) &&
@@ -794,16 +873,22 @@ void hd_render_manager_set_blur (HDRMBlurEnum blur)
       range_equal(&priv->task_nav_zoom) &&
       range_equal(&priv->applets_opacity))
     {
+      if (priv->in_set_state)
+        hd_render_manager_profile_start(HD_STATE_SPAN_SYNC_AFTER);
       hd_render_manager_sync_clutter_after();
+      hd_render_manager_profile_end(HD_STATE_SPAN_SYNC_AFTER);
       return;
     }
 
+  /* Only the blur of a state change is interesting to profile. */
+  if (priv->in_set_state)
+    hd_render_manager_profile_start(HD_STATE_SPAN_BLUR);
   hd_comp_mgr_set_effect_running(priv->comp_mgr, TRUE);
-  /* Set duration here so we reload from the file every time */
-  clutter_timeline_set_duration(priv->timeline_blur,
-      hd_transition_get_int("blur", "duration", 250));
-  clutter_timeline_start(priv->timeline_blur);
-  priv->timeline_playing = TRUE;
+  /* Get the duration here so we reload from the file every time */
+  priv->blur_tween = hd_animation_add(
+                        hd_transition_get_int("blur", "duration", 250),
+                        on_blur_frame, on_blur_completed, NULL);
+  hd_render_manager_profile_background(HD_STATE_SPAN_BLUR);
 }
 
 /* This is for the task navigator when it zooms into a thumbnail.
@@ -1143,13 +1228,11 @@ void hd_render_manager_stop_transition()
 {
   HdRenderManagerPrivate *priv = render_manager->priv;
 
-  if (priv->timeline_playing)
+  if (priv->blur_tween)
     {
-      guint duration;
-      clutter_timeline_stop(priv->timeline_blur);
-      duration = clutter_timeline_get_duration(priv->timeline_blur);
-      on_timeline_blur_new_frame(priv->timeline_blur, duration, render_manager);
-      on_timeline_blur_completed(priv->timeline_blur, render_manager);
+      hd_animation_remove(priv->blur_tween);
+      on_blur_frame(1, render_manager);
+      on_blur_completed(render_manager);
     }
 
   hd_launcher_transition_stop();
@@ -1388,9 +1471,11 @@ void hd_render_manager_set_state(HDRMStateEnum state)
   MBWMCompMgr          *cmgr;
   MBWindowManager      *wm;
   MBWindowManagerClient *c;
+  gdouble started;
 
   priv = render_manager->priv;
   cmgr = MB_WM_COMP_MGR (priv->comp_mgr);
+  started = hd_render_manager_profile_now();
 
   if (hd_debug_mode_set)
     g_warning("%s -> %s", hd_render_manager_state_str(priv->state),
@@ -1522,6 +1607,7 @@ void hd_render_manager_set_state(HDRMStateEnum state)
            state != HDRM_STATE_NON_COMPOSITED))
         {
           hd_comp_mgr_reset_overlay_shape (HD_COMP_MGR (cmgr));
+          hd_comp_mgr_compositing_changed (HD_COMP_MGR (cmgr), TRUE);
 
           /* redirect and track damage again */
           for (c = wm->stack_top; c; c = c->stacked_below)
@@ -1790,11 +1876,30 @@ void hd_render_manager_set_state(HDRMStateEnum state)
           g_debug("call-ui, no transition after tklock");
         }
 
+      /* From here on we know where we're going. */
+      hd_state_profile_begin (priv->state_profile, oldstate, state);
+      hd_state_profile_start (priv->state_profile, HD_STATE_SPAN_SET_STATE,
+                              started);
+
+      hd_render_manager_profile_start (HD_STATE_SPAN_SYNC_BEFORE);
       hd_render_manager_sync_clutter_before();
+      hd_render_manager_profile_end (HD_STATE_SPAN_SYNC_BEFORE);
 
-      /* Switch between portrait <=> landscape modes. */
+      /* Switch between portrait <=> landscape modes.  Time the rotation
+       * until hd_render_manager_rotation_completed(), but not a diverted
+       * one again. */
       if (oldstate != HDRM_STATE_UNDEFINED)
-        hd_transition_rotate_screen (wm, STATE_IS_PORTRAIT (state) && !hd_comp_mgr_is_blacklisted (wm, wm->stack_top));
+        {
+          gboolean rotating = hd_transition_is_rotating ();
+
+          if (!rotating)
+            hd_render_manager_profile_start (HD_STATE_SPAN_ROTATE);
+          hd_transition_rotate_screen (wm, STATE_IS_PORTRAIT (state) && !hd_comp_mgr_is_blacklisted (wm, wm->stack_top));
+          if (!rotating && hd_transition_is_rotating ())
+            hd_render_manager_profile_background (HD_STATE_SPAN_ROTATE);
+          else if (!rotating)
+            hd_render_manager_profile_cancel (HD_STATE_SPAN_ROTATE);
+        }
 
       /* Reset CURRENT_APP_WIN when entering tasw. */
       /* Try not to change it unnecessary. */
@@ -1831,7 +1936,9 @@ void hd_render_manager_set_state(HDRMStateEnum state)
            */
 
           /* make sure everything is in the correct order */
+          hd_render_manager_profile_start (HD_STATE_SPAN_STACKING);
           hd_comp_mgr_sync_stacking (HD_COMP_MGR (priv->comp_mgr));
+          hd_render_manager_profile_end (HD_STATE_SPAN_STACKING);
         }
 
       /* When moving from an app to the task navigator, stop the transition
@@ -1846,18 +1953,20 @@ void hd_render_manager_set_state(HDRMStateEnum state)
           range_set(&priv->home_brightness, priv->home_brightness.b);
           range_set(&priv->home_saturation, priv->home_saturation.b);
           range_set(&priv->home_radius, priv->home_radius.b);
-          on_timeline_blur_new_frame(priv->timeline_blur,
-              clutter_timeline_get_elapsed_time(priv->timeline_blur), NULL);
+          on_blur_frame(hd_animation_get_progress(priv->blur_tween), NULL);
         }
 
       if (STATE_IS_NON_COMP (state))
         {
           hd_comp_mgr_reset_overlay_shape (HD_COMP_MGR (priv->comp_mgr));
+          hd_comp_mgr_compositing_changed (HD_COMP_MGR (priv->comp_mgr),
+                                           FALSE);
           hd_comp_mgr_unredirect_topmost_client (wm, FALSE);
         }
     }
 
 out:
+  hd_render_manager_profile_end (HD_STATE_SPAN_SET_STATE);
   if (hd_debug_mode_set)
     g_warning("Set state complete %s ",	hd_render_manager_state_str(priv->state));
 
@@ -1933,7 +2042,7 @@ inline HDRMStateEnum hd_render_manager_get_previous_state()
   return render_manager->priv->previous_state;
 }
 
-static const char *hd_render_manager_state_str(HDRMStateEnum state)
+const char *hd_render_manager_state_str(HDRMStateEnum state)
 {
   GTypeClass *state_class = g_type_class_ref (HD_TYPE_RENDER_MANAGER_STATE);
   GEnumValue *state_value = g_enum_get_value (
@@ -1992,7 +2101,7 @@ hd_render_manager_set_property (GObject      *gobject,
 gboolean hd_render_manager_in_transition(void)
 {
   HdRenderManagerPrivate *priv = render_manager->priv;
-  return clutter_timeline_is_playing(priv->timeline_blur);
+  return priv->blur_tween != 0;
 }
 
 /* Return @actor, an actor of a %HdApp to HDRM's care. */
@@ -2121,6 +2230,159 @@ hd_render_manager_get_geo_for_current_screen(ClutterActor *actor,
     *geo = rgeo;
 }
 
+/* hd_restack_reorder() callback moving @child in @group. */
+static void
+hd_render_manager_restack_move(gpointer child, gpointer below, gpointer group)
+{
+  if (below)
+    clutter_actor_set_child_above_sibling(group, child, below);
+  else
+    clutter_actor_set_child_below_sibling(group, child, NULL);
+  render_manager->priv->restack_moves++;
+}
+
+static gboolean
+hd_render_manager_restack_has(GPtrArray *actors, gpointer actor)
+{
+  guint i;
+
+  for (i = 0; i < actors->len; i++)
+    if (actors->pdata[i] == actor)
+      return TRUE;
+  return FALSE;
+}
+
+/* g_ptr_array_insert() is too new for us. */
+static void
+hd_render_manager_restack_insert(GPtrArray *actors, guint i, gpointer actor)
+{
+  g_ptr_array_add(actors, NULL);
+  memmove(&actors->pdata[i+1], &actors->pdata[i],
+          (actors->len-1 - i) * sizeof(actors->pdata[0]));
+  actors->pdata[i] = actor;
+}
+
+/* Moves the @actors which are elsewhere into @group. */
+static void
+hd_render_manager_restack_reparent(ClutterActor *group, GPtrArray *actors)
+{
+  guint i;
+
+  for (i = 0; i < actors->len; i++)
+    if (clutter_actor_get_parent(actors->pdata[i]) != group)
+      {
+        clutter_actor_reparent(actors->pdata[i], group);
+        render_manager->priv->restack_reparents++;
+      }
+}
+
+/* Stacks the children of @group like @want from the bottom up,
+ * leaving alone the ones in the right order already. */
+static void
+hd_render_manager_restack_group(ClutterActor *group, GPtrArray *want)
+{
+  GPtrArray *have;
+  ClutterActor *child;
+
+  have = g_ptr_array_sized_new(want->len);
+  for (child = clutter_actor_get_first_child(group); child;
+       child = clutter_actor_get_next_sibling(child))
+    g_ptr_array_add(have, child);
+
+  if (have->len == want->len)
+    hd_restack_reorder(have->pdata, want->pdata, want->len,
+                       hd_render_manager_restack_move, group);
+  else
+    g_critical("%s: %s has %u children instead of %u", __FUNCTION__,
+               clutter_actor_get_name(group) ?: "?", have->len, want->len);
+
+  g_ptr_array_free(have, TRUE);
+}
+
+static void
+hd_render_manager_restack_free_raised(gpointer actors)
+{
+  g_ptr_array_free(actors, TRUE);
+}
+
+/* Plans to raise @actor to the top of its parent, above the ones
+ * planned before. */
+static void
+hd_render_manager_restack_raise(GHashTable *raised, ClutterActor *actor)
+{
+  ClutterActor *parent;
+  GPtrArray *actors;
+
+  if (!(parent = clutter_actor_get_parent(actor)))
+    return;
+  if (!(actors = g_hash_table_lookup(raised, parent)))
+    g_hash_table_insert(raised, parent, actors = g_ptr_array_new());
+  g_ptr_array_remove(actors, actor);
+  g_ptr_array_add(actors, actor);
+}
+
+/* Raises the planned children of @parent, a GHFunc. */
+static void
+hd_render_manager_restack_raised(gpointer parent, gpointer actors,
+                                 gpointer unused)
+{
+  GPtrArray *want;
+  ClutterActor *child;
+  guint i;
+
+  want = g_ptr_array_new();
+  for (child = clutter_actor_get_first_child(parent); child;
+       child = clutter_actor_get_next_sibling(child))
+    if (!hd_render_manager_restack_has(actors, child))
+      g_ptr_array_add(want, child);
+  for (i = 0; i < ((GPtrArray *)actors)->len; i++)
+    g_ptr_array_add(want, ((GPtrArray *)actors)->pdata[i]);
+  hd_render_manager_restack_group(parent, want);
+  g_ptr_array_free(want, TRUE);
+}
+
+void
+hd_render_manager_dump_restack_stats(void)
+{
+  HdRenderManagerPrivate *priv = render_manager->priv;
+
+  g_debug("restack: %u restacks, %u reparents, %u moves "
+          "(%.2f reparents/restack, %.2f moves/restack)",
+          priv->restacks, priv->restack_reparents, priv->restack_moves,
+          priv->restacks ? (gdouble)priv->restack_reparents/priv->restacks : 0,
+          priv->restacks ? (gdouble)priv->restack_moves/priv->restacks : 0);
+}
+
+void
+hd_render_manager_rotation_completed(void)
+{
+  if (render_manager)
+    hd_render_manager_profile_end(HD_STATE_SPAN_ROTATE);
+}
+
+static const gchar *
+hd_render_manager_state_name(guint state)
+{
+  return hd_render_manager_state_str(state);
+}
+
+void
+hd_render_manager_dump_state_profile(void)
+{
+  gchar *report, **lines;
+  guint i;
+
+  report = hd_state_profile_get_report(render_manager->priv->state_profile,
+                                       hd_render_manager_state_name);
+  lines = g_strsplit(report, "\n", 0);
+  g_debug("State changes:");
+  for (i = 0; lines[i]; i++)
+    if (*lines[i])
+      g_debug("  %s", lines[i]);
+  g_strfreev(lines);
+  g_free(report);
+}
+
 /* Called to restack the windows in the way we use for rendering... */
 void hd_render_manager_restack()
 {
@@ -2135,14 +2397,14 @@ void hd_render_manager_restack()
   int curr_view;
   ClutterActor *live_bg_actor = NULL;
   ClutterActor *child;
+  GPtrArray *restacked, *want_blur, *want_top;
+  GHashTable *restacked_set, *raised;
 
   wm = MB_WM_COMP_MGR(priv->comp_mgr)->wm;
   /* Add all actors currently in the home_blur group */
 
-  for (i = 0,
-       child = clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), 0);
-       child;
-       child = clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), ++i))
+  for (child = clutter_actor_get_first_child(CLUTTER_ACTOR(priv->home_blur));
+       child; child = clutter_actor_get_next_sibling(child))
     if (clutter_actor_is_visible(child))
       previous_home_blur = g_list_prepend(previous_home_blur, child);
 
@@ -2150,7 +2412,16 @@ void hd_render_manager_restack()
   screenh = hd_comp_mgr_get_current_screen_height ();
   curr_view = hd_home_get_current_view_id (priv->home);
 
-  /* Order and choose which window actors will be visible */
+  /* Order and choose which window actors will be visible.  We only
+   * plan here what goes where, and move the actors afterwards, with
+   * as few reparents and restacks as we can, because clutter queues
+   * a relayout and a redraw for every one of them.  @restacked are
+   * the actors to go to the top of home_blur in this order, @raised
+   * are the ones to go to the top of some other parent. */
+  restacked = g_ptr_array_new ();
+  restacked_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+  raised = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                  hd_render_manager_restack_free_raised);
   for (c = wm->stack_bottom; c; c = c->stacked_above)
     {
       past_desktop |= (wm->desktop == c);
@@ -2193,7 +2464,10 @@ void hd_render_manager_restack()
                   ClutterActor *parent = clutter_actor_get_parent (actor);
                   if (parent == CLUTTER_ACTOR (priv->app_top) ||
                       parent == CLUTTER_ACTOR (priv->home_blur))
-                    clutter_actor_reparent (actor, CLUTTER_ACTOR (desktop));
+                    {
+                      clutter_actor_reparent (actor, CLUTTER_ACTOR (desktop));
+                      priv->restack_reparents++;
+                    }
                 }
               g_debug ("%s: skip unmapped client '%s' (actor '%s')\n",
                        __func__, mb_wm_client_get_name (c),
@@ -2227,27 +2501,25 @@ void hd_render_manager_restack()
                   if (parent)
                     {
                       if (parent == CLUTTER_ACTOR(desktop) ||
-                          parent == CLUTTER_ACTOR(priv->app_top))
+                          parent == CLUTTER_ACTOR(priv->app_top) ||
+                          parent == CLUTTER_ACTOR(priv->home_blur))
                         {
-                          clutter_actor_reparent(actor,
-                                                 CLUTTER_ACTOR(priv->home_blur));
+                          g_ptr_array_add (restacked, actor);
+                          g_hash_table_insert (restacked_set, actor, actor);
                         }
-#if STACKING_DEBUG
                       else
-                        g_debug("%s NOT MOVED - OWNED BY %s",
-                            clutter_actor_get_name(actor)?clutter_actor_get_name(actor):"?",
-                            clutter_actor_get_name(parent)?clutter_actor_get_name(parent):"?");
+                        {
+#if STACKING_DEBUG
+                          g_debug("%s NOT MOVED - OWNED BY %s",
+                              clutter_actor_get_name(actor)?clutter_actor_get_name(actor):"?",
+                              clutter_actor_get_name(parent)?clutter_actor_get_name(parent):"?");
 #endif /*STACKING_DEBUG*/
-                     clutter_actor_set_child_above_sibling(
-                           clutter_actor_get_parent(actor), actor, NULL);
+                          hd_render_manager_restack_raise (raised, actor);
+                        }
                      if (live_bg_actor && c->desktop == curr_view
                          && MB_WM_CLIENT_CLIENT_TYPE (c)==
                          (MBWMClientType)HdWmClientTypeHomeApplet)
-                     {
-                       clutter_actor_set_child_above_sibling(
-                             clutter_actor_get_parent(live_bg_actor),
-                             live_bg_actor, NULL);
-                     }
+                       hd_render_manager_restack_raise (raised, live_bg_actor);
                     }
 #if STACKING_DEBUG
                   else
@@ -2260,25 +2532,38 @@ void hd_render_manager_restack()
                   /* else we put it back into the arena */
                   if (parent == CLUTTER_ACTOR(priv->home_blur) ||
                       parent == CLUTTER_ACTOR(priv->app_top))
-                    clutter_actor_reparent(actor, desktop);
+                    {
+                      clutter_actor_reparent(actor, desktop);
+                      priv->restack_reparents++;
+                    }
                 }
             }
         }
     }
 
+  /* What home_blur would look like with @restacked on the top: what's
+   * already there and stays, then @restacked.  app_top keeps whatever
+   * is not ours. */
+  want_blur = g_ptr_array_new ();
+  for (child = clutter_actor_get_first_child(CLUTTER_ACTOR(priv->home_blur));
+       child; child = clutter_actor_get_next_sibling(child))
+    if (!g_hash_table_lookup (restacked_set, child))
+      g_ptr_array_add (want_blur, child);
+  for (i = 0; i < restacked->len; i++)
+    g_ptr_array_add (want_blur, restacked->pdata[i]);
+  want_top = g_ptr_array_new ();
+
   /* Now start at the top and put actors in the non-blurred group
    * until we find one that fills the screen. If we didn't find
    * any that filled the screen then add the window that does. */
   {
-    gint i, n_elements;
+    gint i;
     gboolean move_to_front = TRUE;
     ClutterActor *highest_maximized = 0;
 
-    n_elements = clutter_group_get_n_children(CLUTTER_GROUP(priv->home_blur));
-    for (i = n_elements-1; i >= 0; i--)
+    for (i = want_blur->len-1; i >= 0; i--)
       {
-        ClutterActor *child =
-          clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), i);
+        ClutterActor *child = want_blur->pdata[i];
 
 	/* If the client decides its own visibility, skip it */
 	if (hd_render_manager_should_ignore_actor(child))
@@ -2307,9 +2592,9 @@ void hd_render_manager_restack()
             if ((move_to_front && !maximized) || (priv->state == HDRM_STATE_HOME_EDIT_DLG)
 								 || (priv->state == HDRM_STATE_HOME_EDIT_DLG_PORTRAIT))
               {
-                clutter_actor_reparent(child, CLUTTER_ACTOR(priv->app_top));
-                clutter_actor_lower_bottom(child);
-		        clutter_actor_show(child);
+                /* Collected from the top, so reversed below. */
+                g_ptr_array_add (want_top, child);
+                g_ptr_array_remove_index (want_blur, i);
               }
             /* If this is maximized, or in dialog's position, don't
              * blur anything after. Note that even if we find a dialog
@@ -2331,22 +2616,58 @@ void hd_render_manager_restack()
 
     /* Put blur_front in the correct place, assuming it is in home_blur.
      * We want it above apps, but below anything non-fullscreen like
-     * the status menu.
-     */
+     * the status menu.  If we don't have anything maximised (which we
+     * should do really unless we have no apps open) just move to the
+     * top.  If the maximised one goes to app_top leave it alone. */
     if (clutter_actor_get_parent(CLUTTER_ACTOR(priv->blur_front)) ==
-                                   CLUTTER_ACTOR(priv->home_blur))
+                                   CLUTTER_ACTOR(priv->home_blur)
+        && (!highest_maximized
+            || !hd_render_manager_restack_has (want_top, highest_maximized)))
       {
-        /* clutter_actor_raise will raise *and* lower, contrary to the name.
-         * If we don't have anything maximised (which we should do really unless
-         * we have no apps open) just move to the top. */
+        g_ptr_array_remove (want_blur, priv->blur_front);
         if (highest_maximized)
-          clutter_actor_raise(CLUTTER_ACTOR(priv->blur_front),
-                              highest_maximized);
+          {
+            for (i = 0; want_blur->pdata[i] != highest_maximized; i++)
+              ;
+            hd_render_manager_restack_insert (want_blur, i + 1,
+                                              priv->blur_front);
+          }
         else
-          clutter_actor_raise_top(CLUTTER_ACTOR(priv->blur_front));
+          g_ptr_array_add (want_blur, priv->blur_front);
       }
   }
 
+  /* The ones going to app_top go to its bottom, in stacking order. */
+  for (i = 0; i < want_top->len / 2; i++)
+    {
+      gpointer tmp = want_top->pdata[i];
+
+      want_top->pdata[i] = want_top->pdata[want_top->len-1-i];
+      want_top->pdata[want_top->len-1-i] = tmp;
+    }
+  for (i = 0; i < want_top->len; i++)
+    clutter_actor_show(want_top->pdata[i]);
+  for (child = clutter_actor_get_first_child(CLUTTER_ACTOR(priv->app_top));
+       child; child = clutter_actor_get_next_sibling(child))
+    if (!g_hash_table_lookup (restacked_set, child))
+      g_ptr_array_add (want_top, child);
+
+  /* Only now touch the actors.  Take everything out of home_blur
+   * before we put anything into it. */
+  hd_render_manager_restack_reparent (CLUTTER_ACTOR(priv->app_top), want_top);
+  hd_render_manager_restack_reparent (CLUTTER_ACTOR(priv->home_blur),
+                                      want_blur);
+  hd_render_manager_restack_group (CLUTTER_ACTOR(priv->home_blur), want_blur);
+  hd_render_manager_restack_group (CLUTTER_ACTOR(priv->app_top), want_top);
+  g_hash_table_foreach (raised, hd_render_manager_restack_raised, NULL);
+  priv->restacks++;
+
+  g_hash_table_destroy (raised);
+  g_hash_table_destroy (restacked_set);
+  g_ptr_array_free (restacked, TRUE);
+  g_ptr_array_free (want_blur, TRUE);
+  g_ptr_array_free (want_top, TRUE);
+
   /* We could have changed the order of the windows here, so update whether
    * we blur or not based on the order. */
   hd_render_manager_update_blur_state();
@@ -2359,15 +2680,16 @@ void hd_render_manager_restack()
    * actually changed... We only look at *visible* children, which is
    * why it is a little complicated. */
   GList *it;
-  for (i = 0, it = g_list_last(previous_home_blur),
-       child = clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), 0);
+  for (it = g_list_last(previous_home_blur),
+       child = clutter_actor_get_first_child(CLUTTER_ACTOR(priv->home_blur));
        child && it;
-       child = clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), ++i),
-       it=it->prev)
+       child = clutter_actor_get_next_sibling(child), it=it->prev)
     {
       /* search for next visible child */
       while (child && !clutter_actor_is_visible(child))
-        child=clutter_group_get_nth_child(CLUTTER_GROUP(priv->home_blur), ++i);
+        child = clutter_actor_get_next_sibling(child);
+      if (!child)
+        break;
 
       /* now compare children */
       if (CLUTTER_ACTOR(it->data) != child)
@@ -2574,105 +2896,37 @@ void hd_render_manager_set_launcher_subview(gboolean subview)
         ~HDRM_ZOOM_FOR_LAUNCHER_SUBMENU);
 }
 
-/* Work out if rect is visible after being clipped to avoid every
- * rect in blockers */
+/* Work out if any part of rect is left visible after subtracting
+ * all the rects in blockers */
 static gboolean
-hd_render_manager_is_visible(GList *blockers,
+hd_render_manager_is_visible(const cairo_region_t *blockers,
                              ClutterGeometry rect)
 {
   HdRenderManagerPrivate *priv = render_manager->priv;
+  cairo_rectangle_int_t crect;
 
   if (STATE_IS_NON_COMP (priv->state) || !hd_render_manager_clip_geo(&rect))
     return FALSE;
 
-  /* clip for every block */
-  for (; blockers; blockers = blockers->next)
-    {
-      ClutterGeometry blocker = *(ClutterGeometry*)blockers->data;
-      gint rect_b, blocker_b;
-
-      VISIBILITY ("RECT %dx%d%+d%+d BLOCKER %dx%d%+d%+d",
-                  MBWM_GEOMETRY(&rect), MBWM_GEOMETRY(&blocker));
-
-      /*
-       * If rect does not fit inside blocker in the X axis...
-       * Beware that ClutterGeometry.x and .y are signed, while .width
-       * and .height are unsigned and the type propagation rules of C
-       * makes sure we'll have trouble because the result is unsigned.
-       * It's only significant, though when you compare signeds and
-       * unsigneds.
-       */
-      if (!(blocker.x <= rect.x &&
-            rect.x+(gint)rect.width <= blocker.x+(gint)blocker.width))
-        continue;
+  VISIBILITY ("RECT %dx%d%+d%+d BLOCKERS %d",
+              MBWM_GEOMETRY(&rect), cairo_region_num_rectangles(blockers));
 
-      /* Because most windows will go edge->edge, just do a very simplistic
-       * clipping in the Y direction */
-      rect_b    = rect.y + rect.height;
-      blocker_b = blocker.y + blocker.height;
-
-      if (rect.y < blocker.y)
-        { /* top of rect is above blocker */
-          if (rect_b < blocker.y)
-            /* rect is above blocker */
-            continue;
-          if (rect_b < blocker_b)
-            /* rect is half above blocker, clip the rest */
-            rect.height -= rect_b - blocker.y;
-          else
-            { /* rect is split into two pieces by blocker */
-              rect.height = blocker.y - rect.y;
-              if (hd_render_manager_is_visible(blockers, rect))
-                /* upper half is visible */
-                return TRUE;
-
-              /* continue with the lower half */
-              rect.y = blocker_b;
-              rect.height = rect_b - blocker_b;
-            }
-        }
-      else if (rect.y < blocker_b)
-        { /* top of rect is inside blocker */
-          if (rect_b < blocker_b)
-            /* rect is confined in blocker */
-            return FALSE;
-          else
-            { /* rect is half below blocker, clip the rest */
-              rect.height -= blocker_b - rect.y;
-              rect.y       = blocker_b;
-            }
-        }
-      else
-        /* rect is completely below blocker */;
+  crect.x = rect.x;
+  crect.y = rect.y;
+  crect.width = rect.width;
+  crect.height = rect.height;
+  return cairo_region_contains_rectangle(blockers, &crect)
+    != CAIRO_REGION_OVERLAP_IN;
+}
 
-      if (blocker.x <= rect.x &&
-          rect.x+rect.width <= blocker.x+blocker.width)
-        {
-          if (blocker.y <= rect.y &&
-              rect.y+rect.height <= blocker.y+blocker.height)
-            {
-              /* If rect fits inside blocker in the Y axis,
-               * it is def. not visible */
-              return FALSE;
-            }
-          else if (rect.y < blocker.y)
-            {
-              /* safety - if the blocker sits in the middle of us
-               * it makes 2 rects, so don't use it */
-              if (blocker.y+blocker.height >= rect.y+rect.height)
-                /* rect out the bottom, clip to the blocker */
-                rect.height = blocker.y - rect.y;
-            }
-          else
-            { /* rect must be out the top, clip to the blocker */
-              rect.height = (rect.y + rect.height) -
-                            (blocker.y + blocker.height);
-              rect.y = blocker.y + blocker.height;
-            }
-        }
-    }
+/* Add @geo to @blockers. */
+static void
+hd_render_manager_add_blocker(cairo_region_t *blockers,
+                              const ClutterGeometry *geo)
+{
+  cairo_rectangle_int_t crect = { geo->x, geo->y, geo->width, geo->height };
 
-  return TRUE;
+  cairo_region_union_rectangle(blockers, &crect);
 }
 
 static
@@ -2749,7 +3003,7 @@ gboolean hd_render_manager_actor_opaque(ClutterActor *actor)
 static
 void hd_render_manager_append_geo_cb(ClutterActor *actor, gpointer data)
 {
-  GList **list = (GList**)data;
+  cairo_region_t *blockers = data;
   if (hd_render_manager_actor_opaque(actor))
     {
       ClutterGeometry geo;
@@ -2768,16 +3022,16 @@ void hd_render_manager_append_geo_cb(ClutterActor *actor, gpointer data)
       hd_render_manager_get_geo_for_current_screen(actor, &geo);
       if (!hd_render_manager_clip_geo (&geo))
         return;
-      *list = g_list_prepend(*list, g_memdup(&geo, sizeof(geo)));
+      hd_render_manager_add_blocker(blockers, &geo);
       VISIBILITY ("BLOCKER %dx%d%+d%+d", MBWM_GEOMETRY(&geo));
     }
 }
 
 void hd_render_manager_set_visibilities()
 { VISIBILITY ("SET VISIBILITIES");
+  static const cairo_rectangle_int_t nothing = { 0, 0, 0, 0 };
   HdRenderManagerPrivate *priv;
-  GList *blockers = 0;
-  GList *it;
+  cairo_region_t *blockers;
   gint i, n_elements;
   ClutterGeometry fullscreen_geo = {0, 0,
           hd_comp_mgr_get_current_screen_width (),
@@ -2795,10 +3049,15 @@ void hd_render_manager_set_visibilities()
       return;
     }
 
+  /* The area covered by the opaque actors we've seen so far.
+   * Reuse the same region every time, just empty it. */
+  blockers = priv->visibility_blockers;
+  cairo_region_intersect_rectangle(blockers, &nothing);
+
   /* first append all the top elements... */
   clutter_container_foreach(CLUTTER_CONTAINER(priv->app_top),
                             hd_render_manager_append_geo_cb,
-                            (gpointer)&blockers);
+                            blockers);
   /* Now check to see if the whole screen is covered, and if so
    * don't bother rendering blurring */
   if (hd_render_manager_is_visible(blockers, fullscreen_geo))
@@ -2836,7 +3095,7 @@ void hd_render_manager_set_visibilities()
               /* Add the geometry to our list of blockers and go to next... */
               if (hd_render_manager_actor_opaque(child))
                 {
-                  blockers = g_list_prepend(blockers, g_memdup(&geo, sizeof(geo)));
+                  hd_render_manager_add_blocker(blockers, &geo);
                   VISIBILITY ("MORE BLOCKER %dx%d%+d%+d", MBWM_GEOMETRY(&geo));
                 }
             }
@@ -2858,16 +3117,6 @@ void hd_render_manager_set_visibilities()
    * and make an error here, but there are actually many cases where this is
    * valid. See NB#117092 */
 
-  /* now free blockers */
-  it = g_list_first(blockers);
-  while (it)
-    {
-      g_free(it->data);
-      it = it->next;
-    }
-  g_list_free(blockers);
-  blockers = 0;
-
   /* Do we have a fullscreen client totally filling the screen? */
   /* This is voodo.  Please insert a comment here that explains
    * why to consider the state. */
@@ -2904,6 +3153,168 @@ void hd_render_manager_set_visibilities()
   hd_render_manager_set_input_viewport();
 }
 
+/*
+ * Occlusion culling.  set_visibilities() hides what the stacking says
+ * is covered, but it doesn't know about effects, opacity or the state
+ * logic keeping some actors shown.  So right before the stage is
+ * painted we walk our groups from the top and skip the paint of the
+ * actors which are completely covered by opaque windows above them,
+ * where and how they are at that moment.
+ */
+
+/* Skips the paint of @actor if it's culled.  Clones of it are still
+ * painted, they are somewhere else. */
+static void
+hd_render_manager_cull_paint(ClutterActor *actor)
+{
+  if (render_manager
+      && g_hash_table_lookup(render_manager->priv->culled, actor)
+      && !clutter_actor_is_in_clone_paint(actor))
+    g_signal_stop_emission_by_name(actor, "paint");
+}
+
+/* Make sure hd_render_manager_cull_paint() is called for @actor. */
+static void
+hd_render_manager_cull_watch(ClutterActor *actor)
+{
+  static GQuark quark;
+
+  if (G_UNLIKELY (!quark))
+    quark = g_quark_from_static_string ("hd-render-manager-cull");
+  if (g_object_get_qdata(G_OBJECT(actor), quark))
+    return;
+
+  g_object_set_qdata(G_OBJECT(actor), quark, GINT_TO_POINTER(1));
+  g_signal_connect(actor, "paint",
+                   G_CALLBACK(hd_render_manager_cull_paint), NULL);
+}
+
+/* Whether @actor's children can be culled one by one, ie. they are
+ * painted where they are.  The blur group paints them offscreen and
+ * only copies the result unchanged if it doesn't blur or zoom. */
+static gboolean
+hd_render_manager_cull_can_descend(ClutterActor *actor)
+{
+  HdRenderManagerPrivate *priv = render_manager->priv;
+
+  if (clutter_actor_has_clip(actor))
+    return FALSE;
+  if (actor == CLUTTER_ACTOR(priv->home_blur))
+    return !tidy_blur_group_source_buffered(actor)
+      && tidy_blur_group_get_zoom(actor) == 1;
+  return actor == CLUTTER_ACTOR(priv->app_top)
+    || actor == CLUTTER_ACTOR(priv->front)
+    || actor == CLUTTER_ACTOR(priv->blur_front);
+}
+
+/* If @actor is an opaque window add the area it covers on the screen
+ * to @blockers. */
+static void
+hd_render_manager_cull_add_blocker(ClutterActor *actor,
+                                   cairo_region_t *blockers)
+{
+  MBWMCompMgrClient *cc;
+  ClutterGeometry geo = { 0, 0, 0, 0 };
+
+  cc = g_object_get_data(G_OBJECT(actor), "HD-MBWMCompMgrClutterClient");
+  if (!cc || !cc->wm_client
+      || !hd_comp_mgr_client_is_opaque(HD_COMP_MGR_CLIENT(cc)))
+    return;
+  if (clutter_actor_get_paint_opacity(actor) < 0xff
+      || clutter_actor_has_clip(actor))
+    return;
+  /* Fails if the actor is rotated. */
+  if (!hd_util_get_actor_bounds(actor, &geo, NULL))
+    return;
+  hd_render_manager_add_blocker(blockers, &geo);
+}
+
+/* Cull the visible children of @group, topmost first. */
+static void
+hd_render_manager_cull_group(ClutterActor *group,
+                             const cairo_rectangle_int_t *screen,
+                             guint *nculled, guint *npixels)
+{
+  HdRenderManagerPrivate *priv = render_manager->priv;
+  ClutterActor *child;
+
+  for (child = clutter_actor_get_last_child(group); child;
+       child = clutter_actor_get_previous_sibling(child))
+    {
+      ClutterActorBox box;
+      cairo_rectangle_int_t area;
+      gint x2, y2;
+
+      if (!CLUTTER_ACTOR_IS_VISIBLE(child))
+        continue;
+      if (hd_render_manager_cull_can_descend(child))
+        {
+          hd_render_manager_cull_group(child, screen, nculled, npixels);
+          continue;
+        }
+
+      /* The paint box includes the children and effects of @child,
+       * there's no paint box if clutter can't tell what it paints. */
+      if (clutter_actor_get_paint_box(child, &box))
+        {
+          area.x = MAX(screen->x, (gint)floorf(box.x1));
+          area.y = MAX(screen->y, (gint)floorf(box.y1));
+          x2 = MIN(screen->x + screen->width,  (gint)ceilf(box.x2));
+          y2 = MIN(screen->y + screen->height, (gint)ceilf(box.y2));
+          area.width  = x2 - area.x;
+          area.height = y2 - area.y;
+
+          if (area.width > 0 && area.height > 0
+              && cairo_region_contains_rectangle(priv->cull_blockers, &area)
+                   == CAIRO_REGION_OVERLAP_IN)
+            {
+              g_hash_table_insert(priv->culled, child, child);
+              hd_render_manager_cull_watch(child);
+              (*nculled)++;
+              *npixels += area.width * area.height;
+              continue;
+            }
+        }
+
+      hd_render_manager_cull_add_blocker(child, priv->cull_blockers);
+    }
+}
+
+/* Runs before the children of the stage are painted. */
+static void
+hd_render_manager_cull(ClutterActor *stage)
+{
+  static const cairo_rectangle_int_t nothing = { 0, 0, 0, 0 };
+  HdRenderManagerPrivate *priv;
+  cairo_rectangle_int_t screen = { 0, 0,
+          hd_comp_mgr_get_current_screen_width (),
+          hd_comp_mgr_get_current_screen_height ()};
+  guint nculled, npixels;
+
+  if (!render_manager)
+    return;
+  priv = render_manager->priv;
+  if (STATE_IS_NON_COMP (priv->state)
+      || !CLUTTER_ACTOR_IS_VISIBLE(render_manager))
+    return;
+
+  cairo_region_intersect_rectangle(priv->cull_blockers, &nothing);
+  nculled = npixels = 0;
+  hd_render_manager_cull_group(CLUTTER_ACTOR(render_manager), &screen,
+                               &nculled, &npixels);
+  if (nculled)
+    hd_frame_stats_count_culled(nculled, npixels);
+}
+
+/* Runs after the stage is painted.  Don't keep pointers to actors
+ * which may be gone by the next paint. */
+static void
+hd_render_manager_cull_done(ClutterActor *stage)
+{
+  if (render_manager)
+    g_hash_table_remove_all(render_manager->priv->culled);
+}
+
 /* Called by hd-task-navigator when its state changes, as when notifications
  * arrive the button in the top-left may need to change */
 void hd_render_manager_update()
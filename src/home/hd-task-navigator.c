@@ -63,6 +63,8 @@
 #include "hd-title-bar.h"
 #include "hd-clutter-cache.h"
 #include "hd-transition.h"
+#include "hd-curve.h"
+#include "hd-animation.h"
 #include "hd-theme.h"
 #include "hd-util.h"
 #include "hd-gtk-style.h"
@@ -171,21 +173,21 @@
  */
 #if 1
 # define ZOOM_EFFECT_DURATION     \
-  hd_transition_get_int("task_nav", "zoom_duration", 250)
+  (hd_transition_get_config()->task_nav_zoom_duration)
 # define FLY_EFFECT_DURATION      \
-  hd_transition_get_int("task_nav", "fly_duration",  250)
+  (hd_transition_get_config()->task_nav_fly_duration)
 #else
 # define ZOOM_EFFECT_DURATION     1000
 # define FLY_EFFECT_DURATION      1000
 #endif
 
 #define NOTIFADE_IN_DURATION      \
-  hd_transition_get_int("task_nav", "notifade_in", 250)
+  (hd_transition_get_config()->task_nav_notifade_in)
 #define NOTIFADE_OUT_DURATION     \
-  hd_transition_get_int("task_nav", "notifade_out", 250)
+  (hd_transition_get_config()->task_nav_notifade_out)
 
 #define THUMB_DESATURATION_ENABLED     \
-  hd_transition_get_int("thp_tweaks", "thumb_desaturation", 0)
+  (hd_transition_get_config()->thumb_desaturation)
 
 /*
  *  These are based on the UX Guidance.
@@ -506,16 +508,17 @@ typedef struct
    *                            a thwin.
    * @timeline:                 Used when one wants to cancel an effect
    *                            outside of the timeline.
-   * @new_frame_cb_id, @timeline_complete_cb_id:
-   *                            %ClutterTimeline signal handler IDs
-   *                            @new_frame_cb_id can be 0.
+   * @tween_id:                 The %HdAnimation tween calling the
+   *                            effect's frame function, or 0.
+   * @timeline_complete_cb_id:  %ClutterTimeline signal handler ID
    * @frame_fun:                Just about any value that can identify
    *                            an effect.  Typically the effect's
-   *                            new-frame callback.  Can be %NULL.
+   *                            frame function.  Can be %NULL.
    */
   ClutterActor *actor;
   ClutterTimeline *timeline;
-  gulong new_frame_cb_id, timeline_complete_cb_id;
+  guint tween_id;
+  gulong timeline_complete_cb_id;
   gconstpointer effectid;
 
   /* Effect-specific context */
@@ -571,15 +574,16 @@ typedef struct
     {
       /*
        * @particles:                The little stars dancing in the background
-       *                            of the squeezing thumbnail.  @ang0 is the
-       *                            initial angle of a particle.
+       *                            of the squeezing thumbnail.  @cos0 and
+       *                            @sin0 are of the initial angle of
+       *                            a particle.
        * @all_particles:            Container of all the particles.  Used to
        *                            help positioning and setting and to set
        *                            uniform opacity.
        */
       struct
       {
-        gdouble ang0;
+        gfloat cos0, sin0;
         ClutterActor *particle;
       } particles[HDCM_UNMAP_PARTICLES];
       ClutterActor *all_particles;
@@ -1070,10 +1074,11 @@ has_effect (ClutterActor * actor, gconstpointer effectid)
 }
 
 /* Allocates an #EffectClosure and fills in the common fields.
- * Adds signals to @timeline. */
+ * @frame_fun is called with the progress of @timeline in every frame
+ * by %HdAnimation, together with all the other effects. */
 static EffectClosure *
 new_effect (ClutterTimeline * timeline, ClutterActor * actor,
-  void (*frame_fun)(ClutterTimeline *, gint, EffectClosure *),
+  void (*frame_fun)(gfloat, EffectClosure *),
   void (*complete_fun)(ClutterTimeline *, EffectClosure *))
 {
   EffectClosure *closure;
@@ -1082,11 +1087,10 @@ new_effect (ClutterTimeline * timeline, ClutterActor * actor,
   closure->actor = g_object_ref (actor);
 
   if (frame_fun)
-    closure->new_frame_cb_id = g_signal_connect (timeline, "new-frame",
-                                                 G_CALLBACK (frame_fun),
-                                                 closure);
+    closure->tween_id = hd_animation_add_for_timeline (timeline,
+                                  (HdAnimationFrameFunc)frame_fun, closure);
   else
-    closure->new_frame_cb_id = 0;
+    closure->tween_id = 0;
   closure->timeline_complete_cb_id = g_signal_connect (timeline, "completed",
                                               G_CALLBACK (complete_fun),
                                               closure);
@@ -1115,8 +1119,7 @@ free_effect (ClutterTimeline * timeline, EffectClosure * closure)
     g_critical ("closure not in Effects");
   g_assert (timeline == closure->timeline);
 
-  if (closure->new_frame_cb_id)
-    g_signal_handler_disconnect (timeline, closure->new_frame_cb_id);
+  hd_animation_remove (closure->tween_id);
   g_signal_handler_disconnect (timeline, closure->timeline_complete_cb_id);
   g_object_unref (timeline);
   g_object_unref (closure->actor);
@@ -1139,7 +1142,7 @@ free_effect (ClutterTimeline * timeline, EffectClosure * closure)
  */
 static EffectClosure *
 linear_effect (ClutterTimeline * timeline, ClutterActor * actor,
-               void (*frame_fun)(ClutterTimeline *, gint, EffectClosure *),
+               void (*frame_fun)(gfloat, EffectClosure *),
                void (*complete_fun)(ClutterTimeline *, EffectClosure *),
                ...)
 {
@@ -1256,12 +1259,10 @@ add_effect_closure (ClutterTimeline * timeline,
  * while @clutter_set_fun is (#ClutterActor, ptype, ptype). */
 #define DEFINE_RMS_EFFECT(effect, ptype,                            \
                           clutter_get_fun, clutter_set_fun)         \
-/* @effect's %ClutterTimeline::new-frame callback. */               \
+/* @effect's frame function. */                                    \
 static void                                                         \
-effect##_effect_frame (ClutterTimeline * timeline, gint frame,      \
-                       EffectClosure * closure)                     \
+effect##_effect_frame (gfloat now, EffectClosure * closure)         \
 {                                                                   \
-  gfloat now = clutter_timeline_get_progress (timeline);            \
   clutter_set_fun (closure->actor,                                  \
                    linear_effect_value (closure, 0, now),           \
                    linear_effect_value (closure, 1, now));          \
@@ -1478,10 +1479,10 @@ get_clip(ClutterActor * actor, gfloat *appwgw, gfloat *appwgh)
 /* Fading effect {{{ */
 /* frame_fun of fade() */
 static void
-fade_frame (ClutterTimeline * timeline, gint frame, EffectClosure * closure)
+fade_frame (gfloat now, EffectClosure * closure)
 {
-  clutter_actor_set_opacity (closure->actor, linear_effect_value (closure, 0,
-    clutter_timeline_get_progress (timeline)));
+  clutter_actor_set_opacity (closure->actor,
+                             linear_effect_value (closure, 0, now));
 }
 
 /* complete_fun of fade() */
@@ -1568,13 +1569,67 @@ turnoff_fun (gdouble x0, gdouble y0, gdouble x1, gdouble y1, gdouble t)
   return ((y1-y0)*cos(t) + (y0*cos(x1)-y1*cos(x0))) / (cos(x1)-cos(x0));
 }
 
-/* ClutterTimeline::new-frame callback for turnoff_effect(). */
+/* A turnoff_fun() between (@x0, @y0) and (@x1, @y1) as it's used
+ * by turnoff_effect_frame() between @from and @to in the timeline. */
+typedef struct
+{
+  gdouble x0, y0, x1, y1;
+  gdouble from, to;
+} TurnoffSegment;
+
+static const TurnoffSegment Turnoff_scale_x = { 0.3, 1, 0.64, 0.1, 0.3, 0.8 };
+static const TurnoffSegment Turnoff_scale_y = { 0.0, 1, 0.4,  0.1, 0.0, 0.4 };
+static const TurnoffSegment Turnoff_radius  = { 0.5, 8, 1,    72,  0.5, 1.0 };
+
+/* The segments above and the particles' opacity, baked by
+ * turnoff_bake_curves() so that we needn't call cos() in every frame. */
+static struct
+{
+  gboolean baked;
+  HdCurve scale_x, scale_y, radius, twinkle;
+} Turnoff_curves;
+
+static float
+turnoff_segment_fun (float x, gpointer segp)
+{
+  const TurnoffSegment *seg = segp;
+  return turnoff_fun (seg->x0, seg->y0, seg->x1, seg->y1,
+                      seg->from + (seg->to - seg->from) * x);
+}
+
+static float
+turnoff_twinkle_fun (float x, gpointer unused)
+{
+  return sin (M_PI * x);
+}
+
 static void
-turnoff_effect_frame (ClutterTimeline * timeline, gint frame,
-                      EffectClosure * closure)
+turnoff_bake_curves (void)
+{
+  if (Turnoff_curves.baked)
+    return;
+
+  hd_curve_bake (&Turnoff_curves.scale_x, turnoff_segment_fun,
+                 (gpointer)&Turnoff_scale_x);
+  hd_curve_bake (&Turnoff_curves.scale_y, turnoff_segment_fun,
+                 (gpointer)&Turnoff_scale_y);
+  hd_curve_bake (&Turnoff_curves.radius, turnoff_segment_fun,
+                 (gpointer)&Turnoff_radius);
+  hd_curve_bake (&Turnoff_curves.twinkle, turnoff_twinkle_fun, NULL);
+  Turnoff_curves.baked = TRUE;
+}
+
+/* Returns the baked @curve of @seg at @t of the timeline. */
+static inline gfloat
+turnoff_curve (const HdCurve * curve, const TurnoffSegment * seg, gdouble t)
 {
-  gdouble now;
+  return hd_curve_eval (curve, (t - seg->from) / (seg->to - seg->from));
+}
 
+/* Frame function of turnoff_effect(). */
+static void
+turnoff_effect_frame (gfloat now, EffectClosure * closure)
+{
   // thwin scale-y    0.0 .. 0.4  cosine 1.0 .. 0.1
   // thwin scale-x    0.3 .. 0.64 cosine 1.0 .. 0.1
   // thwin opacity    0.5 .. 1.0  linear 255 .. 0.0
@@ -1582,13 +1637,14 @@ turnoff_effect_frame (ClutterTimeline * timeline, gint frame,
   // particle radius  0.5 .. 1.0  cosine 8.0 .. 72
   // particle angle   0.5 .. 1.0  linear 0.0 .. PI/2
   // particle scale   0.5 .. 1.0  linear 1.0 .. 0.5
-  now = clutter_timeline_get_progress (timeline);
 
   /* @thwin */
   if (now <= 0.8)
     clutter_actor_set_scale (closure->actor,
-                 now <= 0.3 ? 1.0 : turnoff_fun (0.3, 1, 0.64, 0.1, now),
-                 now >= 0.4 ? 0.1 : turnoff_fun (0.0, 1, 0.4,  0.1, now));
+                 now <= 0.3 ? 1.0 : turnoff_curve (&Turnoff_curves.scale_x,
+                                                   &Turnoff_scale_x, now),
+                 now >= 0.4 ? 0.1 : turnoff_curve (&Turnoff_curves.scale_y,
+                                                   &Turnoff_scale_y, now));
   if (0.5 <= now)
     clutter_actor_set_opacity (closure->actor, 510 - 510*now);
 
@@ -1596,23 +1652,31 @@ turnoff_effect_frame (ClutterTimeline * timeline, gint frame,
   if (0.5 <= now)
     {
       guint i;
-      gdouble t, all_rad;
+      gdouble t, all_rad, cost, sint;
 
+      /* The particles turn PI/2 * @t from their initial angle.
+       * Rotate them by the cosine and sine of that. */
       t = 2*now-1;
-      all_rad = turnoff_fun (0.5, 8, 1, 72, now);
+      cost = 1 - hd_transition_ease_in (t);
+      sint = hd_transition_ease_out (t);
+      all_rad = turnoff_curve (&Turnoff_curves.radius, &Turnoff_radius, now);
       for (i = 0; i < G_N_ELEMENTS (closure->particles); i++)
         {
-          gdouble ang, rad;
+          gdouble cosa, sina, rad;
 
-          ang = closure->particles[i].ang0 + M_PI/2 * t;
+          cosa = closure->particles[i].cos0*cost
+            - closure->particles[i].sin0*sint;
+          sina = closure->particles[i].sin0*cost
+            + closure->particles[i].cos0*sint;
           rad = all_rad * i/G_N_ELEMENTS (closure->particles);
           clutter_actor_set_position (closure->particles[i].particle,
-                                      cos(ang)*rad, sin(ang)*rad);
+                                      cosa*rad, sina*rad);
           clutter_actor_set_scale (closure->particles[i].particle,
                                    1.5-now, 1.5-now);
         }
 
-      clutter_actor_set_opacity (closure->all_particles, 255*sin(M_PI*t));
+      clutter_actor_set_opacity (closure->all_particles,
+                          255*hd_curve_eval (&Turnoff_curves.twinkle, t));
       if (!clutter_actor_is_visible (closure->all_particles))
         clutter_actor_show (closure->all_particles);
     }
@@ -1641,6 +1705,7 @@ turnoff_effect (ClutterTimeline * timeline, ClutterActor * thwin)
   gfloat centerx, centery;
   EffectClosure *closure;
 
+  turnoff_bake_curves ();
   closure = new_effect (timeline, thwin,
                         turnoff_effect_frame,
                         turnoff_effect_complete);
@@ -1663,6 +1728,7 @@ turnoff_effect (ClutterTimeline * timeline, ClutterActor * thwin)
   for (i = 0; i < G_N_ELEMENTS (closure->particles); i++)
     {
       ClutterActor *particle;
+      gdouble ang0;
 
       particle = hd_clutter_cache_get_texture (HD_THEME_IMG_CLOSING_PARTICLE,
                                                TRUE);
@@ -1673,7 +1739,9 @@ turnoff_effect (ClutterTimeline * timeline, ClutterActor * thwin)
 
       /* All particles has an own initial angle from which they go half
        * a circle until the end of animimation. */
-      closure->particles[i].ang0 = 2*M_PI * g_random_double ();
+      ang0 = 2*M_PI * g_random_double ();
+      closure->particles[i].cos0 = cos (ang0);
+      closure->particles[i].sin0 = sin (ang0);
       closure->particles[i].particle = particle;
     }
 }
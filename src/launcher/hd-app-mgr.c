@@ -105,6 +105,13 @@ struct _HdAppMgrPrivate
   /* All the running apps we know about. */
   GList *running_apps;
 
+  /* @running_apps in an array, and pid and launcher -> position + 1
+   * in it of the first app with them, for hd_app_mgr_match_window().
+   * Rebuilt when @running_index_dirty. */
+  GPtrArray  *running_index;
+  GHashTable *running_by_pid, *running_by_launcher;
+  gboolean    running_index_dirty;
+
   /* Each one of these lists contain different HdRunningApps. */
   GQueue *queues[NUM_QUEUES];
 
@@ -148,6 +155,7 @@ enum
   APP_LOADING_FAIL,
   APP_CRASHED,
   NOT_ENOUGH_MEMORY,  /* The boolean argument tells if it was waking up. */
+  RUNNING_APPS_CHANGED,
 
   LAST_SIGNAL
 };
@@ -296,6 +304,7 @@ static gboolean hd_app_mgr_loading_timeout (HdRunningApp *app);
 static gboolean hd_app_mgr_init_done_timeout (HdAppMgr *self);
 
 static void hd_app_mgr_kill_all_prestarted (void);
+static void hd_app_mgr_running_apps_changed (void);
 
 /* The HdLauncher singleton */
 static HdAppMgr *the_app_mgr = NULL;
@@ -314,6 +323,50 @@ hd_app_mgr_get (void)
   return the_app_mgr;
 }
 
+/* To be called whenever an app is added to or removed from
+ * running_apps or its pid or launcher changes. */
+static void
+hd_app_mgr_running_apps_changed (void)
+{
+  if (the_app_mgr)
+    {
+      HD_APP_MGR_GET_PRIVATE (the_app_mgr)->running_index_dirty = TRUE;
+      g_signal_emit (the_app_mgr, app_mgr_signals[RUNNING_APPS_CHANGED], 0);
+    }
+}
+
+static void
+hd_app_mgr_index_running_apps (HdAppMgrPrivate *priv)
+{
+  GList *l;
+
+  if (!priv->running_index_dirty)
+    return;
+
+  g_ptr_array_set_size (priv->running_index, 0);
+  g_hash_table_remove_all (priv->running_by_pid);
+  g_hash_table_remove_all (priv->running_by_launcher);
+  for (l = priv->running_apps; l; l = l->next)
+    {
+      HdRunningApp *app = HD_RUNNING_APP (l->data);
+      HdLauncherApp *launcher = hd_running_app_get_launcher_app (app);
+      GPid pid = hd_running_app_get_pid (app);
+      gpointer pos;
+
+      g_ptr_array_add (priv->running_index, app);
+      pos = GUINT_TO_POINTER (priv->running_index->len);
+      if (pid && !g_hash_table_lookup (priv->running_by_pid,
+                                       GINT_TO_POINTER (pid)))
+        g_hash_table_insert (priv->running_by_pid,
+                             GINT_TO_POINTER (pid), pos);
+      if (launcher && !g_hash_table_lookup (priv->running_by_launcher,
+                                            launcher))
+        g_hash_table_insert (priv->running_by_launcher, launcher, pos);
+    }
+
+  priv->running_index_dirty = FALSE;
+}
+
 static void
 hd_app_mgr_class_init (HdAppMgrClass *klass)
 {
@@ -365,6 +418,13 @@ hd_app_mgr_class_init (HdAppMgrClass *klass)
                   0, NULL, NULL,
                   g_cclosure_marshal_VOID__BOOLEAN,
                   G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+  app_mgr_signals[RUNNING_APPS_CHANGED] =
+    g_signal_new (I_("running-apps-changed"),
+                  HD_TYPE_APP_MGR,
+                  G_SIGNAL_RUN_FIRST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 
   /* Bind D-Bus info. */
   dbus_g_object_type_install_info (HD_TYPE_APP_MGR,
@@ -419,6 +479,10 @@ hd_app_mgr_init (HdAppMgr *self)
   for (int i = 0; i < NUM_QUEUES; i++)
     priv->queues[i] = g_queue_new ();
 
+  priv->running_index = g_ptr_array_new ();
+  priv->running_by_pid = g_hash_table_new (NULL, NULL);
+  priv->running_by_launcher = g_hash_table_new (NULL, NULL);
+
   priv->tree = hd_launcher_tree_new ();
   hd_launcher_tree_ensure_user_menu ();
   g_signal_connect (priv->tree, "finished",
@@ -664,6 +728,14 @@ hd_app_mgr_dispose (GObject *gobject)
       priv->running_apps = NULL;
     }
 
+  if (priv->running_index)
+    {
+      g_ptr_array_free (priv->running_index, TRUE);
+      g_hash_table_destroy (priv->running_by_pid);
+      g_hash_table_destroy (priv->running_by_launcher);
+      priv->running_index = NULL;
+    }
+
   for (int i = 0; i < NUM_QUEUES; i++)
     {
       if (priv->queues[i])
@@ -839,7 +911,10 @@ hd_app_mgr_launch (HdLauncherApp *launcher)
     {
       /* We just created this running app, so add to list or get rid of it. */
       if (result)
-        priv->running_apps = g_list_prepend (priv->running_apps, app);
+        {
+          priv->running_apps = g_list_prepend (priv->running_apps, app);
+          hd_app_mgr_running_apps_changed ();
+        }
       else
         g_object_unref (app);
     }
@@ -1001,6 +1076,7 @@ hd_app_mgr_start (HdRunningApp *app)
           if (result)
             {
               hd_running_app_set_pid (app, pid);
+              hd_app_mgr_running_apps_changed ();
               /* Watch the child. */
               g_child_watch_add (pid,
                                  (GChildWatchFunc)_hd_app_mgr_child_exit,
@@ -1168,6 +1244,7 @@ hd_app_mgr_app_closed (HdRunningApp *app)
   hd_app_mgr_remove_from_queue (QUEUE_HIBERNATABLE, app);
 
   hd_running_app_set_pid (app, 0);
+  hd_app_mgr_running_apps_changed ();
   hd_running_app_set_state (app, HD_APP_STATE_INACTIVE);
 
   if (launcher &&
@@ -1185,6 +1262,7 @@ hd_app_mgr_app_closed (HdRunningApp *app)
         {
           g_object_unref (app);
           priv->running_apps = g_list_delete_link (priv->running_apps, link);
+          hd_app_mgr_running_apps_changed ();
         }
     }
 }
@@ -1222,6 +1300,7 @@ hd_app_mgr_populate_tree_finished (HdLauncherTree *tree, gpointer data)
       new = HD_LAUNCHER_APP (hd_launcher_tree_find_item (tree,
                                  hd_running_app_get_id (app)));
       hd_running_app_set_launcher_app (app, new);
+      hd_app_mgr_running_apps_changed ();
       if (old && !new)
         {
           /* The .desktop file no longer exists, but the app could be running. */
@@ -1269,6 +1348,7 @@ hd_app_mgr_populate_tree_finished (HdLauncherTree *tree, gpointer data)
       /* Create a new running app for it. */
       HdRunningApp *app = hd_running_app_new (launcher);
       priv->running_apps = g_list_prepend (priv->running_apps, app);
+      hd_app_mgr_running_apps_changed ();
       hd_app_mgr_prestartable (app, TRUE);
     }
 
@@ -1348,6 +1428,7 @@ hd_app_mgr_hibernate (HdRunningApp *app)
       hd_running_app_set_state (app, HD_APP_STATE_HIBERNATED);
       hd_app_mgr_move_queue (QUEUE_HIBERNATABLE, QUEUE_HIBERNATED, app);
       hd_running_app_set_pid (app, 0);
+      hd_app_mgr_running_apps_changed ();
       hd_app_mgr_remove_from_queue (QUEUE_PRESTARTABLE, app);
     }
   else
@@ -2377,6 +2458,7 @@ _hd_app_mgr_request_app_pid_cb (DBusGProxy *proxy, guint pid,
   g_debug ("%s: Got pid %d for %s\n", __FUNCTION__,
            pid, hd_running_app_get_service (app));
   hd_running_app_set_pid (app, pid);
+  hd_app_mgr_running_apps_changed ();
 }
 
 gboolean
@@ -2395,6 +2477,7 @@ hd_app_mgr_request_app_pid (HdRunningApp *app)
     {
       g_warning ("%s: Can't get the pid for a non-dbus app.\n", __FUNCTION__);
       hd_running_app_set_pid (app, 0);
+      hd_app_mgr_running_apps_changed ();
     }
 
   org_freedesktop_DBus_get_connection_unix_process_id_async (proxy,
@@ -2409,65 +2492,53 @@ hd_app_mgr_match_window (const char *res_name,
 {
   HdAppMgrPrivate *priv = HD_APP_MGR_GET_PRIVATE (hd_app_mgr_get ());
   HdRunningApp *app = NULL;
-  HdLauncherApp *launcher = NULL;
+  GPtrArray *launchers;
   GList *link = NULL;
+  guint i, best;
 
-  /* First we need to look if there's already a running app for this. */
-  link = priv->running_apps;
-  while (link)
+  /* The launchers matching the window, in tree order. */
+  launchers = g_ptr_array_new ();
+  hd_launcher_tree_match_window (priv->tree, res_name, res_class, launchers);
+
+  /* First we need to look if there's already a running app for this:
+   * the first one with the same pid or with one of these launchers. */
+  hd_app_mgr_index_running_apps (priv);
+  best = pid ? GPOINTER_TO_UINT (g_hash_table_lookup (priv->running_by_pid,
+                                                      GINT_TO_POINTER (pid)))
+             : 0;
+  for (i = 0; i < launchers->len; i++)
     {
-      app = HD_RUNNING_APP (link->data);
-      launcher = hd_running_app_get_launcher_app (app);
+      guint pos = GPOINTER_TO_UINT (g_hash_table_lookup (
+                                        priv->running_by_launcher,
+                                        g_ptr_array_index (launchers, i)));
+      if (pos && (!best || pos < best))
+        best = pos;
+    }
 
-      /* If we know the running app's pid and it's the same, we found it. */
-      GPid app_pid = hd_running_app_get_pid (app);
-      if (app_pid && (app_pid == pid))
-        return app;
+  if (best)
+    {
+      app = g_ptr_array_index (priv->running_index, best - 1);
 
-      /* Now we look if the app's launcher matches the window. */
-      if (launcher)
+      /* If it matched by the launcher, now we have a good pid. */
+      if (!hd_running_app_get_pid (app))
         {
-          if (hd_launcher_app_match_window (launcher, res_name, res_class))
-            {
-              /* Now we have a good pid. */
-              if (!app_pid)
-                hd_running_app_set_pid (app, pid);
-              return app;
-            }
+          hd_running_app_set_pid (app, pid);
+          hd_app_mgr_running_apps_changed ();
         }
-
-      /* Next. */
-      link = link->next;
+      goto out;
     }
 
   /* Well, there wasn't any already running app, so we'll have to look for
    * a launcher that matches.
    */
-  GList *launchers = hd_launcher_tree_get_items (priv->tree);
-  app = NULL;
-
-  if (res_name || res_class)
+  if (launchers->len)
     {
-      while (launchers)
-        {
-          /* Filter non-applications. */
-          if (hd_launcher_item_get_item_type (HD_LAUNCHER_ITEM (launchers->data)) !=
-              HD_APPLICATION_LAUNCHER)
-            goto next;
-
-          launcher = HD_LAUNCHER_APP (launchers->data);
-          if (hd_launcher_app_match_window (launcher, res_name, res_class))
-            {
-              /* Let's make a new running app for it. */
-              app = hd_running_app_new (launcher);
-              hd_running_app_set_pid (app, pid);
-              priv->running_apps = g_list_prepend (priv->running_apps, app);
-              return app;
-            }
-
-          next:
-          launchers = g_list_next (launchers);
-        }
+      /* Let's make a new running app for it. */
+      app = hd_running_app_new (g_ptr_array_index (launchers, 0));
+      hd_running_app_set_pid (app, pid);
+      priv->running_apps = g_list_prepend (priv->running_apps, app);
+      hd_app_mgr_running_apps_changed ();
+      goto out;
     }
 
   /*
@@ -2482,8 +2553,11 @@ hd_app_mgr_match_window (const char *res_name,
       if (hd_running_app_get_state (app) == HD_APP_STATE_LOADING)
         {
           if (!hd_running_app_get_pid (app))
-            hd_running_app_set_pid (app, pid);
-          return app;
+            {
+              hd_running_app_set_pid (app, pid);
+              hd_app_mgr_running_apps_changed ();
+            }
+          goto out;
         }
 
       link = link->next;
@@ -2496,7 +2570,10 @@ hd_app_mgr_match_window (const char *res_name,
   app = hd_running_app_new (NULL);
   hd_running_app_set_pid (app, pid);
   priv->running_apps = g_list_prepend (priv->running_apps, app);
+  hd_app_mgr_running_apps_changed ();
 
+out:
+  g_ptr_array_free (launchers, TRUE);
   return app;
 }
 
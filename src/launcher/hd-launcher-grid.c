@@ -81,7 +81,9 @@ struct _HdLauncherGridPrivate
   gint transition_depth;
   /* Do we move the icons all together or in sequence? for launcher_in transitions */
   gboolean transition_sequenced;
-  /* List of keyframes used on transitions like _IN and _IN_SUB */
+  /* List of keyframes used on transitions like _IN and _IN_SUB,
+   * owned by @transition_config. */
+  const HdTransitionConfig *transition_config;
   HdKeyFrameList *transition_keyframes; // ramp for tile movement
   HdKeyFrameList *transition_keyframes_label; // ramp for label alpha values
   HdKeyFrameList *transition_keyframes_icon; // ramp for icon alpha values
@@ -796,25 +798,23 @@ hd_launcher_grid_transition_begin(HdLauncherGrid *grid,
   if (trans_type == HD_LAUNCHER_PAGE_TRANSITION_IN ||
       trans_type == HD_LAUNCHER_PAGE_TRANSITION_IN_SUB)
     {
-      priv->transition_sequenced =
-            hd_transition_get_int(
-                      hd_launcher_page_get_transition_string(trans_type),
-                      "sequenced",
-                      0);
+      const HdTransitionLauncherIn *in;
+
+      /* Hold on to the keyframes until the end of the transition even
+       * if transitions.ini is reloaded meanwhile. */
+      hd_launcher_grid_transition_end (grid);
+      priv->transition_config =
+        hd_transition_config_ref (hd_transition_get_config ());
+      in = trans_type == HD_LAUNCHER_PAGE_TRANSITION_IN
+        ? &priv->transition_config->launcher_in
+        : &priv->transition_config->launcher_in_sub;
+
+      priv->transition_sequenced = in->sequenced;
       if (priv->transition_sequenced)
         {
-          grid->priv->transition_keyframes =
-            hd_transition_get_keyframes(
-                      hd_launcher_page_get_transition_string(trans_type),
-                      "keyframes", "0,1");
-          grid->priv->transition_keyframes_label =
-            hd_transition_get_keyframes(
-                      hd_launcher_page_get_transition_string(trans_type),
-                      "keyframes_label", "0,1");
-          grid->priv->transition_keyframes_icon =
-                 hd_transition_get_keyframes(
-                      hd_launcher_page_get_transition_string(trans_type),
-                      "keyframes_icon", "0,1");
+          priv->transition_keyframes = in->keyframes;
+          priv->transition_keyframes_label = in->keyframes_label;
+          priv->transition_keyframes_icon = in->keyframes_icon;
         }
 
       /* Reset adjustments so the view is always back to 0,0 */
@@ -830,20 +830,13 @@ void
 hd_launcher_grid_transition_end(HdLauncherGrid *grid)
 {
   /* Free anything we may have allocated for the transition here */
-  if (grid->priv->transition_keyframes)
+  grid->priv->transition_keyframes = 0;
+  grid->priv->transition_keyframes_label = 0;
+  grid->priv->transition_keyframes_icon = 0;
+  if (grid->priv->transition_config)
     {
-      hd_key_frame_list_free(grid->priv->transition_keyframes);
-      grid->priv->transition_keyframes = 0;
-    }
-  if (grid->priv->transition_keyframes_label)
-    {
-      hd_key_frame_list_free(grid->priv->transition_keyframes_label);
-      grid->priv->transition_keyframes_label = 0;
-    }
-  if (grid->priv->transition_keyframes_icon)
-    {
-      hd_key_frame_list_free(grid->priv->transition_keyframes_icon);
-      grid->priv->transition_keyframes_icon = 0;
+      hd_transition_config_unref (grid->priv->transition_config);
+      grid->priv->transition_config = NULL;
     }
 }
 
@@ -0,0 +1,264 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include "hd-launcher-index.h"
+
+/* An application id in lowercase, for matching WM_CLASS against the
+ * start of ids ignoring case. */
+typedef struct
+{
+  gchar *id;
+  guint  pos;
+} HdLauncherIndexId;
+
+struct _HdLauncherIndex
+{
+  /* All the items in the order they were added. */
+  GPtrArray  *items;
+
+  /* id and service -> item */
+  GHashTable *by_id, *by_service;
+
+  /* WM_CLASS and executable -> GSList of positions in @items
+   * of the applications with them. */
+  GHashTable *by_wm_class, *by_exec;
+
+  /* HdLauncherIndexId of the applications, sorted by id when
+   * @ids_sorted. */
+  GArray     *ids;
+  gboolean    ids_sorted;
+};
+
+static void
+hd_launcher_index_free_positions (gpointer list)
+{
+  g_slist_free (list);
+}
+
+HdLauncherIndex *
+hd_launcher_index_new (void)
+{
+  HdLauncherIndex *index;
+
+  index = g_new0 (HdLauncherIndex, 1);
+  index->items = g_ptr_array_new ();
+  index->by_id = g_hash_table_new (g_str_hash, g_str_equal);
+  index->by_service = g_hash_table_new (g_str_hash, g_str_equal);
+  index->by_wm_class = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                     hd_launcher_index_free_positions);
+  index->by_exec = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                     hd_launcher_index_free_positions);
+  index->ids = g_array_new (FALSE, FALSE, sizeof (HdLauncherIndexId));
+
+  return index;
+}
+
+void
+hd_launcher_index_free (HdLauncherIndex *index)
+{
+  guint i;
+
+  if (!index)
+    return;
+
+  for (i = 0; i < index->ids->len; i++)
+    g_free (g_array_index (index->ids, HdLauncherIndexId, i).id);
+  g_array_free (index->ids, TRUE);
+  g_hash_table_destroy (index->by_exec);
+  g_hash_table_destroy (index->by_wm_class);
+  g_hash_table_destroy (index->by_service);
+  g_hash_table_destroy (index->by_id);
+  g_ptr_array_free (index->items, TRUE);
+  g_free (index);
+}
+
+/* The strings are the item's own, so we don't copy them. */
+static void
+hd_launcher_index_add_first (GHashTable *table, const gchar *key,
+                             gpointer item)
+{
+  if (key && !g_hash_table_lookup (table, key))
+    g_hash_table_insert (table, (gpointer)key, item);
+}
+
+static void
+hd_launcher_index_add_position (GHashTable *table, const gchar *key,
+                                guint pos)
+{
+  GSList *positions;
+
+  if (!key)
+    return;
+
+  /* Positions are added in increasing order, keep them like that. */
+  positions = g_hash_table_lookup (table, key);
+  if (positions)
+    g_slist_append (positions, GUINT_TO_POINTER (pos));
+  else
+    g_hash_table_insert (table, (gpointer)key,
+                         g_slist_prepend (NULL, GUINT_TO_POINTER (pos)));
+}
+
+void
+hd_launcher_index_add (HdLauncherIndex *index, gpointer item,
+                       const gchar *id)
+{
+  hd_launcher_index_add_first (index->by_id, id, item);
+  g_ptr_array_add (index->items, item);
+}
+
+void
+hd_launcher_index_add_app (HdLauncherIndex *index, gpointer item,
+                           const gchar *id, const gchar *service,
+                           const gchar *wm_class, const gchar *exec)
+{
+  guint pos = index->items->len;
+
+  hd_launcher_index_add (index, item, id);
+  hd_launcher_index_add_first (index->by_service, service, item);
+  hd_launcher_index_add_position (index->by_wm_class, wm_class, pos);
+  hd_launcher_index_add_position (index->by_exec, exec, pos);
+
+  if (id)
+    {
+      HdLauncherIndexId lid;
+
+      lid.id = g_ascii_strdown (id, -1);
+      lid.pos = pos;
+      g_array_append_val (index->ids, lid);
+      index->ids_sorted = FALSE;
+    }
+}
+
+gpointer
+hd_launcher_index_find (HdLauncherIndex *index, const gchar *id)
+{
+  return id ? g_hash_table_lookup (index->by_id, id) : NULL;
+}
+
+gpointer
+hd_launcher_index_find_service (HdLauncherIndex *index,
+                                const gchar *service)
+{
+  return service ? g_hash_table_lookup (index->by_service, service) : NULL;
+}
+
+static gint
+hd_launcher_index_cmp_id (gconstpointer a, gconstpointer b)
+{
+  return strcmp (((const HdLauncherIndexId *)a)->id,
+                 ((const HdLauncherIndexId *)b)->id);
+}
+
+static gint
+hd_launcher_index_cmp_pos (gconstpointer a, gconstpointer b)
+{
+  guint pa = *(const guint *)a, pb = *(const guint *)b;
+
+  return pa < pb ? -1 : pa > pb;
+}
+
+static void
+hd_launcher_index_add_positions (GArray *matches, GSList *positions)
+{
+  for (; positions; positions = positions->next)
+    {
+      guint pos = GPOINTER_TO_UINT (positions->data);
+      g_array_append_val (matches, pos);
+    }
+}
+
+void
+hd_launcher_index_match_window (HdLauncherIndex *index,
+                                const gchar *res_name,
+                                const gchar *res_class,
+                                GPtrArray *apps)
+{
+  GArray *matches;
+  guint i, last;
+
+  if (!res_name && !res_class)
+    return;
+
+  matches = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (res_class)
+    {
+      gchar *prefix;
+      guint lo, hi;
+      gsize len;
+
+      hd_launcher_index_add_positions (matches,
+                         g_hash_table_lookup (index->by_wm_class, res_class));
+
+      /* The ids starting with @res_class, ignoring case, are a range
+       * of the sorted ids. */
+      if (!index->ids_sorted)
+        {
+          g_array_sort (index->ids, hd_launcher_index_cmp_id);
+          index->ids_sorted = TRUE;
+        }
+      prefix = g_ascii_strdown (res_class, -1);
+      len = strlen (prefix);
+      lo = 0;
+      hi = index->ids->len;
+      while (lo < hi)
+        {
+          guint mid = (lo + hi) / 2;
+
+          if (strcmp (g_array_index (index->ids, HdLauncherIndexId, mid).id,
+                      prefix) < 0)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+      for (; lo < index->ids->len; lo++)
+        {
+          const HdLauncherIndexId *lid;
+
+          lid = &g_array_index (index->ids, HdLauncherIndexId, lo);
+          if (strncmp (lid->id, prefix, len))
+            break;
+          g_array_append_val (matches, lid->pos);
+        }
+      g_free (prefix);
+    }
+
+  if (res_name)
+    hd_launcher_index_add_positions (matches,
+                         g_hash_table_lookup (index->by_exec, res_name));
+
+  /* An app may match in more than one way. */
+  g_array_sort (matches, hd_launcher_index_cmp_pos);
+  last = G_MAXUINT;
+  for (i = 0; i < matches->len; i++)
+    {
+      guint pos = g_array_index (matches, guint, i);
+
+      if (pos != last)
+        g_ptr_array_add (apps, g_ptr_array_index (index->items, pos));
+      last = pos;
+    }
+
+  g_array_free (matches, TRUE);
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_LAUNCHER_INDEX_H__
+#define __HD_LAUNCHER_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Looks up launcher items by id and service name, and finds the
+ * applications a window with a given WM_CLASS belongs to, like
+ * hd_launcher_app_match_window() does for every app in turn, without
+ * going through them all.  Items are added in tree order and the
+ * results keep that order.  It only knows about strings and pointers,
+ * so it can be used without a launcher tree. */
+typedef struct _HdLauncherIndex HdLauncherIndex;
+
+HdLauncherIndex *hd_launcher_index_new          (void);
+void             hd_launcher_index_free         (HdLauncherIndex *index);
+
+/* Adds an item which is not an application. */
+void             hd_launcher_index_add          (HdLauncherIndex *index,
+                                                 gpointer         item,
+                                                 const gchar     *id);
+/* Adds an application which windows can be matched to. */
+void             hd_launcher_index_add_app      (HdLauncherIndex *index,
+                                                 gpointer         item,
+                                                 const gchar     *id,
+                                                 const gchar     *service,
+                                                 const gchar     *wm_class,
+                                                 const gchar     *exec);
+
+/* Return the first item added with @id or @service. */
+gpointer         hd_launcher_index_find         (HdLauncherIndex *index,
+                                                 const gchar     *id);
+gpointer         hd_launcher_index_find_service (HdLauncherIndex *index,
+                                                 const gchar     *service);
+
+/* Appends all applications matching a window with @res_name and
+ * @res_class to @apps, in the order they were added. */
+void             hd_launcher_index_match_window (HdLauncherIndex *index,
+                                                 const gchar     *res_name,
+                                                 const gchar     *res_class,
+                                                 GPtrArray       *apps);
+
+G_END_DECLS
+
+#endif /* __HD_LAUNCHER_INDEX_H__ */
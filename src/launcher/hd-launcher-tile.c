@@ -33,10 +33,12 @@
 #include <clutter/clutter.h>
 #include <hildon/hildon-defines.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "hd-gtk-style.h"
 #include "tidy/tidy-highlight.h"
 #include "hd-transition.h"
+#include "hd-animation.h"
 
 #define I_(str) (g_intern_static_string ((str)))
 #define HD_PARAM_READWRITE (G_PARAM_READWRITE | \
@@ -56,7 +58,9 @@ struct _HdLauncherTilePrivate
   ClutterActor *icon;
   ClutterActor *label;
   TidyHighlight *icon_glow;
-  ClutterTimeline *glow_timeline;
+  /* The tween taking @glow_amount from @glow_from to @glow_to. */
+  guint glow_tween;
+  gfloat glow_from, glow_to;
 
   ClutterActor *click_area;
 
@@ -105,9 +109,8 @@ static gboolean hd_launcher_tile_touched (ClutterActor *actor,
                                           ClutterEvent *event,
                                           ClutterActor *tile);
 
-static void hd_launcher_on_glow_frame(ClutterTimeline *timeline,
-                                      gint msecs,
-                                      ClutterActor *actor);
+static void hd_launcher_on_glow_frame(gfloat progress,
+                                      HdLauncherTile *tile);
 
 static void hd_launcher_tile_allocate (ClutterActor          *self,
                                        const ClutterActorBox *box,
@@ -207,10 +210,6 @@ hd_launcher_tile_init (HdLauncherTile *tile)
                            G_CALLBACK (hd_launcher_tile_button_release), tile);
   g_signal_connect(priv->click_area, "touch-event",
                    G_CALLBACK (hd_launcher_tile_touched), tile);
-
-  tile->priv->glow_timeline = clutter_timeline_new(200);
-  g_signal_connect(tile->priv->glow_timeline, "new-frame",
-                   G_CALLBACK (hd_launcher_on_glow_frame), tile);
 }
 
 HdLauncherTile *
@@ -512,14 +511,13 @@ hd_launcher_tile_set_property (GObject      *gobject,
 }
 
 static void
-hd_launcher_on_glow_frame(ClutterTimeline *timeline,
-                          gint msecs,
-                          ClutterActor *actor)
+hd_launcher_on_glow_frame(gfloat progress,
+                          HdLauncherTile *tile)
 {
-  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (actor);
+  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
 
-  priv->glow_amount = msecs /
-                      (float)clutter_timeline_get_duration(timeline);
+  priv->glow_amount = priv->glow_from
+                      + (priv->glow_to - priv->glow_from) * progress;
   if (priv->icon_glow)
     tidy_highlight_set_amount(priv->icon_glow,
                               priv->glow_amount * priv->glow_radius);
@@ -532,6 +530,12 @@ hd_launcher_on_glow_frame(ClutterTimeline *timeline,
     clutter_actor_hide(CLUTTER_ACTOR(priv->icon_glow));
 }
 
+static void
+hd_launcher_tile_glow_done(gpointer tile)
+{
+  HD_LAUNCHER_TILE_GET_PRIVATE (tile)->glow_tween = 0;
+}
+
 static void
 hd_launcher_tile_set_glow(HdLauncherTile *tile, gboolean glow, gboolean hard)
 {
@@ -540,7 +544,8 @@ hd_launcher_tile_set_glow(HdLauncherTile *tile, gboolean glow, gboolean hard)
   float glow_brightness;
   guint duration;
 
-  clutter_timeline_stop(priv->glow_timeline);
+  hd_animation_remove(priv->glow_tween);
+  priv->glow_tween = 0;
 
   /* If we're already there, skip */
   if ((glow && priv->glow_amount==1) ||
@@ -565,18 +570,14 @@ hd_launcher_tile_set_glow(HdLauncherTile *tile, gboolean glow, gboolean hard)
     return;
   }
 
-  clutter_timeline_set_duration(priv->glow_timeline,
-          hd_transition_get_int("launcher_glow",
-              glow ? "duration_in" : "duration_out",
-              500));
-
-  clutter_timeline_set_direction(priv->glow_timeline,
-       glow ? CLUTTER_TIMELINE_FORWARD : CLUTTER_TIMELINE_BACKWARD);
+  duration = hd_transition_get_int("launcher_glow",
+                                   glow ? "duration_in" : "duration_out",
+                                   500);
 
-  /* Set our start position based on how much glow we had previously */
-  duration = clutter_timeline_get_duration(priv->glow_timeline);
-  clutter_timeline_advance(priv->glow_timeline,
-                           (guint)(priv->glow_amount*duration));
+  /* Start from how much glow we had previously, and take as long as
+   * the rest of the way would take. */
+  priv->glow_from = priv->glow_amount;
+  priv->glow_to = glow ? 1 : 0;
 
   /* set our glow colour from the theme */
   glow_brightness = hd_transition_get_double("launcher_glow", "brightness", 1);
@@ -588,7 +589,10 @@ hd_launcher_tile_set_glow(HdLauncherTile *tile, gboolean glow, gboolean hard)
   /* load our glow radius */
   priv->glow_radius = hd_transition_get_double("launcher_glow", "radius", 8);
 
-  clutter_timeline_start(priv->glow_timeline);
+  priv->glow_tween = hd_animation_add(
+                  duration * fabsf(priv->glow_to - priv->glow_from),
+                  (HdAnimationFrameFunc)hd_launcher_on_glow_frame,
+                  hd_launcher_tile_glow_done, tile);
 }
 
 static gboolean
@@ -677,11 +681,10 @@ hd_launcher_tile_dispose (GObject *gobject)
       g_source_remove (priv->press_timeout);
       priv->press_timeout = 0;
     }
-  if (priv->glow_timeline)
+  if (priv->glow_tween)
     {
-      clutter_timeline_stop(priv->glow_timeline);
-      g_object_unref(priv->glow_timeline);
-      priv->glow_timeline = 0;
+      hd_animation_remove(priv->glow_tween);
+      priv->glow_tween = 0;
     }
   if (priv->label)
     {
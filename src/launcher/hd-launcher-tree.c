@@ -4,6 +4,7 @@
 
 #include "hildon-desktop.h"
 #include "hd-launcher-tree.h"
+#include "hd-launcher-index.h"
 
 #include "hd-gtk-style.h"
 
@@ -39,6 +40,9 @@ struct _HdLauncherTreePrivate
    */
   GList *items_list;
 
+  /* @items_list by id, service and window matching. */
+  HdLauncherIndex *index;
+
   /* this is the actual tree of launchers, as
    * built by parsing the applications.menu file
    */
@@ -67,6 +71,31 @@ static void hd_launcher_tree_handle_tree_changed (GMenuTree *menu_tree,
 
 static void hd_launcher_tree_handle_theme_changed (HdLauncherTree *tree);
 
+static HdLauncherIndex *
+hd_launcher_tree_build_index (GList *items)
+{
+  HdLauncherIndex *index = hd_launcher_index_new ();
+
+  for (; items; items = items->next)
+    {
+      HdLauncherItem *item = HD_LAUNCHER_ITEM (items->data);
+
+      if (hd_launcher_item_get_item_type (item) == HD_APPLICATION_LAUNCHER)
+        {
+          HdLauncherApp *app = HD_LAUNCHER_APP (item);
+          hd_launcher_index_add_app (index, app,
+                                     hd_launcher_item_get_id (item),
+                                     hd_launcher_app_get_service (app),
+                                     hd_launcher_app_get_wm_class (app),
+                                     hd_launcher_app_get_exec (app));
+        }
+      else
+        hd_launcher_index_add (index, item, hd_launcher_item_get_id (item));
+    }
+
+  return index;
+}
+
 static WalkThreadData *
 walk_thread_data_new (HdLauncherTree *tree)
 {
@@ -118,6 +147,8 @@ walk_thread_done_idle (gpointer user_data)
       g_list_foreach (priv->items_list, (GFunc) g_object_unref, NULL);
       g_list_free (priv->items_list);
       priv->items_list = data->items;
+      hd_launcher_index_free (priv->index);
+      priv->index = hd_launcher_tree_build_index (priv->items_list);
       priv->active_walk = NULL;
       gmenu_tree_item_unref (data->root);
       g_signal_emit (data->tree, tree_signals[FINISHED], 0);
@@ -269,6 +300,8 @@ hd_launcher_tree_finalize (GObject *gobject)
   g_list_foreach (priv->items_list, (GFunc) g_object_unref, NULL);
   g_list_free (priv->items_list);
   priv->items_list = NULL;
+  hd_launcher_index_free (priv->index);
+  priv->index = NULL;
 
   if (priv->root)
     {
@@ -459,33 +492,15 @@ hd_launcher_tree_get_size (HdLauncherTree *tree)
   return g_list_length (tree->priv->items_list);
 }
 
-static gint
-_compare_item_id (gconstpointer a, gconstpointer b)
-{
-  return g_strcmp0(hd_launcher_item_get_id(HD_LAUNCHER_ITEM (a)),
-                   (const gchar *)b);
-}
-
 HdLauncherItem *
 hd_launcher_tree_find_item (HdLauncherTree *tree, const gchar *id)
 {
   g_return_val_if_fail (HD_IS_LAUNCHER_TREE (tree), NULL);
   HdLauncherTreePrivate *priv = HD_LAUNCHER_TREE_GET_PRIVATE (tree);
 
-  GList *res = g_list_find_custom (priv->items_list, id,
-                                   (GCompareFunc)_compare_item_id);
-  if (res)
-    return res->data;
-  return NULL;
-}
-
-static gint
-_compare_service (gconstpointer a, gconstpointer b)
-{
-  if (!HD_IS_LAUNCHER_APP(a))
-    return !0;
-  return g_strcmp0(hd_launcher_app_get_service(HD_LAUNCHER_APP (a)),
-                   (const gchar *)b);
+  if (!priv->index)
+    return NULL;
+  return hd_launcher_index_find (priv->index, id);
 }
 
 HdLauncherApp *
@@ -494,11 +509,24 @@ hd_launcher_tree_find_app_by_service (HdLauncherTree *tree, const gchar *service
   g_return_val_if_fail (HD_IS_LAUNCHER_TREE (tree), NULL);
   HdLauncherTreePrivate *priv = HD_LAUNCHER_TREE_GET_PRIVATE (tree);
 
-  GList *res = g_list_find_custom (priv->items_list, service,
-                                   (GCompareFunc)_compare_service);
-  if (res)
-    return res->data;
-  return NULL;
+  if (!priv->index)
+    return NULL;
+  return hd_launcher_index_find_service (priv->index, service);
+}
+
+/* Appends the apps hd_launcher_app_match_window() is TRUE for
+ * to @apps, in tree order. */
+void
+hd_launcher_tree_match_window (HdLauncherTree *tree,
+                               const gchar *res_name,
+                               const gchar *res_class,
+                               GPtrArray *apps)
+{
+  g_return_if_fail (HD_IS_LAUNCHER_TREE (tree));
+  HdLauncherTreePrivate *priv = HD_LAUNCHER_TREE_GET_PRIVATE (tree);
+
+  if (priv->index)
+    hd_launcher_index_match_window (priv->index, res_name, res_class, apps);
 }
 
 #define CREATE_MODE (S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
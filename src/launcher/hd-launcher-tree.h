@@ -71,6 +71,10 @@ HdLauncherItem *hd_launcher_tree_find_item   (HdLauncherTree *tree,
 HdLauncherApp  *hd_launcher_tree_find_app_by_service (
                                               HdLauncherTree *tree,
                                               const gchar *service);
+void            hd_launcher_tree_match_window (HdLauncherTree *tree,
+                                               const gchar *res_name,
+                                               const gchar *res_class,
+                                               GPtrArray *apps);
 
 /* Utility functions. */
 void hd_launcher_tree_ensure_user_menu (void);
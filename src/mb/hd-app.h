@@ -51,6 +51,10 @@ struct HdApp
   Bool         non_composited_read;
   Bool         non_composited;
   Bool         force_composited;
+  /* whether the window has the property at all */
+  Bool         non_composited_explicit;
+  /* unredirected by hd_comp_mgr_auto_unredirect() */
+  Bool         auto_non_composited;
 
   Window       detransitised_from;  
 };
@@ -72,6 +72,9 @@ hd_atoms_init (Display * xdpy, Atom * atoms)
     "_HILDON_TEXTURE_CLIENT_MESSAGE_OFFSET",
     "_HILDON_TEXTURE_CLIENT_MESSAGE_SCALE",
     "_HILDON_TEXTURE_CLIENT_MESSAGE_PARENT",
+    "_HILDON_TEXTURE_CLIENT_MESSAGE_BUFFERS",
+    "_HILDON_TEXTURE_CLIENT_MESSAGE_PRESENT",
+    "_HILDON_TEXTURE_CLIENT_MESSAGE_RELEASE",
     "_HILDON_TEXTURE_CLIENT_READY",
 
     "_HILDON_LOADING_SCREENSHOT",
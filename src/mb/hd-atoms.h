@@ -67,6 +67,9 @@ typedef enum HdAtoms
   HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_OFFSET,
   HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_SCALE,
   HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_PARENT,
+  HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_BUFFERS,
+  HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_PRESENT,
+  HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_RELEASE,
   HD_ATOM_HILDON_TEXTURE_CLIENT_READY,
 
   HD_ATOM_HILDON_LOADING_SCREENSHOT,
@@ -39,6 +39,10 @@
 #include "hd-render-manager.h"
 #include "hd-title-bar.h"
 #include "hd-orientation-lock.h"
+#include "hd-clutter-cache.h"
+#include "hd-frame-stats.h"
+#include "hd-unredirect.h"
+#include "hd-animation.h"
 #include "launcher/hd-app-mgr.h"
 #include "launcher/hd-launcher-editor.h"
 
@@ -54,6 +58,8 @@
 #include <clutter/x11/clutter-x11.h>
 
 #include "../tidy/tidy-blur-group.h"
+#include "../tidy/tidy-cached-group.h"
+#include "../tidy/tidy-util.h"
 
 #include <dbus/dbus-glib-bindings.h>
 #include <mce/dbus-names.h>
@@ -64,6 +70,7 @@
 #include <signal.h>
 #include <math.h>
 #include <unistd.h>
+#include <fnmatch.h>
 #include <sys/time.h>
 
 #define OPERATOR_APPLET_ID         "_HILDON_OPERATOR_APPLET"
@@ -79,6 +86,22 @@
 
 HdTaskNavigator *hd_task_navigator;
 
+/* Counters for the damage coalescing, dumped by
+ * hd_comp_mgr_dump_debug_info().  Areas are in pixels. */
+typedef struct
+{
+  guint   events;       /* update-area signals received */
+  guint   flushes;      /* number of times the queue was flushed */
+  guint   redraws;      /* clipped redraws queued on the stage */
+  guint64 area_damaged; /* sum of the areas reported by update-area */
+  guint64 area_redrawn; /* sum of the clip areas actually queued */
+
+  /* The same for the most recent flush only. */
+  guint   last_flush_events;
+  guint   last_flush_redraws;
+  guint   last_flush_area;
+} HdCompMgrDamageStats;
+
 struct HdCompMgrPrivate
 {
   MBWindowManagerClient *desktop;
@@ -110,6 +133,9 @@ struct HdCompMgrPrivate
   /* Track changes to the PORTRAIT properties. */
   unsigned long          property_changed_cb_id;
 
+  /* Track geometry changes for hd_util_client_obscured(). */
+  unsigned long          configure_cb_id;
+
   /* MCE D-Bus Proxy */
   DBusGProxy            *mce_proxy;
 
@@ -123,16 +149,56 @@ struct HdCompMgrPrivate
 
   /* GConf client for orientation lock. */
   GConfClient* gconf_client;
+
+  /* Damage coalescing: ClutterActor -> cairo_rectangle_int_t around
+   * the areas reported by update-area since the last flush.  The flush
+   * happens in an idle with higher priority than the stage redraw, so
+   * it is always done before the next paint. */
+  GHashTable            *damage;
+  guint                  damage_flush_id;
+  HdCompMgrDamageStats   damage_stats;
+
+  /* Automatic unredirection, see hd_comp_mgr_auto_unredirect().
+   * @unredirect_serial is the transitions.ini we read the settings
+   * from and @auto_unredirecting is set while we change the state.
+   * @unredirect_top is what hd_comp_mgr_unredirect_top() found in
+   * the stack if @unredirect_top_valid. */
+  HdUnredirect          *unredirect;
+  GTimer                *unredirect_clock;
+  guint                  unredirect_serial;
+  gboolean               unredirect_enabled;
+  gboolean               auto_unredirecting;
+  guint                  unredirect_id;
+  MBWindowManagerClient *unredirect_top;
+  gboolean               unredirect_top_valid;
 };
 
 /*
  * A helper object to store manager's per-client data
  */
 
+/* What we keep asking X about a window for the portrait and app
+ * decisions.  Read when the client is registered and dropped when
+ * WM_CLASS, WM_WINDOW_ROLE or _NET_WM_PID changes, see
+ * hd_comp_mgr_client_get_meta(). */
+typedef struct
+{
+  gboolean      valid;
+  gchar        *res_name, *res_class, *role;
+  GPid          pid;
+
+  /* hd_app_mgr_match_window() of the above, referenced, and the
+   * app_match_serial it was made at, 0 if it hasn't been made yet. */
+  guint         app_matched;
+  HdRunningApp *app;
+} HdCompMgrClientMeta;
+
 struct HdCompMgrClientPrivate
 {
   HdRunningApp *app;
 
+  HdCompMgrClientMeta   meta;
+
   guint                 hibernation_key;
   gboolean              can_hibernate : 1;
 
@@ -142,6 +208,26 @@ struct HdCompMgrClientPrivate
 extern gboolean hd_dbus_display_is_off;
 static guint portrait_freshness_counter;
 
+/* Bumped whenever the running apps or the launchers change, which
+ * makes every HdCompMgrClientMeta.app stale. */
+static guint app_match_serial = 1;
+
+/* A list of WM_CLASS names from transitions.ini. */
+typedef struct
+{
+  GHashTable *names;    /* exact names */
+  GPtrArray  *patterns; /* the ones with wildcards, for fnmatch() */
+} HdNameList;
+
+/* The [thp_tweaks] settings the portrait decisions need, parsed
+ * once per transitions.ini reload by hd_comp_mgr_portrait_tweaks(). */
+static struct
+{
+  guint       serial;
+  gboolean    forcerotation;
+  HdNameList  whitelist, blacklist;
+} portrait_tweaks;
+
 HdRunningApp *hd_comp_mgr_client_get_app_key (HdCompMgrClient *client,
                                                HdCompMgr *hmgr);
 
@@ -156,6 +242,176 @@ hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
 
 static MBWindowManagerClient *hd_comp_mgr_determine_current_app (void);
 
+static gboolean hd_comp_mgr_covers_auto_unredirected (MBWindowManagerClient *c);
+static MBWindowManagerClient *hd_comp_mgr_unredirect_candidate (HdCompMgr *hmgr);
+static void hd_comp_mgr_unredirect_invalidate (HdCompMgr *hmgr);
+static void hd_comp_mgr_unredirect_damaged (HdCompMgr *hmgr,
+                                            MBWindowManagerClient *candidate,
+                                            gboolean damaged);
+
+static gboolean hd_comp_mgr_app_forces_landscape (HdRunningApp *app);
+
+/* Parses the whitespace-separated names in @str. */
+static void
+hd_name_list_compile (HdNameList *list, const gchar *str)
+{
+  gchar **names;
+  guint i;
+
+  if (list->names)
+    {
+      g_hash_table_destroy (list->names);
+      g_ptr_array_foreach (list->patterns, (GFunc)g_free, NULL);
+      g_ptr_array_free (list->patterns, TRUE);
+    }
+  list->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  list->patterns = g_ptr_array_new ();
+
+  names = g_strsplit_set (str ? str : "", " \t,;", -1);
+  for (i = 0; names[i]; i++)
+    if (!*names[i])
+      g_free (names[i]);
+    else if (strpbrk (names[i], "*?["))
+      g_ptr_array_add (list->patterns, names[i]);
+    else
+      g_hash_table_replace (list->names, names[i], names[i]);
+  /* The strings are the list's now. */
+  g_free (names);
+}
+
+static gboolean
+hd_name_list_match (const HdNameList *list, const gchar *name)
+{
+  guint i;
+
+  if (!name || !list->names)
+    return FALSE;
+  if (g_hash_table_lookup (list->names, name))
+    return TRUE;
+  for (i = 0; i < list->patterns->len; i++)
+    if (!fnmatch (g_ptr_array_index (list->patterns, i), name, 0))
+      return TRUE;
+  return FALSE;
+}
+
+static void
+hd_comp_mgr_portrait_tweaks (void)
+{
+  guint serial;
+  gchar *str;
+
+  serial = hd_transition_get_file_serial ();
+  if (portrait_tweaks.whitelist.names && serial == portrait_tweaks.serial)
+    return;
+  portrait_tweaks.serial = serial;
+
+  portrait_tweaks.forcerotation = hd_transition_get_int ("thp_tweaks",
+                                                         "forcerotation", 0);
+  str = hd_transition_get_string ("thp_tweaks", "whitelist", "");
+  hd_name_list_compile (&portrait_tweaks.whitelist, str);
+  g_free (str);
+  str = hd_transition_get_string ("thp_tweaks", "blacklist", "");
+  hd_name_list_compile (&portrait_tweaks.blacklist, str);
+  g_free (str);
+}
+
+static void
+hd_comp_mgr_client_meta_clear (HdCompMgrClientMeta *meta)
+{
+  g_free (meta->res_name);
+  g_free (meta->res_class);
+  g_free (meta->role);
+  if (meta->app)
+    g_object_unref (meta->app);
+  memset (meta, 0, sizeof (*meta));
+}
+
+static void
+hd_comp_mgr_client_meta_read (MBWindowManagerClient *c,
+                              HdCompMgrClientMeta *meta)
+{
+  MBWindowManager *wm = c->wmref;
+  XClassHint class_hint;
+  gchar *role;
+
+  memset (&class_hint, 0, sizeof (class_hint));
+  mb_wm_util_async_trap_x_errors (wm->xdpy);
+  if (!XGetClassHint (wm->xdpy, c->window->xwindow, &class_hint))
+    memset (&class_hint, 0, sizeof (class_hint));
+  role = hd_util_get_win_prop_data_and_validate (wm->xdpy,
+                        c->window->xwindow,
+                        hd_comp_mgr_get_atom (HD_COMP_MGR (wm->comp_mgr),
+                                              HD_ATOM_WM_WINDOW_ROLE),
+                        XA_STRING, 8, 0, NULL);
+  mb_wm_util_async_untrap_x_errors ();
+
+  meta->res_name  = g_strdup (class_hint.res_name);
+  meta->res_class = g_strdup (class_hint.res_class);
+  meta->role      = g_strdup (role);
+  meta->pid       = c->window->pid;
+  meta->valid     = TRUE;
+
+  if (class_hint.res_class)
+    XFree (class_hint.res_class);
+  if (class_hint.res_name)
+    XFree (class_hint.res_name);
+  if (role)
+    XFree (role);
+}
+
+/* Returns the class, name and role of @c's window, asking X only the
+ * first time.  Clients without a HdCompMgrClient (yet) are not cached,
+ * their data is valid until the next call. */
+static HdCompMgrClientMeta *
+hd_comp_mgr_client_get_meta (MBWindowManagerClient *c)
+{
+  static HdCompMgrClientMeta uncached;
+  HdCompMgrClientMeta *meta;
+
+  if (c->cm_client && HD_COMP_MGR_CLIENT (c->cm_client)->priv)
+    meta = &HD_COMP_MGR_CLIENT (c->cm_client)->priv->meta;
+  else
+    {
+      hd_comp_mgr_client_meta_clear (&uncached);
+      meta = &uncached;
+    }
+
+  if (!meta->valid)
+    hd_comp_mgr_client_meta_read (c, meta);
+  return meta;
+}
+
+/* Returns the running app @meta matches, looking it up again only
+ * if the apps or launchers changed since the last time. */
+static HdRunningApp *
+hd_comp_mgr_client_meta_get_app (HdCompMgrClientMeta *meta)
+{
+  if (meta->app_matched != app_match_serial)
+    {
+      HdRunningApp *app;
+
+      /* Matching may add a running app itself, which is accounted for. */
+      app = hd_app_mgr_match_window (meta->res_name, meta->res_class,
+                                     meta->pid);
+      if (app)
+        g_object_ref (app);
+      if (meta->app)
+        g_object_unref (meta->app);
+      meta->app = app;
+      meta->app_matched = app_match_serial;
+    }
+  return meta->app;
+}
+
+/* Forget the app of every client, including the misses: the window
+ * may match one of the new apps or launchers. */
+static void
+hd_comp_mgr_apps_changed (void)
+{
+  if (!++app_match_serial)
+    app_match_serial = 1;
+}
+
 static MBWMCompMgrClient *
 hd_comp_mgr_client_new (MBWindowManagerClient * client)
 {
@@ -223,13 +479,10 @@ HdRunningApp *
 hd_comp_mgr_client_get_app_key (HdCompMgrClient *client, HdCompMgr *hmgr)
 {
   MBWindowManagerClient *wm_client;
-  MBWindowManager       *wm;
-  XClassHint             class_hint;
-  Status                 status = 0;
   HdRunningApp          *app = NULL;
   HdCompMgrClientPrivate *priv = client->priv;
+  HdCompMgrClientMeta   *meta = &priv->meta;
 
-  wm = MB_WM_COMP_MGR (hmgr)->wm;
   wm_client = MB_WM_COMP_MGR_CLIENT (client)->wm_client;
 
   /* We only lookup the app for main windows and dialogs. */
@@ -237,21 +490,13 @@ hd_comp_mgr_client_get_app_key (HdCompMgrClient *client, HdCompMgr *hmgr)
       MB_WM_CLIENT_CLIENT_TYPE (wm_client) != MBWMClientTypeDialog)
     return NULL;
 
-  memset(&class_hint, 0, sizeof(XClassHint));
-
-  /* We don't care about X errors here, because they will be reported
-   * in the return value of XGetWindowAttributes */
-  mb_wm_util_async_trap_x_errors (wm->xdpy);
-
-  status = XGetClassHint(wm->xdpy, wm_client->window->xwindow, &class_hint);
-
-  mb_wm_util_async_untrap_x_errors();
-  if (!status)
-    goto out;
+  /* wm_client->cm_client is not set yet, so fill our cache directly. */
+  if (!meta->valid)
+    hd_comp_mgr_client_meta_read (wm_client, meta);
+  if (!meta->res_name && !meta->res_class)
+    return NULL;
 
-  app = hd_app_mgr_match_window (class_hint.res_name,
-                                 class_hint.res_class,
-                                 wm_client->window->pid);
+  app = hd_comp_mgr_client_meta_get_app (meta);
 
   if (app)
     {
@@ -260,17 +505,8 @@ hd_comp_mgr_client_get_app_key (HdCompMgrClient *client, HdCompMgr *hmgr)
        * - The role, if present.
        * - The window name.
        */
-      gchar *role = NULL;
       gchar *key = NULL;
       gint level = 0;
-      role = hd_util_get_win_prop_data_and_validate
-                         (wm_client->wmref->xdpy,
-                          wm_client->window->xwindow,
-                          hmgr->priv->atoms[HD_ATOM_WM_WINDOW_ROLE],
-                          XA_STRING,
-                          8,
-                          0,
-                          NULL);
 
       if (MB_WM_CLIENT_CLIENT_TYPE (wm_client) == MBWMClientTypeApp)
         {
@@ -280,25 +516,16 @@ hd_comp_mgr_client_get_app_key (HdCompMgrClient *client, HdCompMgr *hmgr)
 
       key = g_strdup_printf ("%s/%s/%s/%d",
               hd_running_app_get_id (app),
-              class_hint.res_class ? class_hint.res_class : "",
-              role ? role : "",
+              meta->res_class ? meta->res_class : "",
+              meta->role ? meta->role : "",
               level);
       g_debug ("%s: app %s, window key: %s\n", __FUNCTION__,
                 hd_running_app_get_id (app),
                 key);
       priv->hibernation_key = g_str_hash (key);
-      if (role)
-        XFree (role);
       g_free (key);
     }
 
- out:
-  if (class_hint.res_class)
-    XFree(class_hint.res_class);
-
-  if (class_hint.res_name)
-    XFree(class_hint.res_name);
-
   return app;
 }
 
@@ -350,6 +577,7 @@ hd_comp_mgr_client_destroy (MBWMObject* obj)
       priv->app = NULL;
     }
 
+  hd_comp_mgr_client_meta_clear (&priv->meta);
   g_free (priv);
 }
 
@@ -403,6 +631,19 @@ hd_comp_mgr_client_has_video_overlay (HdCompMgrClient *hclient)
   return priv->has_video_overlay;
 }
 
+/* Whether @hclient's window hides everything below it: it has neither
+ * an alpha channel nor a shape.  The opacity of its actor is up to
+ * the caller to check. */
+gboolean
+hd_comp_mgr_client_is_opaque (HdCompMgrClient *hclient)
+{
+  MBWindowManagerClient *c;
+
+  c = MB_WM_COMP_MGR_CLIENT (hclient)->wm_client;
+  return c && c->window && !c->is_argb32
+    && !mb_wm_theme_is_client_shaped (c->wmref->theme, c);
+}
+
 HdRunningApp *
 hd_comp_mgr_client_get_app (HdCompMgrClient *hclient)
 {
@@ -445,6 +686,8 @@ static void hd_comp_mgr_unmap_notify
 static void hd_comp_mgr_turn_on (MBWMCompMgr *mgr);
 static void hd_comp_mgr_effect (MBWMCompMgr *mgr, MBWindowManagerClient *c,
                                 MBWMCompMgrClientEvent event);
+static Bool hd_comp_mgr_client_configured (XConfigureEvent *event,
+                                           HdCompMgr *hmgr);
 static Bool hd_comp_mgr_client_property_changed (XPropertyEvent *event,
                                                  HdCompMgr *hmgr);
 
@@ -544,6 +787,10 @@ hd_comp_mgr_init (MBWMObject *obj, va_list vap)
    */
   priv->app_mgr = g_object_ref (hd_app_mgr_get ());
   hd_app_mgr_set_render_manager (G_OBJECT (priv->render_manager));
+  g_signal_connect_swapped (priv->app_mgr, "running-apps-changed",
+                            G_CALLBACK (hd_comp_mgr_apps_changed), NULL);
+  g_signal_connect_swapped (hd_app_mgr_get_tree (), "finished",
+                            G_CALLBACK (hd_comp_mgr_apps_changed), NULL);
 
   /* NB -- home must be constructed before constructing the switcher;
    */
@@ -580,10 +827,26 @@ hd_comp_mgr_init (MBWMObject *obj, va_list vap)
 			   NULL,
                (GDestroyNotify)mb_wm_object_unref);
 
+  /* ClutterActor -> cairo_rectangle_int_t of the damage not yet
+   * flushed. */
+  priv->damage =
+    g_hash_table_new_full (g_direct_hash,
+                           g_direct_equal,
+                           (GDestroyNotify)g_object_unref,
+                           g_free);
+
+  hd_frame_stats_init ();
+
+  priv->unredirect = hd_unredirect_new ();
+  priv->unredirect_clock = g_timer_new ();
+
   /* Be notified about all X window property changes around here. */
   priv->property_changed_cb_id = mb_wm_main_context_x_event_handler_add (
                    cmgr->wm->main_ctx, None, PropertyNotify,
                    (MBWMXEventFunc)hd_comp_mgr_client_property_changed, cmgr);
+  priv->configure_cb_id = mb_wm_main_context_x_event_handler_add (
+                   cmgr->wm->main_ctx, None, ConfigureNotify,
+                   (MBWMXEventFunc)hd_comp_mgr_client_configured, cmgr);
 
   if (hd_orientation_lock_is_locked_to_portrait ())
     hd_render_manager_set_state(HDRM_STATE_HOME_PORTRAIT);
@@ -622,6 +885,10 @@ hd_comp_mgr_destroy (MBWMObject *obj)
     g_hash_table_destroy (priv->hibernating_apps);
   if (priv->app_mgr)
     {
+      g_signal_handlers_disconnect_by_func (hd_app_mgr_get_tree (),
+                                            hd_comp_mgr_apps_changed, NULL);
+      g_signal_handlers_disconnect_by_func (priv->app_mgr,
+                                            hd_comp_mgr_apps_changed, NULL);
       g_object_unref (priv->app_mgr);
       priv->app_mgr = NULL;
     }
@@ -631,6 +898,10 @@ hd_comp_mgr_destroy (MBWMObject *obj)
                                      MB_WM_COMP_MGR (obj)->wm->main_ctx,
                                      PropertyNotify,
                                      priv->property_changed_cb_id);
+  mb_wm_main_context_x_event_handler_remove (
+                                     MB_WM_COMP_MGR (obj)->wm->main_ctx,
+                                     ConfigureNotify,
+                                     priv->configure_cb_id);
 
   if (priv->mce_proxy)
     {
@@ -640,6 +911,17 @@ hd_comp_mgr_destroy (MBWMObject *obj)
 
   if (priv->stack_sync)
     g_source_remove (priv->stack_sync);
+
+  if (priv->damage_flush_id)
+    g_source_remove (priv->damage_flush_id);
+  if (priv->damage)
+    g_hash_table_destroy (priv->damage);
+
+  if (priv->unredirect_id)
+    g_source_remove (priv->unredirect_id);
+  hd_unredirect_free (priv->unredirect);
+  if (priv->unredirect_clock)
+    g_timer_destroy (priv->unredirect_clock);
 }
 
 HdCompMgrClient *
@@ -662,6 +944,16 @@ hd_comp_mgr_client_prefers_compositing (MBWindowManagerClient *c)
   return !(HD_IS_APP (c) && hd_comp_mgr_is_non_composited (c, FALSE));
 }
 
+/* Called on #ConfigureNotify of any window: whatever changed,
+ * the obscuredness of the clients may have changed too. */
+static Bool
+hd_comp_mgr_client_configured (XConfigureEvent *event, HdCompMgr *hmgr)
+{
+  hd_util_client_obscured_invalidate ();
+  hd_comp_mgr_unredirect_invalidate (hmgr);
+  return True;
+}
+
 /* Called on #PropertyNotify to handle changes to
  * _HILDON_PORTRAIT_MODE_SUPPORT and _HILDON_PORTRAIT_MODE_REQUEST
  * and _HILDON_APP_KILLABLE and _HILDON_ABLE_TO_HIBERNATE
@@ -686,6 +978,17 @@ hd_comp_mgr_client_property_changed (XPropertyEvent *event, HdCompMgr *hmgr)
 
   wm = MB_WM_COMP_MGR (hmgr)->wm;
 
+  if (event->atom == XA_WM_CLASS
+      || event->atom == hd_comp_mgr_get_atom (hmgr, HD_ATOM_WM_WINDOW_ROLE)
+      || event->atom == wm->atoms[MBWM_ATOM_NET_WM_PID])
+    {
+      /* Read them again and rematch the app when next needed. */
+      c = mb_wm_managed_client_from_xwindow (wm, event->window);
+      if (c && c->cm_client)
+        hd_comp_mgr_client_meta_clear (
+                              &HD_COMP_MGR_CLIENT (c->cm_client)->priv->meta);
+    }
+
   if (event->atom == wm->atoms[MBWM_ATOM_HILDON_LIVE_DESKTOP_BACKGROUND])
     {
       HdCompMgrPrivate *priv = hmgr->priv;
@@ -747,6 +1050,8 @@ hd_comp_mgr_client_property_changed (XPropertyEvent *event, HdCompMgr *hmgr)
         hd_comp_mgr_get_atom (hmgr, HD_ATOM_HILDON_NON_COMPOSITED_WINDOW);
   if (event->atom == wm->atoms[MBWM_ATOM_NET_WM_STATE] || non_comp_changed)
     {
+      /* It may have become fullscreen or stopped being. */
+      hd_comp_mgr_unredirect_invalidate (hmgr);
       c = mb_wm_managed_client_from_xwindow (wm, event->window);
       if (c && HD_IS_APP (c))
         {
@@ -1084,7 +1389,8 @@ lp_forecast (MBWindowManager *wm, MBWindowManagerClient *client)
   /* Find the topmost interesting client and see its portrait preferences. */
   portrait_freshness_counter++;
 
-  gboolean force_rotation = hd_transition_get_int("thp_tweaks", "forcerotation", 0);
+  hd_comp_mgr_portrait_tweaks ();
+  gboolean force_rotation = portrait_tweaks.forcerotation;
 
   for (l = 0; stack->pdata[l] != wm->desktop; l++)
     {
@@ -1183,6 +1489,7 @@ hd_comp_mgr_unregister_client (MBWMCompMgr *mgr, MBWindowManagerClient *c)
   HdCompMgrClient               * hclient = HD_COMP_MGR_CLIENT (c->cm_client);
 
   g_debug ("%s, c=%p ctype=%d", __FUNCTION__, c, MB_WM_CLIENT_CLIENT_TYPE (c));
+  hd_comp_mgr_unredirect_invalidate (HD_COMP_MGR (mgr));
   actor = mb_wm_comp_mgr_clutter_client_get_actor (cclient);
 
   /* Check if it's the last window for the app. */
@@ -1413,14 +1720,119 @@ hd_comp_mgr_get_client_transient_for (MBWindowManagerClient *c)
     : NULL;
 }
 
+/* Returns whether damage on @actor should be shown on the screen.
+ * TFP textures are usually bundled into another group, and it is
+ * this group that sets visibility - so we must check it too. */
+static gboolean
+hd_comp_mgr_damage_is_visible (ClutterActor *actor)
+{
+  ClutterActor *parent;
+  ClutterActor *actors_stage;
+  gboolean blur_update = FALSE;
+
+  if (!clutter_actor_is_visible (actor))
+    return FALSE;
+
+  actors_stage = clutter_actor_get_stage (actor);
+  if (!actors_stage)
+    /* if it's not on stage, it's not visible */
+    return FALSE;
+
+  for (parent = clutter_actor_get_parent (actor);
+       parent && parent != actors_stage;
+       parent = clutter_actor_get_parent (parent))
+    {
+      if (!clutter_actor_is_visible (parent))
+        return FALSE;
+      /* if we're a child of a blur group, tell it that it has changed */
+      if (TIDY_IS_BLUR_GROUP (parent))
+        {
+          /* we don't update blur on every change of
+           * an application now as it causes a flicker, so
+           * instead we just hint that next time we become
+           * unblurred, we need to recalculate. */
+          tidy_blur_group_hint_source_changed (parent);
+          /* ONLY set blur_update if the image is buffered ->
+           * we are actually blurred */
+          if (tidy_blur_group_source_buffered (parent))
+            blur_update = TRUE;
+        }
+    }
+
+  /* We no longer display changes that occur on blurred windows, so if
+   * this damage was actually on a blurred window, forget about it. */
+  return !blur_update;
+}
+
+/* Queue one redraw per damaged actor, covering everything the actor
+ * reported since the last flush. */
+static gboolean
+hd_comp_mgr_damage_flush (HdCompMgr *hmgr)
+{
+  HdCompMgrPrivate *priv = hmgr->priv;
+  HdCompMgrDamageStats *stats = &priv->damage_stats;
+  GHashTableIter iter;
+  gpointer key, value;
+  MBWindowManagerClient *candidate;
+  ClutterActor *candidate_actor;
+  gboolean candidate_damaged;
+
+  priv->damage_flush_id = 0;
+  stats->flushes++;
+  stats->last_flush_redraws = 0;
+  stats->last_flush_area = 0;
+
+  /* Is the client we could unredirect updating? */
+  candidate = hd_comp_mgr_unredirect_candidate (hmgr);
+  candidate_actor = candidate
+    ? mb_wm_comp_mgr_clutter_client_get_actor (
+                      MB_WM_COMP_MGR_CLUTTER_CLIENT (candidate->cm_client))
+    : NULL;
+  candidate_damaged = FALSE;
+
+  g_hash_table_iter_init (&iter, priv->damage);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      ClutterActor *actor = key;
+      const cairo_rectangle_int_t *extents = value;
+      ClutterGeometry area;
+
+      if (hd_dbus_display_is_off || !hd_comp_mgr_damage_is_visible (actor))
+        continue;
+
+      /* The damage is reported on the texture in the client's actor. */
+      if (candidate_actor && (actor == candidate_actor
+                       || clutter_actor_get_parent (actor) == candidate_actor))
+        candidate_damaged = TRUE;
+
+      area.x      = extents->x;
+      area.y      = extents->y;
+      area.width  = extents->width;
+      area.height = extents->height;
+
+      /* Update the screen. This function checks for scaling/visibility and
+       * chooses the area to update accordingly */
+      hd_util_partial_redraw_if_possible (actor, &area);
+
+      stats->redraws++;
+      stats->last_flush_redraws++;
+      stats->area_redrawn += extents->width * extents->height;
+      stats->last_flush_area += extents->width * extents->height;
+    }
+  g_hash_table_remove_all (priv->damage);
+
+  hd_comp_mgr_unredirect_damaged (hmgr, candidate, candidate_damaged);
+
+  return FALSE;
+}
+
 static void
 hd_comp_mgr_texture_update_area(HdCompMgr *hmgr,
                                 int x, int y, int width, int height,
                                 ClutterActor* actor)
 {
-  ClutterActor *parent;
-  gboolean blur_update = FALSE;
-  ClutterActor *actors_stage;
+  HdCompMgrPrivate *priv;
+  cairo_rectangle_int_t *box;
 
   if (!actor || !clutter_actor_is_visible(actor) || hmgr == 0)
     return;
@@ -1443,45 +1855,46 @@ hd_comp_mgr_texture_update_area(HdCompMgr *hmgr,
   if (hd_transition_rotate_ignore_damage())
     return;
 
-  /* TFP textures are usually bundled into another group, and it is
-   * this group that sets visibility - so we must check it too */
-  parent = clutter_actor_get_parent(actor);
-  actors_stage = clutter_actor_get_stage(actor);
-  if (!actors_stage)
-    /* if it's not on stage, it's not visible */
-    return;
-
-  while (parent && parent != actors_stage)
+  /* Just accumulate the damage, it is processed by
+   * hd_comp_mgr_damage_flush() before the stage is painted.
+   * The stage only keeps a single clip rectangle anyway, so all
+   * we need is the rectangle around the damage of each actor. */
+  hd_frame_stats_mark (HD_FRAME_DAMAGE);
+  priv = hmgr->priv;
+  if (!(box = g_hash_table_lookup (priv->damage, actor)))
     {
-      if (!clutter_actor_is_visible(parent))
-        return;
-      /* if we're a child of a blur group, tell it that it has changed */
-      if (TIDY_IS_BLUR_GROUP(parent))
-        {
-          /* we don't update blur on every change of
-           * an application now as it causes a flicker, so
-           * instead we just hint that next time we become
-           * unblurred, we need to recalculate. */
-          tidy_blur_group_hint_source_changed(parent);
-          /* ONLY set blur_update if the image is buffered ->
-           * we are actually blurred */
-          if (tidy_blur_group_source_buffered(parent))
-            blur_update = TRUE;
-        }
-      parent = clutter_actor_get_parent(parent);
+      box = g_new0 (cairo_rectangle_int_t, 1);
+      g_hash_table_insert (priv->damage, g_object_ref (actor), box);
     }
+  if (box->width <= 0 || box->height <= 0)
+    {
+      box->x = x;
+      box->y = y;
+      box->width = width;
+      box->height = height;
+    }
+  else if (width > 0 && height > 0)
+    {
+      gint x2 = MAX (box->x + box->width, x + width);
+      gint y2 = MAX (box->y + box->height, y + height);
 
-  /* We no longer display changes that occur on blurred windows, so if
-   * this damage was actually on a blurred window, forget about it. */
-  if (blur_update)
-    return;
+      box->x = MIN (box->x, x);
+      box->y = MIN (box->y, y);
+      box->width = x2 - box->x;
+      box->height = y2 - box->y;
+    }
 
-  /* Update the screen. This function checks for scaling/visibility and
-   * chooses the area to update accordingly */
-  {
-    ClutterGeometry area = {x,y,width, height};
-    hd_util_partial_redraw_if_possible(actor, &area);
-  }
+  if (!priv->damage_flush_id)
+    {
+      priv->damage_stats.last_flush_events = 0;
+      priv->damage_flush_id = g_idle_add_full (CLUTTER_PRIORITY_REDRAW - 10,
+                                 (GSourceFunc)hd_comp_mgr_damage_flush,
+                                 hmgr, NULL);
+    }
+
+  priv->damage_stats.events++;
+  priv->damage_stats.last_flush_events++;
+  priv->damage_stats.area_damaged += width * height;
 }
 
 /* Hook onto and X11 texture pixmap children of this actor */
@@ -1644,8 +2057,8 @@ hd_comp_mgr_unredirect_client (MBWindowManagerClient *c)
 
 /* returns TRUE if the client wants non-composited mode */
 static gboolean
-hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
-                               gboolean force_re_read)
+hd_comp_mgr_wants_non_composited (MBWindowManagerClient *client,
+                                  gboolean force_re_read)
 {
   MBWindowManager *wm;
   HdCompMgr *hmgr;
@@ -1665,16 +2078,12 @@ hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
   if (!HD_APP (client)->non_composited_read)
     {
       /* check if the window is blacklisted */
-      XClassHint class_hint;
-      memset (&class_hint, 0, sizeof (XClassHint));
-      mb_wm_util_async_trap_x_errors (wm->xdpy);
-      ret = XGetClassHint (wm->xdpy, client->window->xwindow, &class_hint);
-      mb_wm_util_async_untrap_x_errors ();
+      const gchar *res_class = hd_comp_mgr_client_get_meta (client)->res_class;
 
-      if (ret && class_hint.res_class)
+      if (res_class)
         {
-          if (!strcmp (class_hint.res_class, "Chessui") ||
-              !strcmp (class_hint.res_class, "Mahjong"))
+          if (!strcmp (res_class, "Chessui") ||
+              !strcmp (res_class, "Mahjong"))
             {
               /* g_printerr ("%s: mahjong or chess\n", __func__); */
               HD_APP (client)->non_composited_read = True;
@@ -1682,12 +2091,6 @@ hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
               HD_APP (client)->force_composited = True;
             }
         }
-
-      if (class_hint.res_class)
-        XFree (class_hint.res_class);
-
-      if (class_hint.res_name)
-        XFree (class_hint.res_name);
     }
 
   if (HD_APP (client)->force_composited)
@@ -1725,6 +2128,7 @@ hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
       XFree (prop);
     }
 
+  HD_APP (client)->non_composited_explicit = actual_type == XA_INTEGER;
   if (actual_type == XA_INTEGER)
     {
       if (value)
@@ -1751,6 +2155,22 @@ hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
   return FALSE;
 }
 
+/* returns TRUE if the client wants non-composited mode or we decided
+ * it for the client, see hd_comp_mgr_auto_unredirect() */
+static gboolean
+hd_comp_mgr_is_non_composited (MBWindowManagerClient *client,
+                               gboolean force_re_read)
+{
+  if (hd_comp_mgr_wants_non_composited (client, force_re_read))
+    return TRUE;
+
+  /* The client may have set the property since. */
+  return HD_IS_APP (client) && HD_APP (client)->auto_non_composited
+    && !HD_APP (client)->force_composited
+    && !HD_APP (client)->non_composited_explicit
+    && (client->window->ewmh_state & MBWMClientWindowEWMHStateFullscreen);
+}
+
 /* returns HdApp of client that was replaced (because the stack_index
  * was the same) in 'replaced', or NULL.
  * 'add_to_tn' returns a client if that client is a new window on a stack, or
@@ -2056,6 +2476,9 @@ hd_comp_mgr_map_notify (MBWMCompMgr *mgr, MBWindowManagerClient *c)
            mb_wm_client_get_name (c));
   create_stampfile();
 
+  hd_util_client_obscured_invalidate ();
+  hd_comp_mgr_unredirect_invalidate (HD_COMP_MGR (mgr));
+
   /* Log the time this window was mapped */
   gettimeofday(&priv->last_map_time, NULL);
 
@@ -2160,6 +2583,11 @@ hd_comp_mgr_map_notify (MBWMCompMgr *mgr, MBWindowManagerClient *c)
    * whose windows we don't use for anything at all and not creating
    * the texture saves precious miliseconds.
    */
+  /* anything shown over a client we have unredirected on our own,
+   * even a note, is shown composited */
+  if (hd_comp_mgr_covers_auto_unredirected (c))
+    hd_render_manager_switch_to_composited_state ();
+
   if (!HD_IS_INCOMING_EVENT_NOTE(c))
     {
       /* start compositing if the client prefers that */
@@ -2700,6 +3128,38 @@ hd_comp_mgr_determine_current_app ()
   return hd_mb_wm->desktop;
 }
 
+/* Returns whether @c is mapped over a client we unredirected even
+ * though it didn't ask for it, see hd_comp_mgr_auto_unredirect(). */
+static gboolean
+hd_comp_mgr_covers_auto_unredirected (MBWindowManagerClient *c)
+{
+  MBWindowManagerClient *below;
+
+  if (MB_WM_CLIENT_CLIENT_TYPE (c) & HdWmClientTypeStatusArea)
+    return FALSE;
+  for (below = c->stacked_below; below; below = below->stacked_below)
+    if (HD_IS_APP (below) && HD_APP (below)->auto_non_composited)
+      return TRUE;
+  return FALSE;
+}
+
+/* Returns whether a window mapped above @c needs compositing.  If
+ * @strict, every window does but the status area, even notes. */
+static gboolean
+hd_comp_mgr_needs_compositing_above (MBWindowManagerClient *c,
+                                     gboolean strict)
+{
+  MBWindowManagerClient *tmp;
+
+  for (tmp = c->stacked_above; tmp; tmp = tmp->stacked_above)
+    if (mb_wm_client_is_map_confirmed (tmp)
+        && (hd_comp_mgr_client_prefers_compositing (tmp)
+            || (strict && !(MB_WM_CLIENT_CLIENT_TYPE (tmp)
+                            & HdWmClientTypeStatusArea))))
+      return TRUE;
+  return FALSE;
+}
+
 /* returns TRUE if state was changed */
 gboolean
 hd_comp_mgr_reconsider_compositing (MBWMCompMgr *mgr)
@@ -2711,19 +3171,9 @@ hd_comp_mgr_reconsider_compositing (MBWMCompMgr *mgr)
       (hdrm_state == HDRM_STATE_APP || hdrm_state == HDRM_STATE_APP_PORTRAIT)
       && hd_comp_mgr_is_non_composited (c, FALSE))
     {
-      MBWindowManagerClient *tmp;
-      gboolean found = FALSE;
-
       /* check if there is a window that wishes composited mode above */
-      for (tmp = c->stacked_above; tmp; tmp = tmp->stacked_above)
-        if (mb_wm_client_is_map_confirmed (tmp) &&
-            hd_comp_mgr_client_prefers_compositing (tmp))
-          {
-            found = TRUE;
-            break;
-          }
-
-      if (!found)
+      if (!hd_comp_mgr_needs_compositing_above (c,
+                                         HD_APP (c)->auto_non_composited))
         {
           if (hdrm_state == HDRM_STATE_APP)
             hd_render_manager_set_state (HDRM_STATE_NON_COMPOSITED);
@@ -2743,19 +3193,10 @@ hd_comp_mgr_reconsider_compositing (MBWMCompMgr *mgr)
         }
       else if (c)
         {
-          MBWindowManagerClient *tmp;
-          gboolean found = FALSE;
-
           /* check if there is a window that needs composited mode above */
-          for (tmp = c->stacked_above; tmp; tmp = tmp->stacked_above)
-            if (mb_wm_client_is_map_confirmed (tmp) &&
-                hd_comp_mgr_client_prefers_compositing (tmp))
-              {
-                found = TRUE;
-                break;
-              }
-
-          if (found || !hd_comp_mgr_is_non_composited (c, FALSE))
+          if (hd_comp_mgr_needs_compositing_above (c, HD_IS_APP (c)
+                                         && HD_APP (c)->auto_non_composited)
+              || !hd_comp_mgr_is_non_composited (c, FALSE))
             {
               hd_render_manager_switch_to_composited_state ();
               return TRUE;
@@ -2777,6 +3218,165 @@ hd_comp_mgr_reconsider_compositing (MBWMCompMgr *mgr)
   return FALSE;
 }
 
+/*
+ * Automatic unredirection.  A fullscreen application without an alpha
+ * channel which keeps updating its window and has nothing over it is
+ * unredirected even if it didn't ask for it with the
+ * _HILDON_NON_COMPOSITED_WINDOW property, like games and video players
+ * which don't know about it.  HdUnredirect decides when, we tell it
+ * which client could be unredirected and when it's damaged.  It's
+ * composited again as soon as anything but the status area is mapped
+ * over it.
+ */
+
+/* (Re)reads [unredirect] when transitions.ini changes. */
+static void
+hd_comp_mgr_unredirect_settings (HdCompMgrPrivate *priv)
+{
+  guint serial;
+
+  serial = hd_transition_get_file_serial ();
+  if (serial == priv->unredirect_serial)
+    return;
+  priv->unredirect_serial = serial;
+
+  priv->unredirect_enabled = hd_transition_get_int ("unredirect", "auto", 1);
+  hd_unredirect_configure (priv->unredirect,
+                  hd_transition_get_int ("unredirect", "min_fps", 20),
+                  hd_transition_get_int ("unredirect", "sustain", 2000),
+                  hd_transition_get_int ("unredirect", "cooldown", 3000));
+}
+
+static gint64
+hd_comp_mgr_unredirect_now (HdCompMgrPrivate *priv)
+{
+  return (gint64)(g_timer_elapsed (priv->unredirect_clock, NULL) * 1000);
+}
+
+/* Forgets what hd_comp_mgr_unredirect_top() found, because the stack
+ * or a client's fullscreenness changed. */
+static void
+hd_comp_mgr_unredirect_invalidate (HdCompMgr *hmgr)
+{
+  hmgr->priv->unredirect_top_valid = FALSE;
+  hmgr->priv->unredirect_top = NULL;
+}
+
+/* Returns the current application if it's fullscreen and nothing over
+ * it needs compositing.  Looking for it takes walking the stack twice,
+ * so it's done again only after hd_comp_mgr_unredirect_invalidate(). */
+static MBWindowManagerClient *
+hd_comp_mgr_unredirect_top (HdCompMgrPrivate *priv)
+{
+  MBWindowManagerClient *c;
+
+  if (priv->unredirect_top_valid)
+    return priv->unredirect_top;
+
+  c = hd_comp_mgr_determine_current_app ();
+  if (c && (!HD_IS_APP (c) || !c->cm_client || !c->window
+      || !(c->window->ewmh_state & MBWMClientWindowEWMHStateFullscreen)
+      || hd_comp_mgr_needs_compositing_above (c, TRUE)))
+    c = NULL;
+
+  priv->unredirect_top = c;
+  priv->unredirect_top_valid = TRUE;
+  return c;
+}
+
+/* Returns the client we could unredirect now, if any.  Called on every
+ * damage flush, so what's not cached by hd_comp_mgr_unredirect_top()
+ * must be cheap. */
+static MBWindowManagerClient *
+hd_comp_mgr_unredirect_candidate (HdCompMgr *hmgr)
+{
+  HdCompMgrPrivate *priv = hmgr->priv;
+  HDRMStateEnum state;
+  MBWindowManagerClient *c;
+  HdApp *app;
+
+  hd_comp_mgr_unredirect_settings (priv);
+  state = hd_render_manager_get_state ();
+  if (!priv->unredirect_enabled || hd_dbus_display_is_off
+      || (state != HDRM_STATE_APP && state != HDRM_STATE_APP_PORTRAIT)
+      || hd_transition_is_rotating ())
+    return NULL;
+
+  if (!(c = hd_comp_mgr_unredirect_top (priv)))
+    return NULL;
+
+  /* Leave the client alone if it has an opinion. */
+  app = HD_APP (c);
+  if (hd_comp_mgr_wants_non_composited (c, FALSE)
+      || app->force_composited || app->non_composited_explicit)
+    return NULL;
+
+  if (HD_COMP_MGR_CLIENT (c->cm_client)->effect
+      || !hd_comp_mgr_client_is_opaque (HD_COMP_MGR_CLIENT (c->cm_client)))
+    return NULL;
+
+  return c;
+}
+
+/* Unredirects the client HdUnredirect has chosen, unless things have
+ * changed since. */
+static gboolean
+hd_comp_mgr_auto_unredirect (HdCompMgr *hmgr)
+{
+  HdCompMgrPrivate *priv = hmgr->priv;
+  MBWindowManagerClient *c;
+
+  priv->unredirect_id = 0;
+  if (!(c = hd_comp_mgr_unredirect_candidate (hmgr)))
+    return FALSE;
+
+  HD_APP (c)->auto_non_composited = True;
+  priv->auto_unredirecting = TRUE;
+  if (!hd_comp_mgr_reconsider_compositing (MB_WM_COMP_MGR (hmgr)))
+    HD_APP (c)->auto_non_composited = False;
+  priv->auto_unredirecting = FALSE;
+
+  return FALSE;
+}
+
+/* Called after each damage flush with the client we could unredirect
+ * and whether it was damaged. */
+static void
+hd_comp_mgr_unredirect_damaged (HdCompMgr *hmgr,
+                                MBWindowManagerClient *candidate,
+                                gboolean damaged)
+{
+  HdCompMgrPrivate *priv = hmgr->priv;
+  gint64 now;
+
+  now = hd_comp_mgr_unredirect_now (priv);
+  hd_unredirect_set_candidate (priv->unredirect, candidate);
+  if (damaged && hd_unredirect_damage (priv->unredirect, now)
+      && !priv->unredirect_id)
+    priv->unredirect_id = g_idle_add ((GSourceFunc)hd_comp_mgr_auto_unredirect,
+                                      hmgr);
+}
+
+/* Called by the render manager when it enters or leaves a
+ * non-composited state. */
+void
+hd_comp_mgr_compositing_changed (HdCompMgr *hmgr, gboolean composited)
+{
+  HdCompMgrPrivate *priv = hmgr->priv;
+  MBWindowManagerClient *c;
+
+  if (!priv->unredirect)
+    return;
+
+  hd_unredirect_set_composited (priv->unredirect, composited,
+                                priv->auto_unredirecting,
+                                hd_comp_mgr_unredirect_now (priv));
+  if (composited)
+    mb_wm_stack_enumerate (MB_WM_COMP_MGR (hmgr)->wm, c)
+      if (HD_IS_APP (c))
+        HD_APP (c)->auto_non_composited = False;
+}
+
 static void
 hd_comp_mgr_unmap_notify (MBWMCompMgr *mgr, MBWindowManagerClient *c)
 {
@@ -2789,6 +3389,9 @@ hd_comp_mgr_unmap_notify (MBWMCompMgr *mgr, MBWindowManagerClient *c)
            c && c->window ? c->window->xwindow : 0,
            mb_wm_client_get_name (c));
 
+  hd_util_client_obscured_invalidate ();
+  hd_comp_mgr_unredirect_invalidate (HD_COMP_MGR (mgr));
+
   if (c->window->live_background)
     {
       /*g_printerr ("%s: remove live_bg\n", __func__);*/
@@ -3067,6 +3670,10 @@ hd_comp_mgr_restack (MBWMCompMgr * mgr)
 
   /* g_debug ("%s", __FUNCTION__); */
 
+  hd_util_client_obscured_invalidate ();
+  hd_comp_mgr_unredirect_invalidate (HD_COMP_MGR (mgr));
+  hd_frame_stats_mark (HD_FRAME_RESTACK);
+
   /*
    * We use the parent class restack() method to do the stacking, but as our
    * switcher shares actors with the CM, we cannot run this when the switcher
@@ -3257,9 +3864,12 @@ hd_comp_mgr_may_be_portrait (HdCompMgr *hmgr, gboolean assume_requested)
   MBWindowManagerClient *c;
   gboolean any_supports, any_requests;
   gboolean is_whitelisted = FALSE;
-  gboolean force_rotation = hd_transition_get_int("thp_tweaks", "forcerotation", 0);
+  gboolean force_rotation;
   gboolean client_is_app = FALSE;
 
+  hd_comp_mgr_portrait_tweaks ();
+  force_rotation = portrait_tweaks.forcerotation;
+
   /* Invalidate all cached, inherited portrait flags at once. */
   portrait_freshness_counter++;
 
@@ -3602,8 +4212,8 @@ hd_comp_mgr_client_supports_portrait (MBWindowManagerClient *mbwmc)
   if (hd_comp_mgr_is_blacklisted (mbwmc->wmref, mbwmc))
     return FALSE;
 
-  return hd_transition_get_int ("thp_tweaks", "forcerotation", 0) ?
-      TRUE : mbwmc->portrait_supported;
+  hd_comp_mgr_portrait_tweaks ();
+  return portrait_tweaks.forcerotation ? TRUE : mbwmc->portrait_supported;
 }
 
 gboolean
@@ -3806,6 +4416,44 @@ hd_comp_mgr_dump_debug_info (const gchar *tag)
   g_debug("Stage winid %lx", clutter_x11_get_stage_window (CLUTTER_STAGE (stage)));
   dump_clutter_actor_tree (clutter_stage_get_default (), NULL);
   hd_app_mgr_dump_app_list (TRUE);
+  hd_clutter_cache_dump_debug_info ();
+  tidy_util_dump_target_pool ();
+  tidy_cached_group_dump_debug_info ();
+  hd_frame_stats_dump ();
+  hd_render_manager_dump_restack_stats ();
+  hd_render_manager_dump_state_profile ();
+  hd_animation_dump ();
+
+  {
+    const HdCompMgrDamageStats *stats = &hd_comp_mgr_get ()->priv->damage_stats;
+
+    g_debug ("damage: %u events, %u flushes, %u redraws queued "
+             "(%.2f events/flush, %.2f redraws/flush)",
+             stats->events, stats->flushes, stats->redraws,
+             stats->flushes ? (gdouble)stats->events / stats->flushes : 0,
+             stats->flushes ? (gdouble)stats->redraws / stats->flushes : 0);
+    g_debug ("  area damaged: %" G_GUINT64_FORMAT
+             ", area redrawn: %" G_GUINT64_FORMAT
+             " (%.0f pixels/flush)",
+             stats->area_damaged, stats->area_redrawn,
+             stats->flushes ? (gdouble)stats->area_redrawn / stats->flushes
+                            : 0);
+    g_debug ("  last flush: %u events, %u redraws, %u pixels",
+             stats->last_flush_events, stats->last_flush_redraws,
+             stats->last_flush_area);
+  }
+
+  {
+    HdCompMgrPrivate *priv = hd_comp_mgr_get ()->priv;
+    HdUnredirectStats stats;
+
+    hd_unredirect_get_stats (priv->unredirect,
+                             hd_comp_mgr_unredirect_now (priv), &stats);
+    g_debug ("compositing: %.1f s composited, %.1f s unredirected; "
+             "%u automatic unredirections, %u undone",
+             stats.composited_ms / 1000.0, stats.unredirected_ms / 1000.0,
+             stats.unredirects, stats.redirects);
+  }
 #endif
 }
 
@@ -3897,10 +4545,8 @@ hd_comp_mgr_update_applets_on_current_desktop_property (HdCompMgr *hmgr)
 gboolean
 hd_comp_mgr_is_whitelisted(MBWindowManager *wm, MBWindowManagerClient *c)
 {
-  gchar *whitelist;
-  XClassHint class_hint;
-  Status ret;
-  gchar *wname = NULL;
+  HdCompMgrClientMeta *meta;
+  const gchar *wname;
   gboolean is_on_whitelist = FALSE;
 
   if ((!c) || !MB_WINDOW_MANAGER(wm) || c == wm->desktop)
@@ -3912,22 +4558,11 @@ hd_comp_mgr_is_whitelisted(MBWindowManager *wm, MBWindowManagerClient *c)
       return FALSE;
   }
 
-  whitelist = g_strdup(hd_transition_get_string("thp_tweaks", "whitelist", ""));
-  memset(&class_hint, 0, sizeof(XClassHint));
-  mb_wm_util_async_trap_x_errors (wm->xdpy);
-  ret = XGetClassHint (wm->xdpy, c->window->xwindow, &class_hint);
-  mb_wm_util_async_untrap_x_errors ();
-
-  if (ret && class_hint.res_class)
-    wname = g_strdup(class_hint.res_name);
-
-  if (class_hint.res_class)
-    XFree(class_hint.res_class);
-
-  if (class_hint.res_name)
-    XFree(class_hint.res_name);
+  hd_comp_mgr_portrait_tweaks ();
+  meta = hd_comp_mgr_client_get_meta (c);
+  wname = meta->res_class ? meta->res_name : NULL;
 
-  if (g_strrstr(whitelist, wname))
+  if (hd_name_list_match (&portrait_tweaks.whitelist, wname))
     is_on_whitelist = TRUE;
 
   PORTRAIT ("Whitelist: WName %s; Supp: %d; Req: %d; SuppInh: %d, ReqInh: %d", wname, c->portrait_supported, c->portrait_requested, c->portrait_supported_inherited, c->portrait_requested_inherited);
@@ -3936,57 +4571,40 @@ hd_comp_mgr_is_whitelisted(MBWindowManager *wm, MBWindowManagerClient *c)
       PORTRAIT("Whitelist: Parent Sup: %d Req: %d", c->transient_for->portrait_supported, c->transient_for->portrait_requested);
 #endif
 
-  g_free(whitelist);
-  g_free(wname);
-
   return is_on_whitelist;
 }
 
 gboolean
 hd_comp_mgr_is_blacklisted(MBWindowManager *wm, MBWindowManagerClient *c)
 {
-  gchar *blacklist;
-  XClassHint class_hint;
-  Status ret;
-  gchar *wname = NULL;
+  HdCompMgrClientMeta *meta;
+  const gchar *wname;
   gboolean blacklisted = FALSE;
   gboolean blacklisted_by_desktopfile = FALSE;
-  gboolean forcerotation = hd_transition_get_int("thp_tweaks", "forcerotation", 0);
 
   if ((!c) || !HD_IS_APP (c) || !MB_WINDOW_MANAGER(wm) || c == wm->desktop)
     return FALSE;
 
-  blacklist = g_strdup (hd_transition_get_string ("thp_tweaks", "blacklist", ""));
-  memset (&class_hint, 0, sizeof (XClassHint));
-  mb_wm_util_async_trap_x_errors (wm->xdpy);
-  ret = XGetClassHint (wm->xdpy, c->window->xwindow, &class_hint);
-  mb_wm_util_async_untrap_x_errors ();
-
-  if (ret && class_hint.res_class)
-    wname = g_strdup (class_hint.res_name);
+  hd_comp_mgr_portrait_tweaks ();
+  meta = hd_comp_mgr_client_get_meta (c);
+  wname = meta->res_class ? meta->res_name : NULL;
 
   /* Check, if X-CSSU-Force-Landscape=true. */
-  blacklisted_by_desktopfile = hd_comp_mgr_is_blacklisted_parse_desktop_file (wname, class_hint.res_class, c->window->pid);
-
-  if (class_hint.res_class)
-    XFree(class_hint.res_class);
-
-  if (class_hint.res_name)
-    XFree(class_hint.res_name);
+  blacklisted_by_desktopfile = hd_comp_mgr_app_forces_landscape (
+                                  hd_comp_mgr_client_meta_get_app (meta));
 
   if (!blacklisted_by_desktopfile)
     {
-      if (g_strrstr(blacklist, wname))
+      if (hd_name_list_match (&portrait_tweaks.blacklist, wname))
         blacklisted = TRUE;
 
+      /* @meta is not used after this, it may be clobbered by
+       * the recursion. */
       if (c->stacked_below && (wname == NULL))
         if (hd_comp_mgr_is_blacklisted (wm, c->stacked_below))
           blacklisted = TRUE;
     }
 
-  g_free (blacklist);
-  g_free (wname);
-
   if (blacklisted_by_desktopfile)
     return TRUE;
 
@@ -3995,7 +4613,7 @@ hd_comp_mgr_is_blacklisted(MBWindowManager *wm, MBWindowManagerClient *c)
       return FALSE;
 
   /* We don't want blacklisted windows when forcerotation == 0. */
-  if (!forcerotation)
+  if (!portrait_tweaks.forcerotation)
     return FALSE;
 
   return blacklisted;
@@ -4004,13 +4622,21 @@ hd_comp_mgr_is_blacklisted(MBWindowManager *wm, MBWindowManagerClient *c)
 gboolean
 hd_comp_mgr_is_blacklisted_parse_desktop_file(char *res_name, 
                                               char *res_class, GPid pid)
+{
+  /* With the informations from XClassHint, we can match our window to an application. */
+  return hd_comp_mgr_app_forces_landscape (
+                            hd_app_mgr_match_window (res_name, res_class, pid));
+}
+
+static gboolean
+hd_comp_mgr_app_forces_landscape (HdRunningApp *app)
 {
   HdLauncherTree *tree;
   HdLauncherItem *item;
-  HdRunningApp *app;
 
-  /* With the informations from XClassHint, we can match our window to an application. */
-  app = hd_app_mgr_match_window (res_name, res_class, pid);
+  if (!app)
+    return FALSE;
+
   /* Get application list. */
   tree = hd_app_mgr_get_tree ();
   /* Find our app in the app list. */
@@ -4029,33 +4655,17 @@ gboolean
 hd_comp_mgr_is_callui_window (MBWindowManager *wm, MBWindowManagerClient *c)
 {
   gchar *whitelist = "rtcom-call-ui";
-  XClassHint class_hint;
-  Status ret;
-  gchar *wname = NULL;
+  HdCompMgrClientMeta *meta;
   gboolean is_callui_window = FALSE;
 
   if ((!c) || !MB_WINDOW_MANAGER(wm) || c == wm->desktop)
     return FALSE;
 
-  memset(&class_hint, 0, sizeof(XClassHint));
-  mb_wm_util_async_trap_x_errors (wm->xdpy);
-  ret = XGetClassHint (wm->xdpy, c->window->xwindow, &class_hint);
-  mb_wm_util_async_untrap_x_errors ();
-
-  if (ret && class_hint.res_class)
-    wname = g_strdup(class_hint.res_name);
-
-  if (class_hint.res_class)
-    XFree(class_hint.res_class);
-
-  if (class_hint.res_name)
-    XFree(class_hint.res_name);
-
-  if (g_strrstr(whitelist, wname))
+  meta = hd_comp_mgr_client_get_meta (c);
+  if (meta->res_class && meta->res_name
+      && g_strrstr(whitelist, meta->res_name))
     is_callui_window = TRUE;
 
-  g_free(wname);
-
   return is_callui_window;
 }
 
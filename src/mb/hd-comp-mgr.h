@@ -89,6 +89,7 @@ gboolean hd_comp_mgr_client_is_hibernating (HdCompMgrClient *hclient);
 gboolean hd_comp_mgr_client_can_hibernate (HdCompMgrClient *hclient);
 
 gboolean hd_comp_mgr_client_has_video_overlay (HdCompMgrClient *hclient);
+gboolean hd_comp_mgr_client_is_opaque (HdCompMgrClient *hclient);
 
 HdRunningApp  *hd_comp_mgr_client_get_app (HdCompMgrClient *hclient);
 HdLauncherApp *hd_comp_mgr_client_get_launcher (HdCompMgrClient *hclient);
@@ -220,6 +221,7 @@ void hd_comp_mgr_update_applets_on_current_desktop_property (HdCompMgr *hmgr);
 void hd_comp_mgr_unredirect_topmost_client (MBWindowManager *wm,
                                             gboolean force);
 gboolean hd_comp_mgr_reconsider_compositing (MBWMCompMgr *mgr);
+void hd_comp_mgr_compositing_changed (HdCompMgr *hmgr, gboolean composited);
 HdCompMgrClient * hd_comp_mgr_get_current_client (HdCompMgr *hmgr);
 
 gboolean hd_comp_mgr_is_whitelisted(MBWindowManager *wm, MBWindowManagerClient *c);
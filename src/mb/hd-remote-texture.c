@@ -24,10 +24,12 @@
 #include "hd-remote-texture.h"
 #include "hd-comp-mgr.h"
 #include "hd-wm.h"
+#include "hd-transition.h"
 #include "tidy/tidy-mem-texture.h"
 
 #include <sys/time.h>
 #include <sys/shm.h>
+#include <string.h>
 #include <time.h>
 
 #define CLIENT_MESSAGE_DEBUG 0//1
@@ -45,6 +47,9 @@ static guint32 position_atom;
 static guint32 offset_atom;
 static guint32 scale_atom;
 static guint32 parent_atom;
+static guint32 buffers_atom;
+static guint32 present_atom;
+static guint32 release_atom;
 static guint32 ready_atom;
 static gboolean atoms_initialized = 0;
 
@@ -54,9 +59,12 @@ static Bool
 hd_remote_texture_request_geometry (MBWindowManagerClient *client,
 				     MBGeometry            *new_geometry,
 				     MBWMClientReqGeomType  flags);
-static void
+static gboolean
 hd_remote_texture_set_shm(HdRemoteTexture *tex, key_t key,
-                          guint width, guint height, guint bpp);
+                          guint width, guint height, guint bpp,
+                          guint nbuffers);
+static void
+hd_remote_texture_release (HdRemoteTexture *self, guint buffer);
 
 static Bool
 hd_remote_texture_client_message (XClientMessageEvent *xev, void *userdata)
@@ -89,12 +97,82 @@ hd_remote_texture_client_message (XClientMessageEvent *xev, void *userdata)
         hd_remote_texture_set_shm(self, shm_key,
             shm_width,
             shm_height,
-            shm_bpp);
+            shm_bpp, 0);
 
         CM_DEBUG ("RemoteTexture %p: shm(key=%d, width=%d, height=%d, bpp=%d)\n",
                   self, shm_key,
                   shm_width, shm_height, shm_bpp);
     }
+  else if (xev->message_type == buffers_atom)
+    {
+        /* Like shm, but the segment has room for @nbuffers frames,
+         * which the client presents in turn, see hd-remote-texture.h. */
+        key_t shm_key = (key_t) xev->data.l[0];
+        guint shm_width = (guint) xev->data.l[1];
+        guint shm_height = (guint) xev->data.l[2];
+        guint shm_bpp = (guint) xev->data.l[3];
+        guint nbuffers = (guint) xev->data.l[4];
+        guint i;
+
+        CM_DEBUG ("RemoteTexture %p: buffers(key=%d, width=%d, height=%d, "
+                  "bpp=%d, n=%d)\n", self, shm_key,
+                  shm_width, shm_height, shm_bpp, nbuffers);
+        if (nbuffers < 2 || nbuffers > HD_REMOTE_TEXTURE_MAX_BUFFERS)
+          {
+            g_warning ("RemoteTexture %p: can't use %u buffers",
+                       self, nbuffers);
+            return True;
+          }
+
+        /* Accept by releasing all of them; a client which hears
+         * nothing should fall back to the single buffer. */
+        if (hd_remote_texture_set_shm(self, shm_key,
+                                      shm_width, shm_height, shm_bpp,
+                                      nbuffers))
+          for (i = 0; i < nbuffers; i++)
+            hd_remote_texture_release (self, i);
+    }
+  else if (xev->message_type == present_atom)
+    {
+        /* The client has finished writing a complete frame into
+         * @buffer and won't touch it until we release it. */
+        guint buffer = (guint) xev->data.l[0];
+        gulong serial = (gulong) xev->data.l[1];
+        gint x = ((gulong) xev->data.l[2] >> 16) & 0xffff;
+        gint y = (gulong) xev->data.l[2] & 0xffff;
+        gint width = ((gulong) xev->data.l[3] >> 16) & 0xffff;
+        gint height = (gulong) xev->data.l[3] & 0xffff;
+        const guchar *frame;
+
+        CM_DEBUG ("RemoteTexture %p: present(buffer=%u, serial=%lu, "
+                  "x=%d, y=%d, width=%d, height=%d)\n",
+                  self, buffer, serial, x, y, width, height);
+        if (buffer >= self->shm_buffers)
+          {
+            g_warning ("RemoteTexture %p: presented buffer %u of %u",
+                       self, buffer, self->shm_buffers);
+            return True;
+          }
+
+        frame = self->shm_addr
+          + buffer * self->shm_width * self->shm_height * self->shm_bpp;
+        self->shm_serials[buffer] = serial;
+        if (self->shm_current < 0)
+          tidy_mem_texture_set_data(self->texture, frame,
+                                    self->shm_width, self->shm_height,
+                                    self->shm_bpp);
+        else if (buffer != self->shm_current)
+          {
+            /* Tiles not uploaded yet are read from the new frame,
+             * so we're done with the previous one. */
+            tidy_mem_texture_set_data_ptr(self->texture, frame);
+            tidy_mem_texture_damage(self->texture, x, y, width, height);
+            hd_remote_texture_release (self, self->shm_current);
+          }
+        else
+          tidy_mem_texture_damage(self->texture, x, y, width, height);
+        self->shm_current = buffer;
+    }
   else if (xev->message_type == damage_atom)
     {
         gint x = (gint) xev->data.l[0];
@@ -270,6 +348,12 @@ hd_remote_texture_realize (MBWindowManagerClient *client)
 	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_SCALE);
 	parent_atom = hd_comp_mgr_get_atom
 	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_PARENT);
+	buffers_atom = hd_comp_mgr_get_atom
+	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_BUFFERS);
+	present_atom = hd_comp_mgr_get_atom
+	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_PRESENT);
+	release_atom = hd_comp_mgr_get_atom
+	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_MESSAGE_RELEASE);
 	ready_atom = hd_comp_mgr_get_atom
 	    (hmgr, HD_ATOM_HILDON_TEXTURE_CLIENT_READY);
 
@@ -346,7 +430,7 @@ hd_remote_texture_destroy (MBWMObject *this)
                                                  self->client_message_handler_id);
   }
   /* unattach ourselves if we were attached */
-  hd_remote_texture_set_shm(self, 0, 0, 0, 0);
+  hd_remote_texture_set_shm(self, 0, 0, 0, 0, 0);
   /* free our texture */
   clutter_actor_destroy(CLUTTER_ACTOR(self->texture));
   self->texture = 0;
@@ -365,6 +449,10 @@ hd_remote_texture_init (MBWMObject *this, va_list vap)
       return 0;
 
   tex->texture = g_object_ref(tidy_mem_texture_new());
+  tex->shm_current = -1;
+  tidy_mem_texture_set_upload_budget(tex->texture,
+         hd_transition_get_int("remote_texture", "upload_budget_kb", 1024)
+         * 1024);
 
   /* Animation actors are not reactive and, therefore, are input-transparent.
    * Since they are going to be moved around using clutter calls, X will know
@@ -454,9 +542,35 @@ hd_remote_texture_new (MBWindowManager *wm, MBWMClientWindow *win)
   return client;
 }
 
+/* Tell the client it can write @buffer again, with the serial
+ * it was presented with. */
 static void
+hd_remote_texture_release (HdRemoteTexture *self, guint buffer)
+{
+  MBWindowManagerClient *client = MB_WM_CLIENT (self);
+  XClientMessageEvent    xev;
+
+  memset (&xev, 0, sizeof (xev));
+  xev.type = ClientMessage;
+  xev.window = client->window->xwindow;
+  xev.message_type = release_atom;
+  xev.format = 32;
+  xev.data.l[0] = buffer;
+  xev.data.l[1] = self->shm_serials[buffer];
+
+  CM_DEBUG ("RemoteTexture %p: release(buffer=%u, serial=%lu)\n",
+            self, buffer, self->shm_serials[buffer]);
+  XSendEvent (client->wmref->xdpy, xev.window, False, NoEventMask,
+              (XEvent *)&xev);
+}
+
+/* Attach to the segment of @key with @nbuffers frames of @width x @height
+ * x @bpp bytes (one if @nbuffers is 0), or just detach if @key is 0.
+ * Returns whether it succeeded. */
+static gboolean
 hd_remote_texture_set_shm(HdRemoteTexture *tex, key_t key,
-                          guint width, guint height, guint bpp)
+                          guint width, guint height, guint bpp,
+                          guint nbuffers)
 {
   int shm_id;
   /* un-attach this segment */
@@ -473,15 +587,17 @@ hd_remote_texture_set_shm(HdRemoteTexture *tex, key_t key,
       tex->shm_height = 0;
       tex->shm_bpp = 0;
     }
+  tex->shm_buffers = 0;
+  tex->shm_current = -1;
 
   if (key == 0)
-    return;
+    return FALSE;
 
   tex->shm_key = key;
   tex->shm_width = width;
   tex->shm_height = height;
   tex->shm_bpp = bpp;
-  guint size = width*height*bpp;
+  guint size = width*height*bpp*MAX(nbuffers, 1);
   if ((shm_id = shmget(key, size, 0666)) < 0)
     {
       g_critical("%s: shmget failed, size %d", __FUNCTION__, size);
@@ -489,7 +605,7 @@ hd_remote_texture_set_shm(HdRemoteTexture *tex, key_t key,
       tex->shm_width = 0;
       tex->shm_height = 0;
       tex->shm_bpp = 0;
-      return;
+      return FALSE;
    }
   if ((tex->shm_addr = shmat(shm_id, NULL, SHM_RDONLY)) == (guchar *)-1)
     {
@@ -499,13 +615,15 @@ hd_remote_texture_set_shm(HdRemoteTexture *tex, key_t key,
       tex->shm_height = 0;
       tex->shm_bpp = 0;
       tex->shm_addr = 0;
-      return;
+      return FALSE;
     }
 
-  tidy_mem_texture_set_data(tex->texture,
-      tex->shm_addr,
-      tex->shm_width, tex->shm_height,
-      tex->shm_bpp);
+  /* In the buffered protocol we wait for the first frame. */
+  tex->shm_buffers = nbuffers;
+  if (!nbuffers)
+    tidy_mem_texture_set_data(tex->texture,
+        tex->shm_addr,
+        tex->shm_width, tex->shm_height,
+        tex->shm_bpp);
+  return TRUE;
 }
-
-
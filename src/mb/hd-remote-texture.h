@@ -28,6 +28,30 @@
 #include <matchbox/client-types/mb-wm-client-app.h>
 #include <tidy/tidy-mem-texture.h>
 
+/*
+ * The buffered protocol.  Instead of _HILDON_TEXTURE_CLIENT_MESSAGE_SHM
+ * the client may send _HILDON_TEXTURE_CLIENT_MESSAGE_BUFFERS with the
+ * shm key, width, height, bytes per pixel and the number of frames the
+ * segment has room for, one after the other.  We accept by releasing
+ * every buffer; a client which hears nothing should fall back to the
+ * single buffer and damage.
+ *
+ * The client writes a frame into a buffer it has been released, then
+ * sends _HILDON_TEXTURE_CLIENT_MESSAGE_PRESENT with the buffer, a serial
+ * of its choice, x << 16 | y and width << 16 | height of what changed
+ * since the previous frame.  A presented buffer must hold a complete
+ * frame: we read the tiles we haven't uploaded yet from whichever buffer
+ * was presented last, and they may be any part of it.  The client must
+ * not touch the buffer until we send _HILDON_TEXTURE_CLIENT_MESSAGE_RELEASE
+ * with the buffer and its serial.
+ *
+ * We release the previous buffer as soon as the next one is presented,
+ * since from then on we only read the new one, so we never hold more
+ * than one.  The client writes the other meanwhile, and a third buffer
+ * wouldn't let it get any further ahead.
+ */
+#define HD_REMOTE_TEXTURE_MAX_BUFFERS 2
+
 typedef struct HdRemoteTexture      HdRemoteTexture;
 typedef struct HdRemoteTextureClass HdRemoteTextureClass;
 
@@ -49,6 +73,14 @@ struct HdRemoteTexture
   guint         shm_height;
   guint         shm_bpp;
   const guchar *shm_addr;
+
+  /* Number of frames in the segment if the client uses the buffered
+   * protocol, 0 otherwise. */
+  guint         shm_buffers;
+  /* The frame we show, or -1 if none has been presented yet. */
+  gint          shm_current;
+  /* What the client presented the frames with, given back on release. */
+  gulong        shm_serials[HD_REMOTE_TEXTURE_MAX_BUFFERS];
 };
 
 struct HdRemoteTextureClass
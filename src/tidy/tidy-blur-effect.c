@@ -5,6 +5,8 @@
 #include <cogl/cogl.h>
 
 #include "tidy-blur-effect.h"
+#include "tidy-blur-plan.h"
+#include "tidy-util.h"
 
 #include <string.h>
 
@@ -55,6 +57,25 @@ static const gchar *blur_glsl_texture_shader =
     "       texture2D (cogl_sampler, vec2(cogl_tex_coord0_in.x, cogl_tex_coord0_in.y)) * 0.5; \n"
     "cogl_texel = color;\n";
 
+/* Desaturation and chequering are done while the blurred texture is
+ * drawn to the screen, so they don't need a pass of their own. */
+static const gchar *composite_glsl_declarations =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform float saturation;\n"
+    "uniform float chequer;\n";
+
+static const gchar *composite_glsl_shader =
+    "float lightness = (cogl_color_out.r + cogl_color_out.g +\n"
+    "                   cogl_color_out.b) * 0.333;\n"
+    "cogl_color_out.rgb = mix (vec3 (lightness), cogl_color_out.rgb,\n"
+    "                          saturation);\n"
+    "/* 25:75 pattern of black pixels */\n"
+    "if (chequer > 0.0 &&\n"
+    "    mod (floor (gl_FragCoord.x) + floor (gl_FragCoord.y), 4.0) >= 1.0)\n"
+    "  cogl_color_out.rgb = vec3 (0.0);\n";
+
 struct _TidyBlurEffect
 {
   ClutterOffscreenEffect parent_instance;
@@ -68,9 +89,15 @@ struct _TidyBlurEffect
 
   CoglPipeline *pipeline;
   CoglPipeline *shader_pipeline;
+  CoglPipeline *composite_pipeline;
 
   gint blur_uniform;
+  gint saturation_uniform;
+  gint chequer_uniform;
 
+  /* @tex and @fb are those of @target, leased from the pool while we
+   * are on an actor. */
+  TidyTarget *target[2];
   CoglHandle tex[2];
   CoglHandle fb[2];
   int fb_index;
@@ -80,6 +107,27 @@ struct _TidyBlurEffect
   guint max_blur;
   gfloat zoom;
   gfloat brigtness;
+  gfloat saturation;
+  gboolean chequer;
+
+  /* While we are blurred we keep painting the blurred texture we have
+   * even if the actor is redrawn, a blurred image doesn't show small
+   * changes anyway.  @source_changed makes us redraw the actor and blur
+   * it again on the next paint, @source_stale on the next change of
+   * the blur amount. */
+  gboolean source_changed;
+  gboolean source_stale;
+
+  /* In pyramid mode we halve @tex[0] @n_levels times into @level_tex,
+   * blur the smallest level needed and scale it back up, instead of
+   * blurring @tex as many times as @blur says.  @result is the blurred
+   * texture, one of @tex or @level_tex. */
+  gboolean pyramid;
+  TidyTarget *level_target[TIDY_BLUR_LEVELS][2];
+  CoglHandle level_tex[TIDY_BLUR_LEVELS][2];
+  CoglHandle level_fb[TIDY_BLUR_LEVELS][2];
+  guint n_levels;
+  CoglHandle result;
 };
 
 struct _TidyBlurEffectClass
@@ -88,6 +136,7 @@ struct _TidyBlurEffectClass
 
   CoglPipeline *base_pipeline;
   CoglPipeline *shader_pipeline;
+  CoglPipeline *composite_pipeline;
 };
 
 G_DEFINE_TYPE (TidyBlurEffect,
@@ -95,30 +144,123 @@ G_DEFINE_TYPE (TidyBlurEffect,
                CLUTTER_TYPE_OFFSCREEN_EFFECT)
 
 static void
-tidy_blur_effect_create_textures(ClutterOffscreenEffect *effect,
-                                       gfloat width, gfloat height)
+tidy_blur_effect_free_levels(TidyBlurEffect *self)
+{
+  guint l, i;
+
+  for (l = 0; l < self->n_levels; l++)
+    for (i = 0; i < 2; i++)
+      {
+        tidy_util_release_target(self->level_target[l][i]);
+        self->level_target[l][i] = NULL;
+        self->level_fb[l][i] = NULL;
+        self->level_tex[l][i] = NULL;
+      }
+  self->n_levels = 0;
+  self->result = NULL;
+}
+
+/* Makes the levels of the pyramid for the current size of @tex. */
+static void
+tidy_blur_effect_create_levels(ClutterOffscreenEffect *effect)
 {
   TidyBlurEffect *self = TIDY_BLUR_EFFECT (effect);
+  gint width, height;
+  guint i;
 
-  if (self->fb[0])
+  width  = cogl_texture_get_width (self->tex[0]);
+  height = cogl_texture_get_height (self->tex[0]);
+  while (self->n_levels < TIDY_BLUR_LEVELS)
     {
-      cogl_object_unref(self->fb[0]);
-      cogl_object_unref(self->tex[0]);
+      width /= 2;
+      height /= 2;
+      if (width < TIDY_BLUR_LEVEL_MIN || height < TIDY_BLUR_LEVEL_MIN)
+        break;
+
+      for (i = 0; i < 2; i++)
+        {
+          TidyTarget *target;
+
+          target = tidy_util_lease_target (width, height,
+                                           COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+          if (!target)
+            {
+              /* Make do with the levels we have, even none. */
+              if (i)
+                {
+                  tidy_util_release_target (
+                                self->level_target[self->n_levels][0]);
+                  self->level_target[self->n_levels][0] = NULL;
+                  self->level_tex[self->n_levels][0] = NULL;
+                  self->level_fb[self->n_levels][0] = NULL;
+                }
+              return;
+            }
+          self->level_target[self->n_levels][i] = target;
+          self->level_tex[self->n_levels][i] = target->texture;
+          self->level_fb[self->n_levels][i] = target->fb;
+        }
+      self->n_levels++;
     }
-  if (self->fb[1])
+}
+
+/* Gives the textures back to the pool. */
+static void
+tidy_blur_effect_free_textures(TidyBlurEffect *self)
+{
+  guint i;
+
+  tidy_blur_effect_free_levels(self);
+  for (i = 0; i < 2; i++)
     {
-      cogl_object_unref(self->fb[1]);
-      cogl_object_unref(self->tex[1]);
+      tidy_util_release_target(self->target[i]);
+      self->target[i] = NULL;
+      self->fb[i] = NULL;
+      self->tex[i] = NULL;
     }
+}
+
+/* Returns FALSE if there are no textures for it, then we don't blur. */
+static gboolean
+tidy_blur_effect_create_textures(ClutterOffscreenEffect *effect,
+                                       gfloat width, gfloat height)
+{
+  TidyBlurEffect *self = TIDY_BLUR_EFFECT (effect);
+  guint i;
 
-  self->tex[0] =
-      clutter_offscreen_effect_create_texture (effect, width, height);
-  self->tex[1] =
-      clutter_offscreen_effect_create_texture (effect, width, height);
-  self->fb[0] = cogl_offscreen_new_with_texture (self->tex[0]);
-  self->fb[1] = cogl_offscreen_new_with_texture (self->tex[1]);
+  tidy_blur_effect_free_textures(self);
+  for (i = 0; i < 2; i++)
+    {
+      self->target[i] =
+          tidy_util_lease_target (width, height,
+                                  COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (!self->target[i])
+        {
+          tidy_blur_effect_free_textures(self);
+          return FALSE;
+        }
+      self->tex[i] = self->target[i]->texture;
+      self->fb[i] = self->target[i]->fb;
+    }
+  return TRUE;
 }
 
+/* Off an actor we have nothing to blur, let others use the textures. */
+static void
+tidy_blur_effect_set_actor (ClutterActorMeta *meta, ClutterActor *actor)
+{
+  TidyBlurEffect *self = TIDY_BLUR_EFFECT (meta);
+
+  CLUTTER_ACTOR_META_CLASS (tidy_blur_effect_parent_class)->set_actor (meta,
+                                                                       actor);
+  if (!actor)
+    {
+      tidy_blur_effect_free_textures(self);
+      self->tex_width = self->tex_height = 0;
+      self->current_blur = 0;
+      self->max_blur = 0;
+    }
+}
 
 static gboolean
 tidy_blur_effect_pre_paint (ClutterEffect *effect)
@@ -158,12 +300,10 @@ tidy_blur_effect_pre_paint (ClutterEffect *effect)
       tex_width = cogl_texture_get_width (texture);
       tex_height = cogl_texture_get_height (texture);
 
-      if (!self->tex[0] || self->tex_width != tex_width ||
-          self->tex_height != tex_height)
+      if (self->tex_width != tex_width || self->tex_height != tex_height)
         {
-          tidy_blur_effect_create_textures(offscreen_effect,
-                                                    tex_width / 2,
-                                                    tex_height / 2);
+          /* Made again when we first blur. */
+          tidy_blur_effect_free_textures(self);
           self->tex_width = tex_width;
           self->tex_height = tex_height;
 
@@ -180,8 +320,11 @@ tidy_blur_effect_pre_paint (ClutterEffect *effect)
       self->texture = texture;
       cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
 
+      /* The actor was redrawn, so blur it from scratch. */
       self->current_blur = 0;
       self->max_blur = 0;
+      self->source_changed = FALSE;
+      self->source_stale = FALSE;
 
       return TRUE;
     }
@@ -189,6 +332,21 @@ tidy_blur_effect_pre_paint (ClutterEffect *effect)
     return FALSE;
 }
 
+static void
+tidy_blur_effect_paint (ClutterEffect *effect, ClutterEffectPaintFlags flags)
+{
+  TidyBlurEffect *self = TIDY_BLUR_EFFECT (effect);
+
+  /* Without ACTOR_DIRTY ClutterOffscreenEffect paints the texture it has
+   * if it can, and we blur that only as much more as needed. */
+  if (self->source_changed)
+    flags |= CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
+  else if (self->current_blur)
+    flags &= ~CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
+
+  CLUTTER_EFFECT_CLASS (tidy_blur_effect_parent_class)->paint (effect, flags);
+}
+
 static void
 tidy_blur_effect_do_blur(ClutterOffscreenEffect *effect, gint steps)
 {
@@ -210,6 +368,73 @@ tidy_blur_effect_do_blur(ClutterOffscreenEffect *effect, gint steps)
     }
 }
 
+/* Draws @texture to @fb the same way up, with @pipeline. */
+static void
+tidy_blur_effect_draw(CoglPipeline *pipeline, CoglHandle texture,
+                      CoglHandle fb)
+{
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_framebuffer_draw_rectangle (fb, pipeline, -1.0, 1.0, 1.0, -1.0);
+}
+
+/* Sets how far the blur shader looks, in texels of a level. */
+static void
+tidy_blur_effect_set_step(TidyBlurEffect *self, guint level)
+{
+  gfloat blur[2];
+
+  blur[0] = (gfloat)(1 << level) / self->tex_width;
+  blur[1] = (gfloat)(1 << level) / self->tex_height;
+  cogl_pipeline_set_uniform_float (self->shader_pipeline, self->blur_uniform,
+                                   2, 1, blur);
+}
+
+/* Blurs @self->texture in pyramid mode and returns the result. */
+static CoglHandle
+tidy_blur_effect_pyramid_blur(ClutterOffscreenEffect *effect)
+{
+  TidyBlurEffect *self = TIDY_BLUR_EFFECT (effect);
+  CoglHandle tex[TIDY_BLUR_LEVELS+1][2], fb[TIDY_BLUR_LEVELS+1][2];
+  guint level, passes, l, cur;
+
+  if (!self->n_levels)
+    tidy_blur_effect_create_levels(effect);
+
+  /* Level 0 is the half size textures we have anyway. */
+  tex[0][0] = self->tex[0]; tex[0][1] = self->tex[1];
+  fb[0][0]  = self->fb[0];  fb[0][1]  = self->fb[1];
+  for (l = 0; l < self->n_levels; l++)
+    {
+      tex[l+1][0] = self->level_tex[l][0];
+      tex[l+1][1] = self->level_tex[l][1];
+      fb[l+1][0]  = self->level_fb[l][0];
+      fb[l+1][1]  = self->level_fb[l][1];
+    }
+  level = tidy_blur_plan_pyramid(self->blur, self->n_levels, &passes);
+
+  /* Down, with the linear filter averaging four texels each time. */
+  tidy_blur_effect_draw (self->pipeline, self->texture, fb[0][0]);
+  for (l = 1; l <= level; l++)
+    tidy_blur_effect_draw (self->pipeline, tex[l-1][0], fb[l][0]);
+
+  /* Blur, */
+  tidy_blur_effect_set_step (self, level);
+  for (cur = 0; passes--; cur = !cur)
+    tidy_blur_effect_draw (self->shader_pipeline, tex[level][cur],
+                           fb[level][!cur]);
+  tidy_blur_effect_set_step (self, 0);
+
+  /* and up again. */
+  for (l = level; l > 0; l--, cur = 0)
+    tidy_blur_effect_draw (self->pipeline, tex[l][cur], fb[l-1][0]);
+
+  /* The passes mode expects @pipeline to draw the actor's texture, even
+   * if there's no pre_paint() between switching modes. */
+  cogl_pipeline_set_layer_texture (self->pipeline, 0, self->texture);
+
+  return tex[0][cur];
+}
+
 static void
 tidy_blur_effect_vignette(gfloat width, gfloat height, gint opacity,
                                 gfloat zoom)
@@ -292,8 +517,27 @@ tidy_blur_effect_paint_target (ClutterOffscreenEffect *effect)
   CoglHandle texture;
   guint8 brigtness = opacity * self->brigtness;
   gfloat blur_opacity = 1.0f;
+  gboolean blur;
 
-  if (self->blur)
+  /* Only desaturating or dimming doesn't need them.  Without them we
+   * paint unblurred rather than not at all. */
+  blur = self->blur
+    && (self->tex[0]
+        || tidy_blur_effect_create_textures(effect, self->tex_width / 2,
+                                            self->tex_height / 2));
+
+  if (blur && self->pyramid)
+    {
+      /* It's cheap enough to do it again whenever @blur changes. */
+      if (self->blur != self->current_blur)
+        {
+          self->result = tidy_blur_effect_pyramid_blur(effect);
+          self->max_blur = self->blur;
+          self->current_blur = self->blur;
+        }
+      texture = self->result;
+    }
+  else if (blur)
     {
       if (self->blur > self->max_blur)
         {
@@ -333,30 +577,33 @@ tidy_blur_effect_paint_target (ClutterOffscreenEffect *effect)
       texture = self->texture;
   }
 
-  cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
-
-  ClutterActorBox box;
+  cogl_pipeline_set_layer_texture (self->composite_pipeline, 0, texture);
+  cogl_pipeline_set_uniform_1f (self->composite_pipeline,
+                                self->saturation_uniform, self->saturation);
+  cogl_pipeline_set_uniform_1f (self->composite_pipeline,
+                                self->chequer_uniform, self->chequer);
 
   gfloat width = self->tex_width;
   gfloat height = self->tex_height;
 
   gfloat zoom_factor = (1.0f - self->zoom) / 2.0f;
 
-  clutter_actor_get_allocation_box(self->actor, &box);
+  /* Keep the vignette within the actor.  We're drawing in stage
+   * coordinates from the corner of the transformed paint box of the
+   * actor, which the texture covers, so this is right wherever the actor
+   * is nested or scaled, like the thumbnails of the task navigator. */
+  cogl_clip_push_rectangle(0, 0, width, height);
 
   cogl_push_matrix();
 
   cogl_translate(width * zoom_factor, height * zoom_factor, 0);
   cogl_scale(self->zoom, self->zoom, 0.0f);
 
-  cogl_clip_push_window_rectangle(box.x1, box.y1,
-                                  box.x2 - box.x1, box.y2 - box.y1);
-
   if (blur_opacity != 1.0f)
   {
-      cogl_pipeline_set_color4ub (self->pipeline, brigtness, brigtness,
-                                  brigtness, opacity);
-      cogl_push_source (self->pipeline);
+      cogl_pipeline_set_color4ub (self->composite_pipeline, brigtness,
+                                  brigtness, brigtness, opacity);
+      cogl_push_source (self->composite_pipeline);
       cogl_rectangle_with_texture_coords(0, 0, width, height, 0, 0, 1, 1);
 
       /* If we're zooming less than 1, we want to re-render everything
@@ -369,9 +616,9 @@ tidy_blur_effect_paint_target (ClutterOffscreenEffect *effect)
       brigtness *= blur_opacity;
   }
 
-  cogl_pipeline_set_color4ub (self->pipeline, brigtness, brigtness, brigtness,
-                              brigtness);
-  cogl_push_source (self->pipeline);
+  cogl_pipeline_set_color4ub (self->composite_pipeline, brigtness, brigtness,
+                              brigtness, brigtness);
+  cogl_push_source (self->composite_pipeline);
   cogl_rectangle_with_texture_coords(0, 0, width, height, 0, 0, 1, 1);
 
   /* If we're zooming less than 1, we want to re-render everything
@@ -382,9 +629,9 @@ tidy_blur_effect_paint_target (ClutterOffscreenEffect *effect)
 
   cogl_pop_source ();
 
-  cogl_clip_pop();
   cogl_pop_matrix();
-  cogl_pipeline_set_color4ub (self->pipeline, 255, 255, 255, 255);
+  cogl_clip_pop();
+  cogl_pipeline_set_color4ub (self->composite_pipeline, 255, 255, 255, 255);
 }
 
 static void
@@ -404,21 +651,14 @@ tidy_blur_effect_dispose (GObject *gobject)
       self->shader_pipeline = NULL;
     }
 
-  if (self->fb[0])
+  if (self->composite_pipeline != NULL)
     {
-      cogl_object_unref(self->fb[0]);
-      cogl_object_unref(self->tex[0]);
-      self->fb[0] = NULL;
-      self->tex[0] = NULL;
-    }
-  if (self->fb[1])
-    {
-      cogl_object_unref(self->fb[1]);
-      cogl_object_unref(self->tex[1]);
-      self->fb[1] = NULL;
-      self->tex[1] = NULL;
+      cogl_object_unref (self->composite_pipeline);
+      self->composite_pipeline = NULL;
     }
 
+  tidy_blur_effect_free_textures(self);
+
   G_OBJECT_CLASS (tidy_blur_effect_parent_class)->dispose (gobject);
 }
 
@@ -426,12 +666,16 @@ static void
 tidy_blur_effect_class_init (TidyBlurEffectClass *klass)
 {
   ClutterEffectClass *effect_class = CLUTTER_EFFECT_CLASS (klass);
+  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   ClutterOffscreenEffectClass *offscreen_class;
 
   gobject_class->dispose = tidy_blur_effect_dispose;
 
+  meta_class->set_actor = tidy_blur_effect_set_actor;
+
   effect_class->pre_paint = tidy_blur_effect_pre_paint;
+  effect_class->paint = tidy_blur_effect_paint;
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->paint_target = tidy_blur_effect_paint_target;
@@ -486,6 +730,14 @@ tidy_blur_effect_init (TidyBlurEffect *self)
                                             COGL_TEXTURE_TYPE_2D);
       cogl_pipeline_set_layer_wrap_mode (klass->base_pipeline, 0,
                                          COGL_PIPELINE_WRAP_MODE_MIRRORED_REPEAT);
+
+      /* pipeline drawing the result to the screen */
+      klass->composite_pipeline = cogl_pipeline_copy (klass->base_pipeline);
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                                  composite_glsl_declarations,
+                                  composite_glsl_shader);
+      cogl_pipeline_add_snippet (klass->composite_pipeline, snippet);
+      cogl_object_unref (snippet);
     }
 
   self->pipeline = cogl_pipeline_copy (klass->base_pipeline);
@@ -494,10 +746,19 @@ tidy_blur_effect_init (TidyBlurEffect *self)
   self->blur_uniform =
       cogl_pipeline_get_uniform_location (self->shader_pipeline, "blur");
 
+  self->composite_pipeline = cogl_pipeline_copy (klass->composite_pipeline);
+  self->saturation_uniform =
+      cogl_pipeline_get_uniform_location (self->composite_pipeline,
+                                          "saturation");
+  self->chequer_uniform =
+      cogl_pipeline_get_uniform_location (self->composite_pipeline,
+                                          "chequer");
+
   self->blur = 0;
   self->current_blur = 0;
   self->zoom = 1.0f;
   self->brigtness = 1.0f;
+  self->saturation = 1.0f;
 }
 
 ClutterEffect *
@@ -519,10 +780,54 @@ tidy_blur_effect_set_blur(ClutterEffect *effect, guint blur)
   if (self->blur != blur)
     {
       self->blur = blur;
+      if (self->source_stale)
+        self->source_changed = TRUE;
+      clutter_effect_queue_repaint (effect);
+    }
+}
+
+/* Switches between blurring as many times as the blur amount says and
+ * blurring a smaller copy, which costs about the same for any amount. */
+void
+tidy_blur_effect_set_pyramid(ClutterEffect *effect, gboolean pyramid)
+{
+  TidyBlurEffect *self;
+
+  if (!TIDY_IS_BLUR_EFFECT(effect))
+    return;
+
+  self = TIDY_BLUR_EFFECT(effect);
+  if (self->pyramid != !!pyramid)
+    {
+      self->pyramid = !!pyramid;
+      /* Start over from the texture we have. */
+      self->current_blur = 0;
+      self->max_blur = 0;
       clutter_effect_queue_repaint (effect);
     }
 }
 
+/* Makes the next paint redraw the actor and blur it again. */
+void
+tidy_blur_effect_set_source_changed(ClutterEffect *effect)
+{
+  if (!TIDY_IS_BLUR_EFFECT(effect))
+    return;
+
+  TIDY_BLUR_EFFECT(effect)->source_changed = TRUE;
+}
+
+/* Makes the next change of the blur amount redraw the actor, the
+ * blurred texture we have will do until then. */
+void
+tidy_blur_effect_hint_source_changed(ClutterEffect *effect)
+{
+  if (!TIDY_IS_BLUR_EFFECT(effect))
+    return;
+
+  TIDY_BLUR_EFFECT(effect)->source_stale = TRUE;
+}
+
 guint
 tidy_blur_effect_get_blur(ClutterEffect *self)
 {
@@ -575,3 +880,40 @@ tidy_blur_effect_get_brigtness(ClutterEffect *self)
 
   return TIDY_BLUR_EFFECT(self)->brigtness;
 }
+
+void
+tidy_blur_effect_set_saturation(ClutterEffect *self, gfloat saturation)
+{
+  if (!TIDY_IS_BLUR_EFFECT(self))
+    return;
+
+  if (TIDY_BLUR_EFFECT(self)->saturation != saturation)
+    {
+      TIDY_BLUR_EFFECT(self)->saturation = saturation;
+      clutter_effect_queue_repaint (self);
+    }
+}
+
+gfloat
+tidy_blur_effect_get_saturation(ClutterEffect *self)
+{
+  if (!TIDY_IS_BLUR_EFFECT(self))
+      return 1.0f;
+
+  return TIDY_BLUR_EFFECT(self)->saturation;
+}
+
+/* Blacks out three of every four pixels, for dimming what can't be
+ * blurred, like video overlays. */
+void
+tidy_blur_effect_set_chequer(ClutterEffect *self, gboolean chequer)
+{
+  if (!TIDY_IS_BLUR_EFFECT(self))
+    return;
+
+  if (TIDY_BLUR_EFFECT(self)->chequer != !!chequer)
+    {
+      TIDY_BLUR_EFFECT(self)->chequer = !!chequer;
+      clutter_effect_queue_repaint (self);
+    }
+}
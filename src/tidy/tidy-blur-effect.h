@@ -22,6 +22,12 @@ void tidy_blur_effect_set_zoom(ClutterEffect *self, gfloat zoom);
 gfloat tidy_blur_effect_get_zoom(ClutterEffect *self);
 void tidy_blur_effect_set_brigtness(ClutterEffect *self, gfloat brigtness);
 gfloat tidy_blur_effect_get_brigtness(ClutterEffect *self);
+void tidy_blur_effect_set_saturation(ClutterEffect *self, gfloat saturation);
+gfloat tidy_blur_effect_get_saturation(ClutterEffect *self);
+void tidy_blur_effect_set_chequer(ClutterEffect *self, gboolean chequer);
+void tidy_blur_effect_set_pyramid(ClutterEffect *self, gboolean pyramid);
+void tidy_blur_effect_set_source_changed(ClutterEffect *self);
+void tidy_blur_effect_hint_source_changed(ClutterEffect *self);
 
 G_END_DECLS
 
@@ -2,9 +2,9 @@
  *
  * This class blurs all of its children, also changing saturation and lightness.
  * It renders its children into a half-size texture first, then blurs this into
- * another texture, finally rendering that to the screen. Because of this, when
- * the blurring doesn't change from frame to frame, children and NOT rendered,
- * making this pretty quick. */
+ * another texture, finally rendering that to the screen, desaturated, dimmed
+ * and chequered on the way. Because of this, when the blurring doesn't change
+ * from frame to frame, children and NOT rendered, making this pretty quick. */
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 #define COGL_ENABLE_EXPERIMENTAL_API
 
@@ -29,15 +29,9 @@
 /* #define it something sane */
 #define TIDY_IS_SANE_BLUR_GROUP(obj)    ((obj) != NULL)
 
-/* Chequer is 32x32 because that's the smallest SGX will do. If we go smaller
- * it just ends up getting put in a block that size anyway */
-#define CHEQUER_SIZE (32)
-
 struct _TidyBlurGroupPrivate
 {
   /* Internal TidyBlurGroup stuff */
-  CoglHandle tex_chequer; /* chequer texture used for dimming video overlays */
-
   float saturation; /* 0->1 how much colour there is */
   float brightness; /* 1=normal, 0=black */
   float zoom; /* amount to zoom. 1=normal, 0.5=out, 2=double-size */
@@ -45,14 +39,15 @@ struct _TidyBlurGroupPrivate
   gboolean use_mirror; /* whether to mirror the edge of teh blurred texture */
   gboolean chequer; /* whether to chequer pattern the contents -
                        for dimming video overlays */
+  gboolean fuse; /* whether to desaturate, dim and chequer even unblurred */
 
   /* is the 'blurless desaturation' tweak enabled? */
   gboolean tweaks_blurless;
   /* saturation for blurless (0 no color, 1 full color) */
   float blurless_saturation;
 
+  /* Blurs, desaturates, dims and chequers in one go. */
   ClutterEffect *blur_effect;
-  ClutterEffect *saturation_effect;
 };
 
 /**
@@ -117,46 +112,12 @@ tidy_blur_group_fallback_blur(TidyBlurGroup *group, int tex_width, int tex_heigh
 }
 #endif
 
-#if 0
-/* If priv->chequer, draw a chequer pattern over the screen */
-static void
-tidy_blur_group_do_chequer(TidyBlurGroup *group, guint width, guint height)
-{
-  TidyBlurGroupPrivate *priv = group->priv;
-
-  if (!priv->chequer)
-    return;
-
-  CoglContext *ctx =
-    clutter_backend_get_cogl_context (clutter_get_default_backend ());
-
-  CoglPipeline *pipeline = cogl_pipeline_new (ctx);
-
-  cogl_pipeline_set_color4ub (pipeline, 0x00, 0x00, 0x00, 0xFF);
-  cogl_pipeline_set_layer_texture(pipeline, 0, priv->tex_chequer);
-  cogl_push_source (pipeline);
-  cogl_rectangle_with_texture_coords (0, 0, width, height, 0, 0,
-                                      1.0 * width/CHEQUER_SIZE,
-                                      1.0 * height/CHEQUER_SIZE);
-  cogl_pop_source ();
-
-  g_object_unref (pipeline);
-}
-
-#endif
-
 static void
 tidy_blur_group_dispose (GObject *gobject)
 {
   TidyBlurGroup *container = TIDY_BLUR_GROUP(gobject);
   TidyBlurGroupPrivate *priv = container->priv;
 
-  if (priv->tex_chequer)
-    {
-      cogl_texture_unref(priv->tex_chequer);
-      priv->tex_chequer = 0;
-    }
-
   if (priv->blur_effect != NULL)
     {
       g_object_unref(priv->blur_effect);
@@ -179,42 +140,19 @@ static void
 tidy_blur_group_init (TidyBlurGroup *self)
 {
   TidyBlurGroupPrivate *priv;
-  gint i = 0, x, y;
-  guchar dither_data[CHEQUER_SIZE*CHEQUER_SIZE];
 
   priv = self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                                    TIDY_TYPE_BLUR_GROUP,
                                                    TidyBlurGroupPrivate);
   priv->saturation = 1;
+  priv->brightness = 1;
   priv->use_alpha = TRUE;
   priv->use_mirror = FALSE;
 
   priv->tweaks_blurless = hd_transition_get_int("thp_tweaks", "blurless", 0);
   priv->blurless_saturation =
       hd_transition_get_double("thp_tweaks", "blurless_saturation", 0);
-
-  /* Dimming texture - a 32x32 chequer pattern */
-  for (y = 0; y < CHEQUER_SIZE; y++)
-    {
-      for (x = 0;x < CHEQUER_SIZE; x++)
-        {
-          /* A 50:50 chequer pattern:
-         * dither_data[i++] = ((x&1) == (y&1)) ? 255 : 0;*/
-
-          /* 25:75 pattern */
-          gint d = x + y;
-          dither_data[i++] = ((d&3) == 0) ? 0 : 255;
-        }
-    }
-
-  priv->tex_chequer = cogl_texture_new_from_data(
-      CHEQUER_SIZE,
-      CHEQUER_SIZE,
-      COGL_TEXTURE_NO_AUTO_MIPMAP,
-      COGL_PIXEL_FORMAT_A_8,
-      COGL_PIXEL_FORMAT_A_8,
-      CHEQUER_SIZE,
-      dither_data);
+  priv->fuse = hd_transition_get_int("blur", "fuse", 0);
 
   if (!hd_transition_get_int("blur", "turbo", 0) && !priv->tweaks_blurless)
     priv->blur_effect = g_object_ref(tidy_blur_effect_new());
@@ -222,6 +160,25 @@ tidy_blur_group_init (TidyBlurGroup *self)
     priv->blur_effect = NULL;
 }
 
+/* The effect is only there while it has something to do, otherwise
+ * the children are painted directly.  Unless [blur] fuse is set that's
+ * only while blurring, as it has always been. */
+static void
+tidy_blur_group_update_effect(ClutterActor *blur_group)
+{
+  TidyBlurGroupPrivate *priv = TIDY_BLUR_GROUP(blur_group)->priv;
+  gboolean needed;
+
+  needed = tidy_blur_effect_get_blur(priv->blur_effect) != 0
+    || (priv->fuse && (priv->saturation != 1 || priv->brightness != 1
+                       || priv->chequer));
+  if (needed && !clutter_actor_get_effect(blur_group, "blur"))
+    clutter_actor_add_effect_with_name (blur_group, "blur",
+                                        priv->blur_effect);
+  else if (!needed && clutter_actor_get_effect(blur_group, "blur"))
+    clutter_actor_remove_effect_by_name (blur_group, "blur");
+}
+
 /*
  * Public API
  */
@@ -242,7 +199,7 @@ tidy_blur_group_new (void)
 /**
  * tidy_blur_group_set_chequer:
  *
- * Sets whether to chequer the contents with a 50:50 pattern of black dots
+ * Sets whether to chequer the contents with a 25:75 pattern of black dots
  */
 void
 tidy_blur_group_set_chequer(ClutterActor *blur_group, gboolean chequer)
@@ -254,12 +211,15 @@ tidy_blur_group_set_chequer(ClutterActor *blur_group, gboolean chequer)
 
   priv = TIDY_BLUR_GROUP(blur_group)->priv;
 
+  /* Never applied without [blur] fuse. */
+  if (!priv->blur_effect || !priv->fuse)
+      return;
+
   if (priv->chequer != chequer)
     {
       priv->chequer = chequer;
-
-      if (clutter_actor_is_visible(blur_group))
-        clutter_actor_queue_redraw(blur_group);
+      tidy_blur_effect_set_chequer(priv->blur_effect, chequer);
+      tidy_blur_group_update_effect(blur_group);
     }
 }
 
@@ -281,18 +241,31 @@ tidy_blur_group_set_blur(ClutterActor *blur_group, float blur)
   if (!priv->blur_effect)
       return;
 
-  if (blur != 0.0f)
-    {
-      if (!clutter_actor_get_effect(blur_group, "blur"))
-        {
-          clutter_actor_add_effect_with_name (blur_group, "blur",
-                                              priv->blur_effect);
-        }
-    }
-  else
-    clutter_actor_remove_effect_by_name (blur_group, "blur");
-
   tidy_blur_effect_set_blur(priv->blur_effect, blur);
+  tidy_blur_group_update_effect(blur_group);
+}
+
+/**
+ * tidy_blur_group_set_pyramid:
+ *
+ * Sets whether to blur a downscaled copy of the contents, which costs
+ * about the same for any amount of blur set with
+ * tidy_blur_group_set_blur(), instead of blurring it that many times.
+ */
+void
+tidy_blur_group_set_pyramid(ClutterActor *blur_group, gboolean pyramid)
+{
+  TidyBlurGroupPrivate *priv;
+
+  if (!TIDY_IS_SANE_BLUR_GROUP(blur_group))
+      return;
+
+  priv = TIDY_BLUR_GROUP(blur_group)->priv;
+
+  if (!priv->blur_effect)
+      return;
+
+  tidy_blur_effect_set_pyramid(priv->blur_effect, pyramid);
 }
 
 /**
@@ -310,16 +283,13 @@ tidy_blur_group_set_saturation(ClutterActor *blur_group, float saturation)
 
   priv = TIDY_BLUR_GROUP(blur_group)->priv;
 
-  if (!priv->saturation_effect)
+  /* Never applied without [blur] fuse. */
+  if (!priv->blur_effect || !priv->fuse)
       return;
 
-/*
-  if (priv->saturation != saturation)
-    {
-      priv->saturation = saturation;
-      if (clutter_actor_is_visible(blur_group))
-        clutter_actor_queue_redraw(blur_group);
-    }*/
+  priv->saturation = saturation;
+  tidy_blur_effect_set_saturation(priv->blur_effect, saturation);
+  tidy_blur_group_update_effect(blur_group);
 }
 
 /**
@@ -340,7 +310,9 @@ tidy_blur_group_set_brightness(ClutterActor *blur_group, float brightness)
   if (!priv->blur_effect)
       return;
 
+  priv->brightness = brightness;
   tidy_blur_effect_set_brigtness(priv->blur_effect, brightness);
+  tidy_blur_group_update_effect(blur_group);
 }
 
 
@@ -435,31 +407,34 @@ tidy_blur_group_set_use_mirror(ClutterActor *blur_group, gboolean mirror)
 void
 tidy_blur_group_set_source_changed(ClutterActor *blur_group)
 {
-  /* TidyBlurGroupPrivate *priv; */
+  TidyBlurGroupPrivate *priv;
 
   if (!TIDY_IS_SANE_BLUR_GROUP(blur_group))
     return;
 
-  /* priv = TIDY_BLUR_GROUP(blur_group)->priv; */
+  priv = TIDY_BLUR_GROUP(blur_group)->priv;
+  if (priv->blur_effect)
+    tidy_blur_effect_set_source_changed(priv->blur_effect);
   clutter_actor_queue_redraw(blur_group);
 }
 
 /**
  * tidy_blur_group_hint_source_changed:
  *
- * Notifies the blur group that it needs to update next time it becomes
- * unblurred.
+ * Notifies the blur group that it needs to update next time the amount
+ * of blur changes.  Until then it keeps showing what it has blurred.
  */
 void
 tidy_blur_group_hint_source_changed(ClutterActor *blur_group)
 {
-  /* TidyBlurGroupPrivate *priv; */
+  TidyBlurGroupPrivate *priv;
 
   if (!TIDY_IS_SANE_BLUR_GROUP(blur_group))
     return;
-/*
+
   priv = TIDY_BLUR_GROUP(blur_group)->priv;
-  priv->source_changed = TRUE;*/
+  if (priv->blur_effect)
+    tidy_blur_effect_hint_source_changed(priv->blur_effect);
 }
 
 void
@@ -489,6 +464,6 @@ tidy_blur_group_source_buffered(ClutterActor *blur_group)
     return FALSE;
 
   priv = TIDY_BLUR_GROUP(blur_group)->priv;
-  return !(tidy_blur_effect_get_blur(priv->blur_effect) == 0
-           && priv->saturation == 1 && priv->brightness == 1);
+  return priv->blur_effect
+    && clutter_actor_get_effect(blur_group, "blur") != NULL;
 }
@@ -0,0 +1,20 @@
+/* The arithmetic of the blur pyramid of tidy-blur-effect.c, see
+ * tidy-blur-plan.h.  Only glib is used here so that the blur benchmark
+ * can use the same plan without a GL context. */
+
+#include "tidy-blur-plan.h"
+
+/* A texel at level l is 2^l texels at the top, so as the spread goes,
+ * a pass there counts as 4^l passes and going down and up again as
+ * 2*4^l - 1 more.  That makes at most 10 passes at any level. */
+guint
+tidy_blur_plan_pyramid (guint blur, guint n_levels, guint *passes)
+{
+  guint level;
+
+  for (level = 0; level < n_levels && 3u << (2 * (level+1)) <= blur + 2;
+       level++)
+    ;
+  *passes = ((blur + 2 + (1u << (2 * level)) / 2) >> (2 * level)) - 2;
+  return level;
+}
@@ -0,0 +1,20 @@
+#ifndef _TIDY_BLUR_PLAN
+#define _TIDY_BLUR_PLAN
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* How many times the pyramid of TidyBlurEffect may halve the half size
+ * textures, and the smallest level it bothers with. */
+#define TIDY_BLUR_LEVELS      5
+#define TIDY_BLUR_LEVEL_MIN   8
+
+/* How many times to halve the half size texture, out of the @n_levels
+ * there are, and how many times to blur it there (*@passes) to blur
+ * about as much as @blur passes at half size. */
+guint tidy_blur_plan_pyramid (guint blur, guint n_levels, guint *passes);
+
+G_END_DECLS
+
+#endif
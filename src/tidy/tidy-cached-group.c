@@ -23,6 +23,9 @@
 struct _TidyCachedGroupPrivate
 {
   /* Internal TidyCachedGroup stuff */
+  /* @tex and @fbo are those of @target, leased from the pool while we
+   * are caching. */
+  TidyTarget *target;
   CoglHandle tex;
   CoglHandle fbo;
   /* When we rendered to this texture, did we render rotated? */
@@ -36,12 +39,29 @@ struct _TidyCachedGroupPrivate
   gboolean source_changed;
   /* how much quality loss you can afford when rendering cached texture */
   float downsample;
+
+  /* Paints showing the cache as it was and after drawing it again. */
+  guint hits, misses;
 };
 
+/* All TidyCachedGroup:s for tidy_cached_group_dump_debug_info(). */
+static GSList *cached_groups;
+
 G_DEFINE_TYPE (TidyCachedGroup,
                tidy_cached_group,
                CLUTTER_TYPE_GROUP);
 
+/* Gives the texture back to the pool. */
+static void
+tidy_cached_group_free_texture (TidyCachedGroupPrivate *priv)
+{
+  tidy_util_release_target(priv->target);
+  priv->target = NULL;
+  priv->fbo = 0;
+  priv->tex = 0;
+  priv->source_changed = TRUE;
+}
+
 /* An implementation for the ClutterGroup::paint() vfunc,
    painting all the child actors: */
 static void
@@ -90,14 +110,7 @@ tidy_cached_group_paint (ClutterActor *actor)
 #if RESIZE_TEXTURE
   /* free texture if the size is wrong */
   if (tex_width!=exp_width || tex_height!=exp_height) {
-    if (priv->fbo)
-      {
-        cogl_offscreen_unref(priv->fbo);
-        cogl_texture_unref(priv->tex);
-        priv->fbo = 0;
-        priv->tex = 0;
-      }
-    priv->source_changed = TRUE;
+    tidy_cached_group_free_texture(priv);
   }
 #endif
   /* create the texture + offscreen buffer if they didn't exist. */
@@ -106,14 +119,21 @@ tidy_cached_group_paint (ClutterActor *actor)
       tex_width = exp_width;
       tex_height = exp_height;
 
-      priv->tex = cogl_texture_new_with_size(
-                tex_width, tex_height, COGL_TEXTURE_NO_AUTO_MIPMAP,
+      priv->target = tidy_util_lease_target(
+                tex_width, tex_height,
                 priv->use_alpha ? COGL_PIXEL_FORMAT_RGBA_8888 :
                                   COGL_PIXEL_FORMAT_RGB_565);
+      if (!priv->target)
+        {
+          CLUTTER_ACTOR_CLASS (tidy_cached_group_parent_class)->paint(actor);
+          return;
+        }
 #ifdef UPSTREAM_DISABLED
       cogl_texture_set_filters(priv->tex, CGL_NEAREST, CGL_NEAREST);
 #endif
-      priv->fbo = cogl_offscreen_new_to_texture (priv->tex);
+      priv->tex = priv->target->texture;
+      priv->fbo = priv->target->fb;
+      priv->source_changed = TRUE;
     }
   /* It may be that we have resized, but the texture has not.
    * If so, try and keep screen looking 'nice' by rotating so that
@@ -154,7 +174,10 @@ tidy_cached_group_paint (ClutterActor *actor)
       cogl_pop_matrix();
 
       priv->source_changed = FALSE;
+      priv->misses++;
     }
+  else
+    priv->hits++;
 
   /* Render what we've blurred to the screen */
   cogl_color_init_from_4ub(&col, 0xff, 0xff, 0xff,
@@ -201,13 +224,8 @@ tidy_cached_group_dispose (GObject *gobject)
   TidyCachedGroup *container = TIDY_CACHED_GROUP(gobject);
   TidyCachedGroupPrivate *priv = container->priv;
 
-  if (priv->fbo)
-    {
-      cogl_offscreen_unref(priv->fbo);
-      cogl_texture_unref(priv->tex);
-      priv->fbo = 0;
-      priv->tex = 0;
-    }
+  tidy_cached_group_free_texture(priv);
+  cached_groups = g_slist_remove (cached_groups, container);
 
   G_OBJECT_CLASS (tidy_cached_group_parent_class)->dispose (gobject);
 }
@@ -239,8 +257,11 @@ tidy_cached_group_init (TidyCachedGroup *self)
   priv->use_alpha = FALSE;
   priv->source_changed = TRUE;
 
+  priv->target = NULL;
   priv->tex = 0;
   priv->fbo = 0;
+
+  cached_groups = g_slist_prepend (cached_groups, self);
 }
 
 /*
@@ -280,6 +301,9 @@ void tidy_cached_group_set_render_cache(ClutterActor *cached_group, float amount
 
   if (priv->cache_amount != amount)
     {
+      /* We won't paint the texture for a while, let others use it. */
+      if (!amount)
+        tidy_cached_group_free_texture(priv);
       priv->cache_amount = amount;
       if (clutter_actor_is_visible(cached_group))
         clutter_actor_queue_redraw(cached_group);
@@ -310,4 +334,19 @@ void tidy_cached_group_changed(ClutterActor *cached_group)
   priv->source_changed = TRUE;
 }
 
+void tidy_cached_group_dump_debug_info(void)
+{
+  const GSList *li;
 
+  for (li = cached_groups; li; li = li->next)
+    {
+      TidyCachedGroupPrivate *priv = TIDY_CACHED_GROUP(li->data)->priv;
+      guint paints = priv->hits + priv->misses;
+
+      g_debug("%s: %u paints from the cache, %u hits (%.0f%%), %u misses",
+              clutter_actor_get_name(li->data)
+                ? clutter_actor_get_name(li->data) : "TidyCachedGroup",
+              paints, priv->hits, paints ? 100.0 * priv->hits / paints : 0,
+              priv->misses);
+    }
+}
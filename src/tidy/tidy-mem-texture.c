@@ -8,6 +8,7 @@
 #endif
 
 #include "tidy-mem-texture.h"
+#include "tidy-upload-schedule.h"
 #include "tidy-util.h"
 #include <clutter/clutter.h>
 
@@ -25,6 +26,9 @@
 #define TILE_SIZE_X 480
 #define TILE_SIZE_Y 480
 
+/* Default for tidy_mem_texture_set_upload_budget(). */
+#define DEFAULT_UPLOAD_BUDGET (1024 * 1024)
+
 /* ------------------------------------------------------------------------- */
 
 G_DEFINE_TYPE (TidyMemTexture,
@@ -41,6 +45,8 @@ typedef struct _TidyMemTextureTile
   ClutterGeometry pos; /* actual position in texture */
   ClutterGeometry modified; /* geometry for the area modified */
   CoglHandle texture;
+  /* FALSE until the first upload, the texture is undefined till then */
+  gboolean uploaded;
 } TidyMemTextureTile;
 
 struct _TidyMemTexturePrivate
@@ -63,16 +69,31 @@ struct _TidyMemTexturePrivate
   gfloat scale_x;
   gfloat scale_y;
 
-  GList *tiles; /* of TidyMemTextureTile */
+  /* tiles_x * tiles_y tiles, row by row */
+  TidyMemTextureTile *tiles;
+  gint tiles_x, tiles_y;
+  /* One bit per tile, set if its modified area is not empty. */
+  guint32 *dirty;
+  guint n_dirty;
+
+  /* Bytes to upload in an upload_id run, 0 if unlimited */
+  gsize upload_budget;
+  guint upload_id;
+  /* The tile the next upload_id run starts at */
+  gint upload_cursor;
 };
 
+#define TILE_IS_DIRTY(priv, i) ((priv)->dirty[(i) / 32] & (1u << ((i) % 32)))
+
 /* ------------------------------------------------------------------------- */
 
 static void
 tidy_mem_texture_free_data(TidyMemTexture *texture);
 static void
 tidy_mem_texture_update_modified(TidyMemTexture *texture,
-                                 TidyMemTextureTile *tile);
+                                 gint tile);
+static void
+tidy_mem_texture_schedule_upload(TidyMemTexture *texture);
 static void
 tidy_mem_texture_tile_coords(TidyMemTexture *texture,
                              TidyMemTextureTile *tile,
@@ -95,7 +116,7 @@ tidy_mem_texture_paint (ClutterActor *self)
   CoglColor                    col;
   ClutterActorBox box;
   gfloat                       width, height;
-  GList                       *tiles;
+  gint                         i;
 
   priv = TIDY_MEM_TEXTURE (self)->priv;
 
@@ -115,30 +136,28 @@ tidy_mem_texture_paint (ClutterActor *self)
   width = x_2 - x_1;
   height = y_2 - y_1;
 
-  /* changetextures before we start our rendering pass */
-  for (tiles = priv->tiles; tiles; tiles = tiles->next)
+  /* Modified tiles are normally uploaded by tidy_mem_texture_upload()
+   * before we're painted.  Only a tile which has never been uploaded
+   * is done here, we have nothing to show for it otherwise. */
+  for (i = 0; i < priv->tiles_x * priv->tiles_y; i++)
     {
-      TidyMemTextureTile *tile = tiles->data;
-      if (tidy_mem_texture_tile_visible(texture, tile, width, height))
-        {
-          /* we're visible, so update if modified, and render... */
-          if (tile->modified.width>0 && tile->modified.height>0)
-            tidy_mem_texture_update_modified(texture, tile);
-        }
-    }
-  /*next, do our rendering */
-  for (tiles = priv->tiles; tiles; tiles = tiles->next)
-    {
-      TidyMemTextureTile *tile = tiles->data;
-      if (tidy_mem_texture_tile_visible(texture, tile, width, height))
-        {
-          gfloat x1,y1,x2,y2;
-          tidy_mem_texture_tile_coords(texture, tile, &x1, &y1, &x2, &y2);
-          cogl_set_source_texture (tile->texture);
-          cogl_rectangle_with_texture_coords (x1, y1, x2, y2,
-                                              0, 0, 1.0, 1.0);
-        }
+      TidyMemTextureTile *tile = &priv->tiles[i];
+      gfloat x1,y1,x2,y2;
+
+      if (!tidy_mem_texture_tile_visible(texture, tile, width, height))
+        continue;
+      if (!tile->uploaded)
+        tidy_mem_texture_update_modified(texture, i);
+
+      tidy_mem_texture_tile_coords(texture, tile, &x1, &y1, &x2, &y2);
+      cogl_set_source_texture (tile->texture);
+      cogl_rectangle_with_texture_coords (x1, y1, x2, y2,
+                                          0, 0, 1.0, 1.0);
     }
+
+  /* Continue with the rest in the next frame. */
+  if (priv->n_dirty)
+    tidy_mem_texture_schedule_upload(texture);
 }
 
 
@@ -146,8 +165,13 @@ static void
 tidy_mem_texture_dispose (GObject *object)
 {
   TidyMemTexture         *self = TIDY_MEM_TEXTURE(object);
-  /*TidyMemTexturePrivate  *priv = self->priv;*/
+  TidyMemTexturePrivate  *priv = self->priv;
 
+  if (priv->upload_id)
+    {
+      g_source_remove(priv->upload_id);
+      priv->upload_id = 0;
+    }
   tidy_mem_texture_free_data(self);
   G_OBJECT_CLASS (tidy_mem_texture_parent_class)->dispose (object);
 }
@@ -192,6 +216,14 @@ tidy_mem_texture_init (TidyMemTexture *self)
   priv->scale_y = 1.0;
 
   priv->tiles = 0;
+  priv->tiles_x = 0;
+  priv->tiles_y = 0;
+  priv->dirty = 0;
+  priv->n_dirty = 0;
+
+  priv->upload_budget = DEFAULT_UPLOAD_BUDGET;
+  priv->upload_id = 0;
+  priv->upload_cursor = 0;
 }
 
 /**
@@ -217,20 +249,21 @@ static void
 tidy_mem_texture_free_data(TidyMemTexture *texture)
 {
   TidyMemTexturePrivate *priv;
+  gint i;
 
   if (!TIDY_IS_MEM_TEXTURE(texture))
     return;
   priv = texture->priv;
 
-  while (priv->tiles)
-    {
-      TidyMemTextureTile *tile = priv->tiles->data;
-      cogl_texture_unref(tile->texture);
-      g_free(tile);
-      priv->tiles = priv->tiles->next;
-    }
-  g_list_free(priv->tiles);
+  for (i = 0; i < priv->tiles_x * priv->tiles_y; i++)
+    cogl_texture_unref(priv->tiles[i].texture);
+  g_free(priv->tiles);
   priv->tiles = 0;
+  priv->tiles_x = priv->tiles_y = 0;
+  g_free(priv->dirty);
+  priv->dirty = 0;
+  priv->n_dirty = 0;
+  priv->upload_cursor = 0;
 
 #if EXACT_ROW_LENGTH
   if (priv->tile_buffer)
@@ -273,16 +306,23 @@ tidy_mem_texture_tile_visible(TidyMemTexture *texture,
  * we can get the data into OpenGL quickly. */
 static void
 tidy_mem_texture_update_modified(TidyMemTexture *texture,
-                                  TidyMemTextureTile *tile)
+                                 gint i)
 {
   TidyMemTexturePrivate *priv = texture->priv;
+  TidyMemTextureTile *tile = &priv->tiles[i];
   gint rowstride = priv->texture_width * priv->texture_bpp;
 #if EXACT_ROW_LENGTH
   gint y;
   gint rowlength = tile->modified.width * priv->texture_bpp;
   guchar *ptr_dst = priv->tile_buffer;
 #endif
-  const guchar *ptr_src = &priv->texture_ptr[
+  const guchar *ptr_src;
+
+  tile->uploaded = TRUE;
+  if (!TILE_IS_DIRTY(priv, i))
+    return;
+
+  ptr_src = &priv->texture_ptr[
                  (tile->pos.x + tile->modified.x +
                  (tile->pos.y + tile->modified.y)*priv->texture_width) *
                  priv->texture_bpp];
@@ -319,6 +359,73 @@ tidy_mem_texture_update_modified(TidyMemTexture *texture,
   tile->modified.y = 0;
   tile->modified.width = 0;
   tile->modified.height = 0;
+  priv->dirty[i / 32] &= ~(1u << (i % 32));
+  priv->n_dirty--;
+}
+
+/* TidyUploadCostFunc of tidy_mem_texture_upload() */
+static gsize
+tidy_mem_texture_upload_cost(gint i, gpointer data)
+{
+  TidyMemTexture *texture = data;
+  TidyMemTexturePrivate *priv = texture->priv;
+  TidyMemTextureTile *tile = &priv->tiles[i];
+  gfloat actor_width, actor_height;
+
+  if (!TILE_IS_DIRTY(priv, i))
+    return 0;
+  clutter_actor_get_size(CLUTTER_ACTOR(texture), &actor_width, &actor_height);
+  if (!tidy_mem_texture_tile_visible(texture, tile,
+                                     actor_width, actor_height))
+    return 0;
+  return MAX((gsize)tile->modified.width * tile->modified.height
+             * priv->texture_bpp, 1);
+}
+
+/* TidyUploadTileFunc of tidy_mem_texture_upload() */
+static void
+tidy_mem_texture_upload_tile(gint i, gpointer data)
+{
+  tidy_mem_texture_update_modified(TIDY_MEM_TEXTURE(data), i);
+}
+
+/* Upload the modified visible tiles before we're painted, but not
+ * more than priv->upload_budget bytes at a time, so a client damaging
+ * everything doesn't stall the frame.  Adjacent modified tiles in a row
+ * are uploaded in the same run, so a moving edge doesn't tear between
+ * them.  What's left is continued after the next paint, from where we
+ * stopped. */
+static gboolean
+tidy_mem_texture_upload(TidyMemTexture *texture)
+{
+  TidyMemTexturePrivate *priv = texture->priv;
+  guint n_dirty;
+
+  priv->upload_id = 0;
+  n_dirty = priv->n_dirty;
+  if (!n_dirty)
+    return FALSE;
+
+  tidy_upload_schedule_run(priv->tiles_x, priv->tiles_y,
+                           &priv->upload_cursor, priv->upload_budget,
+                           tidy_mem_texture_upload_cost,
+                           tidy_mem_texture_upload_tile, texture);
+  if (priv->n_dirty != n_dirty)
+    clutter_actor_queue_redraw(CLUTTER_ACTOR(texture));
+
+  return FALSE;
+}
+
+static void
+tidy_mem_texture_schedule_upload(TidyMemTexture *texture)
+{
+  TidyMemTexturePrivate *priv = texture->priv;
+
+  /* Run before the stage is painted. */
+  if (!priv->upload_id)
+    priv->upload_id = g_idle_add_full(CLUTTER_PRIORITY_REDRAW - 10,
+                                      (GSourceFunc)tidy_mem_texture_upload,
+                                      texture, NULL);
 }
 
 void tidy_mem_texture_set_data(TidyMemTexture *texture,
@@ -337,14 +444,13 @@ void tidy_mem_texture_set_data(TidyMemTexture *texture,
   priv->texture_ptr = data;
   if (priv->texture_ptr)
     {
-      gint tiles_x, tiles_y;
       gint x,y;
       priv->texture_width = width;
       priv->texture_height = height;
       priv->texture_bpp = bytes_per_pixel;
       priv->texture_format = 0;
-      tiles_x = (priv->texture_width+TILE_SIZE_X-1) / TILE_SIZE_X;
-      tiles_y = (priv->texture_height+TILE_SIZE_Y-1) / TILE_SIZE_Y;
+      priv->tiles_x = (priv->texture_width+TILE_SIZE_X-1) / TILE_SIZE_X;
+      priv->tiles_y = (priv->texture_height+TILE_SIZE_Y-1) / TILE_SIZE_Y;
       switch (priv->texture_bpp)
         {
           case 1:
@@ -365,11 +471,14 @@ void tidy_mem_texture_set_data(TidyMemTexture *texture,
       priv->tile_buffer = g_malloc(TILE_SIZE_X * TILE_SIZE_Y * priv->texture_bpp);
 #endif
       /* allocate tiles */
-      for (y=0;y<tiles_y;y++)
-        for (x=0;x<tiles_x;x++)
+      priv->tiles = g_new(TidyMemTextureTile, priv->tiles_x * priv->tiles_y);
+      priv->dirty = g_new0(guint32,
+                           (priv->tiles_x * priv->tiles_y + 31) / 32);
+      for (y=0;y<priv->tiles_y;y++)
+        for (x=0;x<priv->tiles_x;x++)
           {
-            TidyMemTextureTile *tile = g_malloc(sizeof(TidyMemTextureTile));
-            priv->tiles = g_list_append(priv->tiles, tile);
+            gint i = y * priv->tiles_x + x;
+            TidyMemTextureTile *tile = &priv->tiles[i];
             /* set coords */
             tile->pos.x = x*TILE_SIZE_X;
             tile->pos.y = y*TILE_SIZE_Y;
@@ -385,12 +494,16 @@ void tidy_mem_texture_set_data(TidyMemTexture *texture,
                   tile->pos.width, tile->pos.height,
                   COGL_TEXTURE_NO_AUTO_MIPMAP,
                   priv->texture_format);
+            tile->uploaded = FALSE;
             /* set whole area to be modified */
             tile->modified.x = 0;
             tile->modified.y = 0;
             tile->modified.width = tile->pos.width;
             tile->modified.height = tile->pos.height;
+            priv->dirty[i / 32] |= 1u << (i % 32);
+            priv->n_dirty++;
           }
+      tidy_mem_texture_schedule_upload(texture);
     }
   else
     {
@@ -402,24 +515,43 @@ void tidy_mem_texture_set_data(TidyMemTexture *texture,
     }
 }
 
+/* Makes @texture read the pixels from @data from now on, which has the
+ * same size and format as the previous data.  Nothing is reuploaded,
+ * the caller should damage what's different. */
+void tidy_mem_texture_set_data_ptr(TidyMemTexture *texture,
+                                   const guchar *data)
+{
+  if (!TIDY_IS_MEM_TEXTURE(texture) || !texture->priv->texture_ptr)
+    return;
+  texture->priv->texture_ptr = data;
+}
+
 void tidy_mem_texture_damage(TidyMemTexture *texture,
                              gint x, gint y,
                              gint width, gint height)
 {
   TidyMemTexturePrivate *priv;
-  GList *tiles;
-  gfloat actor_width, actor_height;
-  gboolean redraw = FALSE;
+  gint tx, ty, tx1, ty1, tx2, ty2;
+  gboolean damaged = FALSE;
 
   if (!TIDY_IS_MEM_TEXTURE(texture))
     return;
   priv = texture->priv;
 
-  clutter_actor_get_size(CLUTTER_ACTOR(texture), &actor_width, &actor_height);
+  if (!priv->tiles_x || !priv->tiles_y)
+    return;
+
+  /* The tiles touching the damage. */
+  tx1 = MAX(x, 0) / TILE_SIZE_X;
+  ty1 = MAX(y, 0) / TILE_SIZE_Y;
+  tx2 = MIN((x+width) / TILE_SIZE_X, priv->tiles_x-1);
+  ty2 = MIN((y+height) / TILE_SIZE_Y, priv->tiles_y-1);
 
-  for (tiles = priv->tiles; tiles; tiles = tiles->next)
+  for (ty = ty1; ty <= ty2; ty++)
+    for (tx = tx1; tx <= tx2; tx++)
     {
-      TidyMemTextureTile *tile = tiles->data;
+      gint i = ty * priv->tiles_x + tx;
+      TidyMemTextureTile *tile = &priv->tiles[i];
 
       if (tile->pos.x <= x+width &&
           tile->pos.y <= y+height &&
@@ -439,7 +571,7 @@ void tidy_mem_texture_damage(TidyMemTexture *texture,
           if (mod.height+mod.y > tile->pos.height)
             mod.height = tile->pos.height - mod.y;
 
-          if (tile->modified.width>0 && tile->modified.height>0)
+          if (TILE_IS_DIRTY(priv, i))
             {
               /* if we already have damage, extend damaged area */
               gint oldx2, oldy2, newx2, newy2;
@@ -459,21 +591,33 @@ void tidy_mem_texture_damage(TidyMemTexture *texture,
               tile->modified.width = oldx2 - tile->modified.x;
               tile->modified.height = oldy2 - tile->modified.y;
             }
-          else
+          else if (mod.width > 0 && mod.height > 0)
             {
               /* else just set damaged area */
               tile->modified = mod;
+              priv->dirty[i / 32] |= 1u << (i % 32);
+              priv->n_dirty++;
             }
+          else
+            continue;
 
-          /* only redraw if the changed tile is visible */
-          if (tidy_mem_texture_tile_visible(texture, tile,
-                                            actor_width, actor_height))
-            redraw = TRUE;
+          damaged = TRUE;
         }
     }
 
-  if (redraw)
-    clutter_actor_queue_redraw(CLUTTER_ACTOR(texture));
+  /* The upload queues a redraw if a changed tile is visible. */
+  if (damaged)
+    tidy_mem_texture_schedule_upload(texture);
+}
+
+/* Sets how many bytes of modified pixels may be uploaded before each
+ * frame.  0 means there is no limit. */
+void tidy_mem_texture_set_upload_budget(TidyMemTexture *texture,
+                                        gsize bytes)
+{
+  if (!TIDY_IS_MEM_TEXTURE(texture))
+    return;
+  texture->priv->upload_budget = bytes;
 }
 
 void tidy_mem_texture_set_offset(TidyMemTexture *texture,
@@ -489,6 +633,10 @@ void tidy_mem_texture_set_offset(TidyMemTexture *texture,
       priv->offset_x = x;
       priv->offset_y = y;
 
+      /* Tiles coming into view may need uploading. */
+      if (priv->n_dirty)
+        tidy_mem_texture_schedule_upload(texture);
+
       clutter_actor_queue_redraw(CLUTTER_ACTOR(texture));
     }
 }
@@ -507,6 +655,10 @@ void tidy_mem_texture_set_scale(TidyMemTexture *texture,
       priv->scale_x = scale_x;
       priv->scale_y = scale_y;
 
+      /* Tiles coming into view may need uploading. */
+      if (priv->n_dirty)
+        tidy_mem_texture_schedule_upload(texture);
+
       clutter_actor_queue_redraw(CLUTTER_ACTOR(texture));
     }
 }
@@ -78,6 +78,8 @@ void tidy_mem_texture_set_data(TidyMemTexture *texture,
                                const guchar *data,
                                gint width, gint height,
                                gint bytes_per_pixel);
+void tidy_mem_texture_set_data_ptr(TidyMemTexture *texture,
+                                   const guchar *data);
 void tidy_mem_texture_damage(TidyMemTexture *texture,
                              gint x, gint y,
                              gint width, gint height);
@@ -85,6 +87,8 @@ void tidy_mem_texture_set_offset(TidyMemTexture *texture,
                                  gfloat x, gfloat y);
 void tidy_mem_texture_set_scale(TidyMemTexture *texture,
                                 gfloat scale_x, gfloat scale_Y);
+void tidy_mem_texture_set_upload_budget(TidyMemTexture *texture,
+                                        gsize bytes);
 
 G_END_DECLS
 
@@ -0,0 +1,220 @@
+/* A pool of offscreen render targets keyed by size and format, see
+ * tidy-target-pool.h.  Only glib is used here so that it can be tested
+ * without a GL context. */
+
+#include "tidy-target-pool.h"
+
+/* The targets of one size and format. */
+typedef struct
+{
+  guint  width, height, format;
+  /* Idle TidyTargetEntry:s, most recently released last. */
+  GQueue idle;
+  /* How many of ours are leased.  The slot goes away when it has
+   * no targets left. */
+  guint  leased;
+} TidyTargetSlot;
+
+typedef struct
+{
+  TidyTarget      target;
+  TidyTargetSlot *slot;
+  gboolean        leased;
+  /* Our link in TidyTargetPool::lru while we're idle. */
+  GList          *lru_link;
+} TidyTargetEntry;
+
+struct _TidyTargetPool
+{
+  TidyTargetCreateFunc  create;
+  TidyTargetDestroyFunc destroy;
+  gpointer              user_data;
+
+  /* TidyTargetSlot -> itself */
+  GHashTable *slots;
+  /* All idle TidyTargetEntry:s, least recently released first. */
+  GQueue      lru;
+
+  /* Idle targets are freed while we take more memory than this. */
+  gsize       budget;
+  TidyTargetPoolStats stats;
+};
+
+static guint
+tidy_target_slot_hash (gconstpointer key)
+{
+  const TidyTargetSlot *slot = key;
+
+  return (slot->width * 33 + slot->height) * 33 + slot->format;
+}
+
+static gboolean
+tidy_target_slot_equal (gconstpointer a, gconstpointer b)
+{
+  const TidyTargetSlot *sa = a, *sb = b;
+
+  return sa->width == sb->width && sa->height == sb->height
+    && sa->format == sb->format;
+}
+
+static void
+tidy_target_slot_free (gpointer slot)
+{
+  g_queue_clear (&((TidyTargetSlot *)slot)->idle);
+  g_free (slot);
+}
+
+TidyTargetPool *
+tidy_target_pool_new (gsize budget, TidyTargetCreateFunc create,
+                      TidyTargetDestroyFunc destroy, gpointer user_data)
+{
+  TidyTargetPool *pool;
+
+  pool = g_new0 (TidyTargetPool, 1);
+  pool->create = create;
+  pool->destroy = destroy;
+  pool->user_data = user_data;
+  pool->budget = budget;
+  pool->slots = g_hash_table_new_full (tidy_target_slot_hash,
+                                       tidy_target_slot_equal,
+                                       NULL, tidy_target_slot_free);
+  g_queue_init (&pool->lru);
+
+  return pool;
+}
+
+/* Forgets @slot if it has no targets. */
+static void
+tidy_target_pool_drop_slot (TidyTargetPool *pool, TidyTargetSlot *slot)
+{
+  if (!slot->leased && g_queue_is_empty (&slot->idle))
+    g_hash_table_remove (pool->slots, slot);
+}
+
+/* Frees the least recently released idle targets until the pool fits
+ * into @budget or there are no idle targets left. */
+static void
+tidy_target_pool_evict (TidyTargetPool *pool, gsize budget)
+{
+  TidyTargetEntry *entry;
+
+  while (pool->stats.bytes_leased + pool->stats.bytes_idle > budget
+         && (entry = g_queue_pop_head (&pool->lru)) != NULL)
+    {
+      g_queue_remove (&entry->slot->idle, entry);
+      pool->stats.bytes_idle -= entry->target.bytes;
+      pool->stats.idle--;
+      pool->stats.evictions++;
+
+      pool->destroy (&entry->target, pool->user_data);
+      tidy_target_pool_drop_slot (pool, entry->slot);
+      g_free (entry);
+    }
+}
+
+void
+tidy_target_pool_free (TidyTargetPool *pool)
+{
+  if (!pool)
+    return;
+
+  tidy_target_pool_evict (pool, 0);
+  if (pool->stats.leased)
+    g_warning ("%s: %u targets still leased", __FUNCTION__,
+               pool->stats.leased);
+  g_hash_table_destroy (pool->slots);
+  g_free (pool);
+}
+
+TidyTarget *
+tidy_target_pool_lease (TidyTargetPool *pool, guint width, guint height,
+                        guint format)
+{
+  TidyTargetSlot key, *slot;
+  TidyTargetEntry *entry;
+
+  key.width = width;
+  key.height = height;
+  key.format = format;
+  slot = g_hash_table_lookup (pool->slots, &key);
+  if (!slot)
+    {
+      slot = g_new0 (TidyTargetSlot, 1);
+      slot->width = width;
+      slot->height = height;
+      slot->format = format;
+      g_queue_init (&slot->idle);
+      g_hash_table_insert (pool->slots, slot, slot);
+    }
+
+  if ((entry = g_queue_pop_tail (&slot->idle)) != NULL)
+    {
+      g_queue_delete_link (&pool->lru, entry->lru_link);
+      entry->lru_link = NULL;
+      pool->stats.bytes_idle -= entry->target.bytes;
+      pool->stats.idle--;
+      pool->stats.hits++;
+    }
+  else
+    {
+      entry = g_new0 (TidyTargetEntry, 1);
+      entry->slot = slot;
+      entry->target.width = width;
+      entry->target.height = height;
+      entry->target.format = format;
+      if (!pool->create (&entry->target, pool->user_data))
+        {
+          g_free (entry);
+          tidy_target_pool_drop_slot (pool, slot);
+          return NULL;
+        }
+      pool->stats.misses++;
+    }
+
+  entry->leased = TRUE;
+  slot->leased++;
+  pool->stats.bytes_leased += entry->target.bytes;
+  pool->stats.leased++;
+
+  /* Make room for what we've just made if we can. */
+  tidy_target_pool_evict (pool, pool->budget);
+
+  return &entry->target;
+}
+
+void
+tidy_target_pool_release (TidyTargetPool *pool, TidyTarget *target)
+{
+  TidyTargetEntry *entry = (TidyTargetEntry *)target;
+
+  if (!target)
+    return;
+  g_return_if_fail (entry->leased);
+
+  entry->leased = FALSE;
+  entry->slot->leased--;
+  pool->stats.bytes_leased -= target->bytes;
+  pool->stats.leased--;
+
+  g_queue_push_tail (&entry->slot->idle, entry);
+  g_queue_push_tail (&pool->lru, entry);
+  entry->lru_link = pool->lru.tail;
+  pool->stats.bytes_idle += target->bytes;
+  pool->stats.idle++;
+
+  tidy_target_pool_evict (pool, pool->budget);
+}
+
+void
+tidy_target_pool_set_budget (TidyTargetPool *pool, gsize budget)
+{
+  pool->budget = budget;
+  tidy_target_pool_evict (pool, budget);
+}
+
+void
+tidy_target_pool_get_stats (TidyTargetPool *pool, TidyTargetPoolStats *stats)
+{
+  *stats = pool->stats;
+  stats->slots = g_hash_table_size (pool->slots);
+}
@@ -0,0 +1,69 @@
+#ifndef _TIDY_TARGET_POOL
+#define _TIDY_TARGET_POOL
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Offscreen render targets (a texture and a framebuffer drawing into
+ * it) which effects lease while they need them and give back after,
+ * so that the next one asking for the same size and format gets them
+ * without allocating anything.  Targets given back are kept while the
+ * pool takes no more memory than its budget, least recently returned
+ * ones are freed first.  Leased targets are never freed.
+ *
+ * The pool only knows about sizes and pointers, making and freeing the
+ * textures is up to the functions it's created with. */
+typedef struct _TidyTargetPool TidyTargetPool;
+
+typedef struct
+{
+  /* What create() made, CoglHandle:s normally. */
+  gpointer texture;
+  gpointer fb;
+
+  guint    width, height, format;
+  /* How much memory the target takes, set by create(). */
+  gsize    bytes;
+} TidyTarget;
+
+/* Fills in @target->texture, fb and bytes for its size and format.
+ * Returns FALSE if it couldn't. */
+typedef gboolean (*TidyTargetCreateFunc)  (TidyTarget *target,
+                                           gpointer    user_data);
+typedef void     (*TidyTargetDestroyFunc) (TidyTarget *target,
+                                           gpointer    user_data);
+
+typedef struct
+{
+  guint hits, misses, evictions;
+  guint leased, idle;
+  /* How many sizes and formats we have targets of. */
+  guint slots;
+  gsize bytes_leased, bytes_idle;
+} TidyTargetPoolStats;
+
+TidyTargetPool *tidy_target_pool_new        (gsize                  budget,
+                                             TidyTargetCreateFunc   create,
+                                             TidyTargetDestroyFunc  destroy,
+                                             gpointer               user_data);
+void            tidy_target_pool_free       (TidyTargetPool *pool);
+
+/* Returns a target of @width x @height in @format, which is the caller's
+ * until it gives it back with tidy_target_pool_release().  Returns NULL
+ * if there was none and create() failed. */
+TidyTarget     *tidy_target_pool_lease      (TidyTargetPool *pool,
+                                             guint           width,
+                                             guint           height,
+                                             guint           format);
+void            tidy_target_pool_release    (TidyTargetPool *pool,
+                                             TidyTarget     *target);
+
+void            tidy_target_pool_set_budget (TidyTargetPool *pool,
+                                             gsize           budget);
+void            tidy_target_pool_get_stats  (TidyTargetPool      *pool,
+                                             TidyTargetPoolStats *stats);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,52 @@
+/* Deciding which tiles of a TidyMemTexture to upload before a frame,
+ * see tidy-upload-schedule.h.  Only glib is used here so that it can be
+ * tested without a GL context. */
+
+#include "tidy-upload-schedule.h"
+
+gboolean
+tidy_upload_schedule_run (gint tiles_x, gint tiles_y, gint *cursor,
+                          gsize budget, TidyUploadCostFunc cost,
+                          TidyUploadTileFunc upload, gpointer user_data)
+{
+  gint ntiles, start, done, first, len;
+  gsize uploaded, bytes, c;
+
+  ntiles = tiles_x * tiles_y;
+  if (ntiles <= 0)
+    return FALSE;
+
+  /* The texture may have been resized since. */
+  start = *cursor >= 0 && *cursor < ntiles ? *cursor : 0;
+
+  uploaded = 0;
+  for (done = 0; done < ntiles; done += len ? len : 1)
+    {
+      /* Find the run of tiles needing an upload starting here.
+       * It ends with the row at the latest. */
+      first = (start + done) % ntiles;
+      bytes = 0;
+      for (len = 0; done + len < ntiles; len++)
+        {
+          if (len && (first + len) % tiles_x == 0)
+            break;
+          if (!(c = cost (first + len, user_data)))
+            break;
+          bytes += c;
+        }
+      if (!len)
+        continue;
+
+      if (budget && uploaded > 0 && uploaded + bytes > budget)
+        {
+          *cursor = first;
+          return TRUE;
+        }
+
+      for (c = 0; c < (gsize)len; c++)
+        upload (first + c, user_data);
+      uploaded += bytes;
+    }
+
+  return FALSE;
+}
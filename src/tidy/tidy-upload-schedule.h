@@ -0,0 +1,36 @@
+#ifndef _TIDY_UPLOAD_SCHEDULE
+#define _TIDY_UPLOAD_SCHEDULE
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Which tiles of a TidyMemTexture to upload before a frame.  The tiles
+ * are numbered row by row.  Runs of adjacent tiles of a row which need
+ * uploading are uploaded as a whole, until the budget of the frame is
+ * spent.  The next frame continues where this one stopped, so a client
+ * damaging the top all the time doesn't keep the bottom from being
+ * uploaded. */
+
+/* Returns how many bytes uploading @tile takes, 0 if it needn't be
+ * uploaded now. */
+typedef gsize (*TidyUploadCostFunc) (gint tile, gpointer user_data);
+typedef void  (*TidyUploadTileFunc) (gint tile, gpointer user_data);
+
+/* Uploads the tiles of @tiles_x * @tiles_y needing it from *@cursor on,
+ * wrapping around, until @budget bytes are uploaded, or all of them if
+ * @budget is 0.  The first run is uploaded even if it's over the budget,
+ * otherwise a budget smaller than a tile would never let us progress.
+ * Leaves in *@cursor where the next call should start.  Returns TRUE
+ * if it stopped because of the budget. */
+gboolean tidy_upload_schedule_run (gint               tiles_x,
+                                   gint               tiles_y,
+                                   gint              *cursor,
+                                   gsize              budget,
+                                   TidyUploadCostFunc cost,
+                                   TidyUploadTileFunc upload,
+                                   gpointer           user_data);
+
+G_END_DECLS
+
+#endif
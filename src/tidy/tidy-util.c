@@ -1,7 +1,12 @@
 #include "tidy-util.h"
 
+#include "util/hd-transition.h"
+
 #include <GL/gl.h>
 
+/* Default for [offscreen_pool] budget_kb in transitions.ini. */
+#define TIDY_UTIL_DEFAULT_POOL_BUDGET_KB 4096
+
 /* The code below is to handle stacks of Offscreen buffers - for example when
  * rendering to a tidy-blur-group *while* rendering to a tidy-cached-group.
  * It also deals with properly saving the scissor state, as pretty much all
@@ -80,3 +85,82 @@ void tidy_set_cogl_from_clutter_color(CoglColor *c, const ClutterColor *cl)
   cogl_color_set_blue(c, (float)cl->blue / 255.0);
   cogl_color_set_alpha(c, (float)cl->alpha / 255.0);
 }
+
+/* ------------------------------------------------ */
+
+static TidyTargetPool *target_pool;
+
+static gboolean
+tidy_util_create_target(TidyTarget *target, gpointer unused)
+{
+  guint bpp;
+
+  target->texture = cogl_texture_new_with_size(target->width, target->height,
+                                               COGL_TEXTURE_NO_SLICING,
+                                               target->format);
+  if (!target->texture)
+    return FALSE;
+  target->fb = cogl_offscreen_new_to_texture(target->texture);
+
+  switch (target->format)
+    {
+      case COGL_PIXEL_FORMAT_A_8:
+        bpp = 1;
+        break;
+      case COGL_PIXEL_FORMAT_RGB_565:
+      case COGL_PIXEL_FORMAT_RGBA_4444:
+      case COGL_PIXEL_FORMAT_RGBA_5551:
+        bpp = 2;
+        break;
+      default:
+        bpp = 4;
+        break;
+    }
+  target->bytes = (gsize)target->width * target->height * bpp;
+
+  return TRUE;
+}
+
+static void
+tidy_util_destroy_target(TidyTarget *target, gpointer unused)
+{
+  cogl_handle_unref(target->fb);
+  cogl_handle_unref(target->texture);
+}
+
+/* Rotating or going to the switcher and back asks for the same screen
+ * sized targets again, so we keep the ones given back for a while
+ * instead of reallocating them. */
+TidyTarget *tidy_util_lease_target(guint width, guint height,
+                                   CoglPixelFormat format)
+{
+  if (!target_pool)
+    target_pool = tidy_target_pool_new(
+                      hd_transition_get_int("offscreen_pool", "budget_kb",
+                                            TIDY_UTIL_DEFAULT_POOL_BUDGET_KB)
+                      * 1024,
+                      tidy_util_create_target, tidy_util_destroy_target,
+                      NULL);
+  return tidy_target_pool_lease(target_pool, width, height, format);
+}
+
+void tidy_util_release_target(TidyTarget *target)
+{
+  if (target)
+    tidy_target_pool_release(target_pool, target);
+}
+
+void tidy_util_dump_target_pool(void)
+{
+  TidyTargetPoolStats stats;
+
+  if (!target_pool)
+    return;
+
+  tidy_target_pool_get_stats(target_pool, &stats);
+  g_debug("Offscreen targets: %u leased (%" G_GSIZE_FORMAT " bytes), "
+          "%u idle (%" G_GSIZE_FORMAT " bytes)",
+          stats.leased, stats.bytes_leased, stats.idle, stats.bytes_idle);
+  g_debug("  %u hits, %u misses, %u evictions, %u sizes",
+          stats.hits, stats.misses, stats.evictions, stats.slots);
+}
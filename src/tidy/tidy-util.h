@@ -3,10 +3,19 @@
 
 #include <clutter/clutter.h>
 
+#include "tidy-target-pool.h"
+
 /* To handle the problem where we might be doing nested writes to
  * offscreen buffers */
 void tidy_util_cogl_push_offscreen_buffer(CoglHandle fbo);
 void tidy_util_cogl_pop_offscreen_buffer(void);
 
 void tidy_set_cogl_from_clutter_color(CoglColor *c, const ClutterColor *cl);
+
+/* Offscreen textures and their framebuffers shared by the tidy effects,
+ * see tidy-target-pool.h */
+TidyTarget *tidy_util_lease_target(guint width, guint height,
+                                   CoglPixelFormat format);
+void tidy_util_release_target(TidyTarget *target);
+void tidy_util_dump_target_pool(void);
 #endif
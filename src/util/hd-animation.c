@@ -0,0 +1,398 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "hd-animation.h"
+
+typedef struct
+{
+  /* 0 if the tween was removed while going through the tweens. */
+  guint                 id;
+  /* The timeline the tween follows (refed), or %NULL if we time it
+   * from @start (in milliseconds, -1 until its first frame) for @msecs. */
+  ClutterTimeline      *timeline;
+  gdouble               start;
+  guint                 msecs;
+  HdAnimationFrameFunc  frame_fun;
+  HdAnimationDoneFunc   done_fun;
+  gpointer              data;
+} HdTween;
+
+/* The qdata of followed timelines. */
+typedef struct
+{
+  gulong new_frame_id;
+  guint  ntweens;
+} HdAnimationTimeline;
+
+static struct
+{
+  /* The tweens in the order they were added. */
+  GArray          *tweens;
+  guint            last_id;
+  /* While we're going through @tweens, removed tweens are only zeroed
+   * and @tweens is compacted when we're done. */
+  guint            updating, nremoved;
+  /* Timed tweens which reached their end in this frame. */
+  GArray          *done;
+
+  guint            repaint_id;
+  /* Plays while there are timed tweens, to have frames. */
+  ClutterTimeline *clock;
+  guint            ntimed;
+  GTimer          *timer;
+  GQuark           timeline_quark;
+
+  /* For hd_animation_get_report() */
+  guint            peak_tweens, last_tweens;
+  guint64          frames;
+  gdouble          total_us, max_us, last_us;
+} animation;
+
+static gboolean hd_animation_update (gpointer unused);
+
+/* Returns the milliseconds since we were first used. */
+static gdouble
+hd_animation_now (void)
+{
+  return g_timer_elapsed (animation.timer, NULL) * 1000;
+}
+
+static gint
+hd_animation_find (guint id)
+{
+  guint i;
+
+  if (!id || !animation.tweens)
+    return -1;
+  for (i = 0; i < animation.tweens->len; i++)
+    if (g_array_index (animation.tweens, HdTween, i).id == id)
+      return i;
+  return -1;
+}
+
+static void
+hd_animation_init (void)
+{
+  if (G_LIKELY (animation.tweens))
+    return;
+
+  animation.tweens = g_array_new (FALSE, FALSE, sizeof (HdTween));
+  animation.done = g_array_new (FALSE, FALSE, sizeof (guint));
+  animation.timer = g_timer_new ();
+  animation.timeline_quark =
+    g_quark_from_static_string ("hd-animation-timeline");
+}
+
+static guint
+hd_animation_add_tween (HdTween *tween)
+{
+  guint ntweens;
+
+  if (!++animation.last_id)
+    animation.last_id++;
+  tween->id = animation.last_id;
+  g_array_append_val (animation.tweens, *tween);
+
+  ntweens = animation.tweens->len - animation.nremoved;
+  if (animation.peak_tweens < ntweens)
+    animation.peak_tweens = ntweens;
+  if (!animation.repaint_id)
+    animation.repaint_id = clutter_threads_add_repaint_func (
+                                      hd_animation_update, NULL, NULL);
+
+  return tween->id;
+}
+
+guint
+hd_animation_add (guint msecs, HdAnimationFrameFunc frame_fun,
+                  HdAnimationDoneFunc done_fun, gpointer data)
+{
+  HdTween tween = { 0 };
+
+  hd_animation_init ();
+  tween.start = -1;
+  tween.msecs = msecs;
+  tween.frame_fun = frame_fun;
+  tween.done_fun = done_fun;
+  tween.data = data;
+  hd_animation_add_tween (&tween);
+
+  if (!animation.ntimed++)
+    {
+      if (!animation.clock)
+        {
+          animation.clock = clutter_timeline_new (1000);
+          clutter_timeline_set_repeat_count (animation.clock, -1);
+        }
+      clutter_timeline_start (animation.clock);
+    }
+
+  return tween.id;
+}
+
+/* Goes through the tweens and updates those following @only, or if
+ * it's %NULL, all of them, adding the timed tweens which reached their
+ * end to @animation.done. */
+static void
+hd_animation_pass (ClutterTimeline *only)
+{
+  gdouble now;
+  guint i, n;
+
+  now = hd_animation_now ();
+  animation.updating++;
+
+  /* Tweens added meanwhile start in the next frame. */
+  n = animation.tweens->len;
+  for (i = 0; i < n; i++)
+    {
+      HdTween *tween = &g_array_index (animation.tweens, HdTween, i);
+      gfloat progress;
+
+      if (!tween->id)
+        continue;
+
+      if (only || tween->timeline)
+        {
+          if (only ? tween->timeline != only
+                   : !clutter_timeline_is_playing (tween->timeline))
+            continue;
+          progress = clutter_timeline_get_progress (tween->timeline);
+        }
+      else
+        {
+          /* Start counting from the first frame we show, not from when
+           * the tween was added, which may have been long before. */
+          if (tween->start < 0)
+            tween->start = now;
+          progress = tween->msecs ? (now - tween->start) / tween->msecs : 1;
+          if (progress >= 1)
+            {
+              progress = 1;
+              g_array_append_val (animation.done, tween->id);
+            }
+        }
+
+      /* @tween may move if @frame_fun adds tweens. */
+      tween->frame_fun (progress, tween->data);
+    }
+
+  if (!--animation.updating && animation.nremoved)
+    {
+      guint to;
+
+      for (i = to = 0; i < animation.tweens->len; i++)
+        if (g_array_index (animation.tweens, HdTween, i).id)
+          g_array_index (animation.tweens, HdTween, to++) =
+            g_array_index (animation.tweens, HdTween, i);
+      g_array_set_size (animation.tweens, to);
+      animation.nremoved = 0;
+    }
+}
+
+/* ClutterTimeline::new-frame handler of followed timelines.  Their
+ * last frame is made here, so that their tweens are at their end by
+ * the time "completed" is emitted. */
+static void
+hd_animation_timeline_frame (ClutterTimeline *timeline, gint msecs,
+                             gpointer unused)
+{
+  guint elapsed = clutter_timeline_get_elapsed_time (timeline);
+
+  if (clutter_timeline_get_direction (timeline) == CLUTTER_TIMELINE_FORWARD
+      ? elapsed >= clutter_timeline_get_duration (timeline) : elapsed == 0)
+    hd_animation_pass (timeline);
+}
+
+guint
+hd_animation_add_for_timeline (ClutterTimeline *timeline,
+                               HdAnimationFrameFunc frame_fun,
+                               gpointer data)
+{
+  HdTween tween = { 0 };
+  HdAnimationTimeline *followed;
+
+  hd_animation_init ();
+  tween.timeline = g_object_ref (timeline);
+  tween.frame_fun = frame_fun;
+  tween.data = data;
+  hd_animation_add_tween (&tween);
+
+  followed = g_object_get_qdata (G_OBJECT (timeline),
+                                 animation.timeline_quark);
+  if (!followed)
+    {
+      followed = g_new0 (HdAnimationTimeline, 1);
+      followed->new_frame_id = g_signal_connect (timeline, "new-frame",
+                            G_CALLBACK (hd_animation_timeline_frame), NULL);
+      g_object_set_qdata_full (G_OBJECT (timeline), animation.timeline_quark,
+                               followed, g_free);
+    }
+  followed->ntweens++;
+
+  return tween.id;
+}
+
+static void
+hd_animation_remove_index (guint i)
+{
+  HdTween tween;
+
+  tween = g_array_index (animation.tweens, HdTween, i);
+  if (animation.updating)
+    {
+      g_array_index (animation.tweens, HdTween, i).id = 0;
+      animation.nremoved++;
+    }
+  else
+    g_array_remove_index (animation.tweens, i);
+
+  if (tween.timeline)
+    {
+      HdAnimationTimeline *followed;
+
+      followed = g_object_get_qdata (G_OBJECT (tween.timeline),
+                                     animation.timeline_quark);
+      if (!--followed->ntweens)
+        {
+          g_signal_handler_disconnect (tween.timeline,
+                                       followed->new_frame_id);
+          g_object_set_qdata (G_OBJECT (tween.timeline),
+                              animation.timeline_quark, NULL);
+        }
+      g_object_unref (tween.timeline);
+    }
+  else if (!--animation.ntimed)
+    clutter_timeline_stop (animation.clock);
+}
+
+void
+hd_animation_remove (guint id)
+{
+  gint i;
+
+  if ((i = hd_animation_find (id)) >= 0)
+    hd_animation_remove_index (i);
+}
+
+/* The repaint function updating the tweens before each frame. */
+static gboolean
+hd_animation_update (gpointer unused)
+{
+  gdouble start;
+  guint i, ntweens;
+
+  ntweens = animation.tweens->len - animation.nremoved;
+  if (!ntweens)
+    {
+      animation.repaint_id = 0;
+      return FALSE;
+    }
+
+  start = hd_animation_now ();
+  g_array_set_size (animation.done, 0);
+  hd_animation_pass (NULL);
+
+  /* Finish the tweens which reached their end.  They may have been
+   * removed by then. */
+  for (i = 0; i < animation.done->len; i++)
+    {
+      HdTween tween;
+      gint idx;
+
+      if ((idx = hd_animation_find (g_array_index (animation.done,
+                                                   guint, i))) < 0)
+        continue;
+      tween = g_array_index (animation.tweens, HdTween, idx);
+      hd_animation_remove_index (idx);
+      if (tween.done_fun)
+        tween.done_fun (tween.data);
+    }
+
+  animation.last_us = (hd_animation_now () - start) * 1000;
+  animation.last_tweens = ntweens;
+  animation.total_us += animation.last_us;
+  if (animation.max_us < animation.last_us)
+    animation.max_us = animation.last_us;
+  animation.frames++;
+
+  return TRUE;
+}
+
+gboolean
+hd_animation_is_running (guint id)
+{
+  return hd_animation_find (id) >= 0;
+}
+
+gfloat
+hd_animation_get_progress (guint id)
+{
+  const HdTween *tween;
+  gint i;
+
+  if ((i = hd_animation_find (id)) < 0)
+    return 1;
+
+  tween = &g_array_index (animation.tweens, HdTween, i);
+  if (tween->timeline)
+    return clutter_timeline_get_progress (tween->timeline);
+  if (!tween->msecs)
+    return 1;
+  if (tween->start < 0)
+    return 0;
+  return CLAMP ((hd_animation_now () - tween->start) / tween->msecs, 0, 1);
+}
+
+guint
+hd_animation_get_n_tweens (void)
+{
+  return animation.tweens ? animation.tweens->len - animation.nremoved : 0;
+}
+
+gchar *
+hd_animation_get_report (void)
+{
+  return g_strdup_printf (
+            "%u tweens running, %u timed, %u at most\n"
+            "%" G_GUINT64_FORMAT " frames updated, %.1f us per frame, "
+            "%.1f us at most, %.1f us for the %u tweens of the last\n",
+            hd_animation_get_n_tweens (), animation.ntimed,
+            animation.peak_tweens, animation.frames,
+            animation.frames ? animation.total_us / animation.frames : 0,
+            animation.max_us, animation.last_us, animation.last_tweens);
+}
+
+void
+hd_animation_dump (void)
+{
+  gchar *report, **lines;
+  guint i;
+
+  report = hd_animation_get_report ();
+  lines = g_strsplit (report, "\n", 0);
+  g_debug ("Animations:");
+  for (i = 0; lines[i]; i++)
+    if (*lines[i])
+      g_debug ("  %s", lines[i]);
+  g_strfreev (lines);
+  g_free (report);
+}
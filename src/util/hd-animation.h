@@ -0,0 +1,83 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_ANIMATION_H__
+#define __HD_ANIMATION_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Runs the tweens of all animations in a single pass per frame, right
+ * before the stage is laid out and painted, instead of each animation
+ * connecting to the "new-frame" signal of its own #ClutterTimeline.
+ * All the property changes of a frame are made together and are
+ * painted in one go.
+ *
+ * A tween is either timed by the scheduler for a given duration, or
+ * follows the progress of a #ClutterTimeline when several tweens need
+ * to finish together and their owner wants the timeline's "completed"
+ * signal.  Tweens are referred to by nonzero ids.
+ */
+
+/* Called in every frame with the tween's progress between 0 and 1. */
+typedef void (*HdAnimationFrameFunc) (gfloat progress, gpointer data);
+/* Called when a timed tween has reached its end. */
+typedef void (*HdAnimationDoneFunc)  (gpointer data);
+
+/* Starts a tween lasting @msecs.  At the end @frame_fun is called
+ * with 1 and then @done_fun, which may be %NULL. */
+guint    hd_animation_add              (guint                msecs,
+                                        HdAnimationFrameFunc frame_fun,
+                                        HdAnimationDoneFunc  done_fun,
+                                        gpointer             data);
+
+/* Starts a tween following the progress of @timeline while it plays,
+ * up to and including its last frame.  It doesn't end by itself;
+ * remove it with hd_animation_remove(), typically when @timeline
+ * is "completed". */
+guint    hd_animation_add_for_timeline (ClutterTimeline     *timeline,
+                                        HdAnimationFrameFunc frame_fun,
+                                        gpointer             data);
+
+/* Stops the tween @id where it is, without calling anything. */
+void     hd_animation_remove           (guint                id);
+
+/* Returns whether @id is a tween not removed or finished yet. */
+gboolean hd_animation_is_running       (guint                id);
+
+/* Returns the progress of the tween @id, 1 if it's not running. */
+gfloat   hd_animation_get_progress     (guint                id);
+
+/* Returns the number of running tweens. */
+guint    hd_animation_get_n_tweens     (void);
+
+/* Returns the number of tweens and the time spent updating them per
+ * frame in a newly allocated string. */
+gchar   *hd_animation_get_report       (void);
+
+/* Print hd_animation_get_report() with g_debug(). */
+void     hd_animation_dump             (void);
+
+G_END_DECLS
+
+#endif /* __HD_ANIMATION_H__ */
@@ -0,0 +1,82 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <math.h>
+
+#include "hd-curve.h"
+
+void
+hd_curve_bake (HdCurve *curve, HdCurveFunc func, gpointer user_data)
+{
+  guint i;
+
+  for (i = 0; i <= HD_CURVE_STEPS; i++)
+    curve->y[i] = func ((float)i / HD_CURVE_STEPS, user_data);
+}
+
+/* x goes from 0->1, and the result goes mostly from 0->1 with a bit of
+ * overshoot at the end */
+float
+hd_curve_overshoot (float x, gpointer unused)
+{
+  float smooth_ramp, converge;
+  smooth_ramp = 1.0f - cos(x*3.141592); // 0 <= smooth_ramp <= 2
+  converge = sin(0.5*3.141592*(1-x)); // 0 <= converve <= 1
+  return (smooth_ramp*0.675)*converge + (1-converge);
+}
+
+float
+hd_curve_smooth_ramp (float x, gpointer unused)
+{
+  return (1.0f - cos(x*3.141592)) * 0.5f;
+}
+
+float
+hd_curve_ease_in (float x, gpointer unused)
+{
+  return (1.0f - cos(x*3.141592*0.5));
+}
+
+float
+hd_curve_ease_out (float x, gpointer unused)
+{
+  return cos((1-x)*3.141592*0.5);
+}
+
+/* Returns the cubic bezier curve at @t defined by
+ * (@p0, @p1) and (@p2, @p3). */
+static float __attribute__((const))
+bezier (float t, float p0, float p1, float p2, float p3)
+{
+  /* B(t) = (1-t)^3*P0 + (1-t)^2*t*P1 + (1-t)*t^2*P2 + t^3*P3 */
+  return powf((1-t), 3)*p0
+    + 3*powf((1-t), 2)*t*p1
+    + 3*(1-t)*powf(t, 2)*p2
+    + powf(t, 3)*p3;
+}
+
+float
+hd_curve_ramped_bezier (float x, gpointer cp)
+{
+  const float *p = cp;
+
+  return bezier (hd_curve_smooth_ramp (x, NULL), p[0], p[1], p[2], p[3]);
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_CURVE_H__
+#define __HD_CURVE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A function of [0, 1] sampled at HD_CURVE_STEPS+1 evenly spaced
+ * points, so that transitions evaluating easing curves every frame
+ * for every actor only do a table fetch and a lerp instead of calling
+ * cos(), sin() and powf().  With 256 steps the error of the smooth
+ * cosine curves we use is around 1e-5, which doesn't show in pixels. */
+#define HD_CURVE_STEPS 256
+
+typedef struct
+{
+  float y[HD_CURVE_STEPS + 1];
+} HdCurve;
+
+typedef float (*HdCurveFunc) (float x, gpointer user_data);
+
+/* Samples @func into @curve. */
+void hd_curve_bake (HdCurve *curve, HdCurveFunc func, gpointer user_data);
+
+/* The easing curves of the transitions, to bake. */
+float hd_curve_overshoot (float x, gpointer unused);
+float hd_curve_smooth_ramp (float x, gpointer unused);
+float hd_curve_ease_in (float x, gpointer unused);
+float hd_curve_ease_out (float x, gpointer unused);
+/* The cubic bezier curve of the four control points @cp (floats) of
+ * one coordinate, along hd_curve_smooth_ramp(). */
+float hd_curve_ramped_bezier (float x, gpointer cp);
+
+/* Returns @curve at @x, clamping @x to [0, 1]. */
+static inline float
+hd_curve_eval (const HdCurve *curve, float x)
+{
+  float pos, frac;
+  int idx;
+
+  if (!(x > 0))
+    return curve->y[0];
+  if (x >= 1)
+    return curve->y[HD_CURVE_STEPS];
+
+  pos = x * HD_CURVE_STEPS;
+  idx = (int)pos;
+  frac = pos - idx;
+  return curve->y[idx] + (curve->y[idx+1] - curve->y[idx]) * frac;
+}
+
+G_END_DECLS
+
+#endif /* __HD_CURVE_H__ */
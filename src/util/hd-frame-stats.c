@@ -0,0 +1,304 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <clutter/clutter.h>
+
+#include "hd-frame-stats.h"
+#include "hd-render-manager.h"
+
+/* Number of frames we remember. */
+#define HD_FRAME_STATS_FRAMES 512
+
+/* The refresh period.  A frame wanted in time for the refresh after
+ * the previous one but painted a period or more later missed one. */
+#define HD_FRAME_STATS_PERIOD_US 16667
+
+typedef struct
+{
+  /* Microseconds since hd_frame_stats_init(), 0 if the step didn't
+   * happen in this frame. */
+  guint64       at[HD_FRAME_N_STEPS];
+  HDRMStateEnum state;
+  /* What hd_frame_stats_count_culled() was told about the frame. */
+  guint         culled, culled_pixels;
+  /* Refreshes missed between the previous frame and this one. */
+  guint         missed;
+} HdFrame;
+
+static struct
+{
+  GTimer  *clock;
+  /* The ring of finished frames; @next is overwritten next. */
+  HdFrame  frames[HD_FRAME_STATS_FRAMES];
+  guint    next, nframes;
+  /* The frame being made. */
+  HdFrame  current;
+  guint    swap_id, expire_id;
+  /* When the previous frame started to be painted. */
+  guint64  last_paint_start;
+} stats;
+
+static guint64
+hd_frame_stats_now (void)
+{
+  /* 0 means unset. */
+  return (guint64)(g_timer_elapsed (stats.clock, NULL) * 1000000) + 1;
+}
+
+/* Runs when the main loop has nothing better to do after damage or
+ * a restack.  If no redraw was queued by then they didn't change the
+ * screen, so don't count the next frame from them. */
+static gboolean
+hd_frame_stats_expire (gpointer unused)
+{
+  stats.expire_id = 0;
+  if (!stats.current.at[HD_FRAME_QUEUED])
+    {
+      stats.current.at[HD_FRAME_DAMAGE]  = 0;
+      stats.current.at[HD_FRAME_RESTACK] = 0;
+    }
+  return FALSE;
+}
+
+void
+hd_frame_stats_mark (HdFrameStep step)
+{
+  if (!stats.clock)
+    return;
+  if (!stats.current.at[step])
+    stats.current.at[step] = hd_frame_stats_now ();
+  if ((step == HD_FRAME_DAMAGE || step == HD_FRAME_RESTACK)
+      && !stats.expire_id)
+    stats.expire_id = g_idle_add_full (G_PRIORITY_LOW,
+                                       hd_frame_stats_expire, NULL, NULL);
+}
+
+void
+hd_frame_stats_count_culled (guint actors, guint pixels)
+{
+  stats.current.culled        += actors;
+  stats.current.culled_pixels += pixels;
+}
+
+/* Runs right after the redraw of the stage, which includes the
+ * swap.  Clutter doesn't tell us about the swap itself. */
+static gboolean
+hd_frame_stats_swapped (gpointer unused)
+{
+  HdFrame *frame;
+  guint64 wanted, late;
+  guint step;
+
+  stats.swap_id = 0;
+  hd_frame_stats_mark (HD_FRAME_SWAP);
+
+  frame = &stats.frames[stats.next];
+  *frame = stats.current;
+  stats.next = (stats.next + 1) % HD_FRAME_STATS_FRAMES;
+  if (stats.nframes < HD_FRAME_STATS_FRAMES)
+    stats.nframes++;
+
+  /* Count the refreshes between the paints of the previous frame and
+   * this one, from when this one was wanted or the refresh after the
+   * previous one, whichever is later.  Nothing is missed while nothing
+   * needs to be painted. */
+  if (stats.last_paint_start)
+    {
+      wanted = frame->at[HD_FRAME_PAINT_START];
+      for (step = HD_FRAME_DAMAGE; step <= HD_FRAME_QUEUED; step++)
+        if (frame->at[step])
+          wanted = MIN (wanted, frame->at[step]);
+      wanted = MAX (wanted, stats.last_paint_start + HD_FRAME_STATS_PERIOD_US);
+      late = frame->at[HD_FRAME_PAINT_START] > wanted
+        ? frame->at[HD_FRAME_PAINT_START] - wanted : 0;
+      frame->missed = (late + HD_FRAME_STATS_PERIOD_US / 2)
+        / HD_FRAME_STATS_PERIOD_US;
+    }
+  stats.last_paint_start = frame->at[HD_FRAME_PAINT_START];
+
+  /* What happened after the paint belongs to the next frame. */
+  memset (&stats.current, 0, sizeof (stats.current));
+  for (step = HD_FRAME_DAMAGE; step <= HD_FRAME_QUEUED; step++)
+    if (frame->at[step] > frame->at[HD_FRAME_PAINT_END])
+      {
+        stats.current.at[step] = frame->at[step];
+        frame->at[step] = 0;
+      }
+
+  return FALSE;
+}
+
+static void
+hd_frame_stats_queue_redraw (ClutterActor *stage, ClutterActor *origin)
+{
+  hd_frame_stats_mark (HD_FRAME_QUEUED);
+}
+
+static void
+hd_frame_stats_paint_start (ClutterActor *stage)
+{
+  hd_frame_stats_mark (HD_FRAME_PAINT_START);
+  stats.current.state = hd_render_manager_get_state ();
+}
+
+static void
+hd_frame_stats_paint_end (ClutterActor *stage)
+{
+  hd_frame_stats_mark (HD_FRAME_PAINT_END);
+  if (!stats.swap_id)
+    stats.swap_id = g_idle_add_full (CLUTTER_PRIORITY_REDRAW + 1,
+                                     hd_frame_stats_swapped, NULL, NULL);
+}
+
+void
+hd_frame_stats_init (void)
+{
+  ClutterActor *stage;
+
+  if (stats.clock)
+    return;
+
+  stats.clock = g_timer_new ();
+  stage = clutter_stage_get_default ();
+  g_signal_connect (stage, "queue-redraw",
+                    G_CALLBACK (hd_frame_stats_queue_redraw), NULL);
+  g_signal_connect (stage, "paint",
+                    G_CALLBACK (hd_frame_stats_paint_start), NULL);
+  g_signal_connect_after (stage, "paint",
+                          G_CALLBACK (hd_frame_stats_paint_end), NULL);
+}
+
+static int
+hd_frame_stats_cmp (const void *a, const void *b)
+{
+  guint64 ua = *(const guint64 *)a, ub = *(const guint64 *)b;
+
+  return ua < ub ? -1 : ua > ub;
+}
+
+/* Returns the @p percentile of the @n sorted @times in milliseconds. */
+static gdouble
+hd_frame_stats_percentile (const guint64 *times, guint n, guint p)
+{
+  return n ? times[MIN (n * p / 100, n - 1)] / 1000.0 : 0;
+}
+
+/* Returns the duration of @frame: from the damage or the start of
+ * the paint until the swap. */
+static guint64
+hd_frame_stats_duration (const HdFrame *frame)
+{
+  guint64 start;
+
+  start = frame->at[HD_FRAME_DAMAGE]
+    && frame->at[HD_FRAME_DAMAGE] < frame->at[HD_FRAME_PAINT_START]
+    ? frame->at[HD_FRAME_DAMAGE] : frame->at[HD_FRAME_PAINT_START];
+  return frame->at[HD_FRAME_SWAP] - start;
+}
+
+gchar *
+hd_frame_stats_get_report (void)
+{
+  GString *report;
+  guint64 *times;
+  guint32 states;
+  guint i, bit;
+
+  report = g_string_new (NULL);
+  g_string_append_printf (report, "%u frames recorded\n", stats.nframes);
+
+  /* The states we have frames from. */
+  states = 0;
+  for (i = 0; i < stats.nframes; i++)
+    states |= stats.frames[i].state;
+
+  times = g_new (guint64, stats.nframes);
+  for (bit = 0; bit < 32; bit++)
+    {
+      guint64 paint, restack, culled, culled_pixels;
+      guint n, nrestack, missed;
+
+      if (!(states & (1u << bit)))
+        continue;
+
+      n = nrestack = missed = 0;
+      paint = restack = culled = culled_pixels = 0;
+      for (i = 0; i < stats.nframes; i++)
+        {
+          const HdFrame *frame = &stats.frames[i];
+
+          if (frame->state != (1u << bit) || !frame->at[HD_FRAME_PAINT_START])
+            continue;
+
+          times[n++] = hd_frame_stats_duration (frame);
+          missed += frame->missed;
+
+          paint += frame->at[HD_FRAME_PAINT_END]
+            - frame->at[HD_FRAME_PAINT_START];
+          culled        += frame->culled;
+          culled_pixels += frame->culled_pixels;
+          if (frame->at[HD_FRAME_RESTACK])
+            {
+              restack += frame->at[HD_FRAME_PAINT_START]
+                - MIN (frame->at[HD_FRAME_RESTACK],
+                       frame->at[HD_FRAME_PAINT_START]);
+              nrestack++;
+            }
+        }
+      if (!n)
+        continue;
+
+      qsort (times, n, sizeof (*times), hd_frame_stats_cmp);
+      g_string_append_printf (report,
+               "%s: %u frames, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, "
+               "%u missed; paint %.1f ms, restack to paint %.1f ms; "
+               "culled %.1f actors, %.0f kpixels\n",
+               hd_render_manager_state_str (1u << bit), n,
+               hd_frame_stats_percentile (times, n, 50),
+               hd_frame_stats_percentile (times, n, 95),
+               hd_frame_stats_percentile (times, n, 99),
+               missed, paint / 1000.0 / n,
+               nrestack ? restack / 1000.0 / nrestack : 0,
+               (gdouble)culled / n, culled_pixels / 1000.0 / n);
+    }
+  g_free (times);
+
+  return g_string_free (report, FALSE);
+}
+
+void
+hd_frame_stats_dump (void)
+{
+  gchar *report, **lines;
+  guint i;
+
+  report = hd_frame_stats_get_report ();
+  lines = g_strsplit (report, "\n", 0);
+  g_debug ("Frame times:");
+  for (i = 0; lines[i]; i++)
+    if (*lines[i])
+      g_debug ("  %s", lines[i]);
+  g_strfreev (lines);
+  g_free (report);
+}
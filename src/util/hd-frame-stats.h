@@ -0,0 +1,63 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_FRAME_STATS_H__
+#define __HD_FRAME_STATS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Records when the steps of the last few hundred stage frames happened
+ * and which HDRM state we were in, to tell how long frames take. */
+typedef enum
+{
+  HD_FRAME_DAMAGE,      /* first damage received for the frame */
+  HD_FRAME_RESTACK,     /* first restack for the frame */
+  HD_FRAME_QUEUED,      /* first redraw queued for the frame */
+  HD_FRAME_PAINT_START,
+  HD_FRAME_PAINT_END,
+  HD_FRAME_SWAP,        /* the redraw (and the buffer swap) is done */
+  HD_FRAME_N_STEPS
+} HdFrameStep;
+
+/* Starts watching the default stage. */
+void   hd_frame_stats_init       (void);
+
+/* Notes that @step of the next frame has happened now.  The queue,
+ * paint and swap steps are noted by hd_frame_stats itself.  Damage and
+ * restacks after which nothing queues a redraw are forgotten. */
+void   hd_frame_stats_mark       (HdFrameStep step);
+
+/* Notes that @actors actors covering @pixels pixels of the screen
+ * were not painted in the frame being made. */
+void   hd_frame_stats_count_culled (guint actors, guint pixels);
+
+/* Returns the frame time percentiles, number of missed frames and
+ * culled actors per state in a newly allocated string. */
+gchar *hd_frame_stats_get_report (void);
+
+/* Print hd_frame_stats_get_report() with g_debug(). */
+void   hd_frame_stats_dump       (void);
+
+G_END_DECLS
+
+#endif /* __HD_FRAME_STATS_H__ */
@@ -0,0 +1,119 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include "hd-occlusion.h"
+
+typedef struct
+{
+  cairo_rectangle_int_t rect;
+  gboolean              covered;
+} HdOcclusionEntry;
+
+struct _HdOcclusion
+{
+  /* HdOcclusionEntry:s in the order they were pushed. */
+  GArray          *entries;
+  /* key -> index of its entry + 1 */
+  GHashTable      *index;
+  /* The union of all rectangles pushed so far. */
+  cairo_region_t  *above;
+};
+
+HdOcclusion *
+hd_occlusion_new (void)
+{
+  HdOcclusion *occ;
+
+  occ = g_new0 (HdOcclusion, 1);
+  occ->entries = g_array_new (FALSE, FALSE, sizeof (HdOcclusionEntry));
+  occ->index   = g_hash_table_new (g_direct_hash, g_direct_equal);
+  occ->above   = cairo_region_create ();
+
+  return occ;
+}
+
+void
+hd_occlusion_free (HdOcclusion *occ)
+{
+  if (!occ)
+    return;
+
+  g_array_free (occ->entries, TRUE);
+  g_hash_table_destroy (occ->index);
+  cairo_region_destroy (occ->above);
+  g_free (occ);
+}
+
+/* Forget everything, but keep the memory around for the next round. */
+void
+hd_occlusion_reset (HdOcclusion *occ)
+{
+  static const cairo_rectangle_int_t nothing = { 0, 0, 0, 0 };
+
+  g_array_set_size (occ->entries, 0);
+  g_hash_table_remove_all (occ->index);
+  cairo_region_intersect_rectangle (occ->above, &nothing);
+}
+
+/* Add the next window below the ones already pushed. */
+void
+hd_occlusion_push (HdOcclusion                 *occ,
+                   gconstpointer                key,
+                   const cairo_rectangle_int_t *rect)
+{
+  HdOcclusionEntry entry;
+
+  entry.rect = *rect;
+  entry.covered = rect->width <= 0 || rect->height <= 0
+    || cairo_region_contains_rectangle (occ->above, rect)
+         == CAIRO_REGION_OVERLAP_IN;
+
+  g_array_append_val (occ->entries, entry);
+  g_hash_table_insert (occ->index, (gpointer)key,
+                       GUINT_TO_POINTER (occ->entries->len));
+
+  /* If it's covered it wouldn't add anything to the region. */
+  if (!entry.covered)
+    cairo_region_union_rectangle (occ->above, rect);
+}
+
+/* Returns whether @key was covered when it was pushed.  If @rect is
+ * given and it's different from what was pushed the result is
+ * %HD_OCCLUSION_UNKNOWN, just like when @key is not in the index. */
+HdOcclusionResult
+hd_occlusion_lookup (HdOcclusion                 *occ,
+                     gconstpointer                key,
+                     const cairo_rectangle_int_t *rect)
+{
+  const HdOcclusionEntry *entry;
+  guint i;
+
+  if (!(i = GPOINTER_TO_UINT (g_hash_table_lookup (occ->index, key))))
+    return HD_OCCLUSION_UNKNOWN;
+
+  entry = &g_array_index (occ->entries, HdOcclusionEntry, i-1);
+  if (rect && memcmp (rect, &entry->rect, sizeof (*rect)))
+    return HD_OCCLUSION_UNKNOWN;
+
+  return entry->covered ? HD_OCCLUSION_COVERED : HD_OCCLUSION_VISIBLE;
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_OCCLUSION_H__
+#define __HD_OCCLUSION_H__
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+/* Answers "is this window completely covered by the ones above it"
+ * for a whole window stack.  The index is filled from the top of the
+ * stack downwards; after that queries are a hash lookup and don't
+ * allocate anything.  It doesn't know about windows, only about keys
+ * and rectangles, so it can be used from anywhere. */
+typedef struct _HdOcclusion HdOcclusion;
+
+typedef enum
+{
+  HD_OCCLUSION_UNKNOWN = -1,
+  HD_OCCLUSION_VISIBLE =  0,
+  HD_OCCLUSION_COVERED =  1,
+} HdOcclusionResult;
+
+HdOcclusion       *hd_occlusion_new    (void);
+void               hd_occlusion_free   (HdOcclusion *occ);
+
+void               hd_occlusion_reset  (HdOcclusion *occ);
+void               hd_occlusion_push   (HdOcclusion                 *occ,
+                                        gconstpointer                key,
+                                        const cairo_rectangle_int_t *rect);
+HdOcclusionResult  hd_occlusion_lookup (HdOcclusion                 *occ,
+                                        gconstpointer                key,
+                                        const cairo_rectangle_int_t *rect);
+
+G_END_DECLS
+
+#endif /* __HD_OCCLUSION_H__ */
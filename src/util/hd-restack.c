@@ -0,0 +1,94 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include "hd-restack.h"
+
+guint
+hd_restack_reorder (gpointer const *have, gpointer const *want, guint n,
+                    HdRestackMoveFunc move, gpointer user_data)
+{
+  GHashTable *index;
+  guint *pos, *tails, *prev;
+  gboolean *keep;
+  guint i, len, nmoves;
+
+  if (!memcmp (have, want, n * sizeof (*have)))
+    return 0;
+
+  /* Where the wanted children are now. */
+  index = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < n; i++)
+    g_hash_table_insert (index, have[i], GUINT_TO_POINTER (i));
+  pos = g_new (guint, n);
+  for (i = 0; i < n; i++)
+    pos[i] = GPOINTER_TO_UINT (g_hash_table_lookup (index, want[i]));
+  g_hash_table_destroy (index);
+
+  /* The longest run of @want whose positions increase, ie. which is
+   * already in order, is what we don't have to move.  @tails[l] is
+   * the index of the smallest last element of an increasing run of
+   * length l+1, @prev links the runs. */
+  tails = g_new (guint, n);
+  prev  = g_new (guint, n);
+  len = 0;
+  for (i = 0; i < n; i++)
+    {
+      guint lo = 0, hi = len;
+
+      while (lo < hi)
+        {
+          guint mid = (lo + hi) / 2;
+
+          if (pos[tails[mid]] < pos[i])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+      prev[i] = lo ? tails[lo-1] : G_MAXUINT;
+      tails[lo] = i;
+      if (lo == len)
+        len++;
+    }
+
+  keep = g_new0 (gboolean, n);
+  for (i = len ? tails[len-1] : G_MAXUINT; i != G_MAXUINT; i = prev[i])
+    keep[i] = TRUE;
+
+  /* Going upwards, put everything else right above the one which
+   * should be below it.  Everything below is in order already and
+   * the ones we keep are all above. */
+  nmoves = 0;
+  for (i = 0; i < n; i++)
+    if (!keep[i])
+      {
+        move (want[i], i ? want[i-1] : NULL, user_data);
+        nmoves++;
+      }
+
+  g_free (keep);
+  g_free (prev);
+  g_free (tails);
+  g_free (pos);
+
+  return nmoves;
+}
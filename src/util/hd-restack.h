@@ -0,0 +1,48 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_RESTACK_H__
+#define __HD_RESTACK_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Puts @child right above @below, or to the bottom if @below is %NULL. */
+typedef void (*HdRestackMoveFunc) (gpointer child, gpointer below,
+                                   gpointer user_data);
+
+/* Reorders the @n children of a group from the order they are in
+ * @have to the order in @want, both from the bottom to the top, with
+ * as few calls to @move as possible: the children which are already
+ * in the right order relative to each other stay where they are and
+ * only the rest is moved.  Both must have the same children.  Returns
+ * the number of moves.  It doesn't know about actors, so it can be
+ * used from anywhere. */
+guint hd_restack_reorder (gpointer const    *have,
+                          gpointer const    *want,
+                          guint              n,
+                          HdRestackMoveFunc  move,
+                          gpointer           user_data);
+
+G_END_DECLS
+
+#endif /* __HD_RESTACK_H__ */
@@ -0,0 +1,295 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <stdlib.h>
+
+#include "hd-state-profile.h"
+
+static const gchar *span_names[HD_STATE_N_SPANS] =
+{
+  "set_state", "before", "rotate", "stacking", "blur", "after",
+};
+
+typedef struct
+{
+  guint   n, frames;
+  gdouble sum, max;
+} HdStateProfileSum;
+
+/* What we know about the changes from one state to another. */
+typedef struct
+{
+  guint             from, to;
+  guint             changes;
+  HdStateProfileSum spans[HD_STATE_N_SPANS];
+} HdStateProfilePair;
+
+struct _HdStateProfile
+{
+  /* HdStateProfilePair:s in the order they first happened, there
+   * are only a few. */
+  GPtrArray          *pairs;
+  /* The state change in progress. */
+  HdStateProfilePair *current;
+  /* The state change the running spans belong to, %NULL if not
+   * running, and the time they have taken so far. */
+  HdStateProfilePair *running[HD_STATE_N_SPANS];
+  gdouble             took[HD_STATE_N_SPANS];
+  guint               frames[HD_STATE_N_SPANS];
+  gboolean            background[HD_STATE_N_SPANS];
+  /* The running foreground spans, the innermost last, which is the one
+   * taking the time. */
+  HdStateSpan         stack[HD_STATE_N_SPANS];
+  guint               depth;
+  /* Until when the time has been given to the spans. */
+  gdouble             last;
+};
+
+HdStateProfile *
+hd_state_profile_new (void)
+{
+  HdStateProfile *prof;
+
+  prof = g_new0 (HdStateProfile, 1);
+  prof->pairs = g_ptr_array_new ();
+  return prof;
+}
+
+void
+hd_state_profile_free (HdStateProfile *prof)
+{
+  guint i;
+
+  if (!prof)
+    return;
+  for (i = 0; i < prof->pairs->len; i++)
+    g_free (prof->pairs->pdata[i]);
+  g_ptr_array_free (prof->pairs, TRUE);
+  g_free (prof);
+}
+
+void
+hd_state_profile_begin (HdStateProfile *prof, guint from, guint to)
+{
+  HdStateProfilePair *pair;
+  guint i;
+
+  pair = NULL;
+  for (i = 0; i < prof->pairs->len && !pair; i++)
+    if (((HdStateProfilePair *)prof->pairs->pdata[i])->from == from
+        && ((HdStateProfilePair *)prof->pairs->pdata[i])->to == to)
+      pair = prof->pairs->pdata[i];
+  if (!pair)
+    {
+      pair = g_new0 (HdStateProfilePair, 1);
+      pair->from = from;
+      pair->to = to;
+      g_ptr_array_add (prof->pairs, pair);
+    }
+
+  pair->changes++;
+  prof->current = pair;
+}
+
+/* Gives the time since the last call to the innermost foreground span,
+ * or if there's none, to all the background ones. */
+static void
+hd_state_profile_tick (HdStateProfile *prof, gdouble now)
+{
+  guint span;
+
+  if (prof->depth)
+    prof->took[prof->stack[prof->depth - 1]] += now - prof->last;
+  else
+    for (span = 0; span < HD_STATE_N_SPANS; span++)
+      if (prof->running[span])
+        prof->took[span] += now - prof->last;
+  prof->last = now;
+}
+
+/* Takes @span off the stack of the foreground spans if it's there. */
+static void
+hd_state_profile_pop (HdStateProfile *prof, HdStateSpan span)
+{
+  guint i;
+
+  for (i = 0; i < prof->depth; i++)
+    if (prof->stack[i] == span)
+      {
+        prof->depth--;
+        for (; i < prof->depth; i++)
+          prof->stack[i] = prof->stack[i + 1];
+        break;
+      }
+}
+
+static void
+hd_state_profile_start_for (HdStateProfile *prof, HdStateSpan span,
+                            HdStateProfilePair *pair, gdouble now)
+{
+  hd_state_profile_tick (prof, now);
+  hd_state_profile_pop (prof, span);
+  prof->running[span]    = pair;
+  prof->took[span]       = 0;
+  prof->frames[span]     = 0;
+  prof->background[span] = FALSE;
+  prof->stack[prof->depth++] = span;
+}
+
+void
+hd_state_profile_start (HdStateProfile *prof, HdStateSpan span, gdouble now)
+{
+  hd_state_profile_start_for (prof, span, prof->current, now);
+}
+
+void
+hd_state_profile_start_as (HdStateProfile *prof, HdStateSpan span,
+                           HdStateSpan of, gdouble now)
+{
+  if (prof->running[of])
+    hd_state_profile_start_for (prof, span, prof->running[of], now);
+}
+
+void
+hd_state_profile_background (HdStateProfile *prof, HdStateSpan span,
+                             gdouble now)
+{
+  if (!prof->running[span] || prof->background[span])
+    return;
+
+  hd_state_profile_tick (prof, now);
+  hd_state_profile_pop (prof, span);
+  prof->background[span] = TRUE;
+}
+
+void
+hd_state_profile_end (HdStateProfile *prof, HdStateSpan span, gdouble now)
+{
+  HdStateProfileSum *sum;
+
+  if (!prof->running[span])
+    return;
+
+  hd_state_profile_tick (prof, now);
+  hd_state_profile_pop (prof, span);
+  sum = &prof->running[span]->spans[span];
+  sum->n++;
+  sum->frames += prof->frames[span];
+  sum->sum += prof->took[span];
+  if (prof->took[span] > sum->max)
+    sum->max = prof->took[span];
+  prof->running[span] = NULL;
+}
+
+void
+hd_state_profile_cancel (HdStateProfile *prof, HdStateSpan span, gdouble now)
+{
+  if (!prof->running[span])
+    return;
+
+  hd_state_profile_tick (prof, now);
+  hd_state_profile_pop (prof, span);
+  prof->running[span] = NULL;
+}
+
+gboolean
+hd_state_profile_is_running (HdStateProfile *prof, HdStateSpan span)
+{
+  return prof->running[span] != NULL;
+}
+
+void
+hd_state_profile_frame (HdStateProfile *prof, HdStateSpan span)
+{
+  if (prof->running[span])
+    prof->frames[span]++;
+}
+
+static int
+hd_state_profile_cmp (const void *a, const void *b)
+{
+  const HdStateProfilePair *pa = *(HdStateProfilePair *const *)a;
+  const HdStateProfilePair *pb = *(HdStateProfilePair *const *)b;
+  gdouble ta, tb;
+  guint span;
+
+  /* Only background spans may overlap each other, so they add up. */
+  ta = tb = 0;
+  for (span = 0; span < HD_STATE_N_SPANS; span++)
+    {
+      ta += pa->spans[span].sum;
+      tb += pb->spans[span].sum;
+    }
+
+  return ta > tb ? -1 : ta < tb;
+}
+
+gchar *
+hd_state_profile_get_report (HdStateProfile *prof,
+                             HdStateProfileNameFunc name)
+{
+  HdStateProfilePair **pairs;
+  GString *report;
+  guint i, span;
+
+  report = g_string_new (NULL);
+  g_string_append_printf (report, "%-36s %5s", "state change", "n");
+  for (span = 0; span < HD_STATE_N_SPANS; span++)
+    g_string_append_printf (report, " %15s", span_names[span]);
+  g_string_append (report, "  (avg/max ms)\n");
+
+  /* The ones which cost the most in all first. */
+  pairs = g_new (HdStateProfilePair *, prof->pairs->len);
+  for (i = 0; i < prof->pairs->len; i++)
+    pairs[i] = prof->pairs->pdata[i];
+  qsort (pairs, prof->pairs->len, sizeof (*pairs), hd_state_profile_cmp);
+
+  for (i = 0; i < prof->pairs->len; i++)
+    {
+      const HdStateProfilePair *pair = pairs[i];
+      gchar *change;
+
+      change = g_strdup_printf ("%s -> %s", name (pair->from),
+                                name (pair->to));
+      g_string_append_printf (report, "%-36s %5u", change, pair->changes);
+      g_free (change);
+
+      for (span = 0; span < HD_STATE_N_SPANS; span++)
+        {
+          const HdStateProfileSum *sum = &pair->spans[span];
+
+          if (sum->n)
+            g_string_append_printf (report, " %7.1f/%7.1f",
+                                    sum->sum / sum->n, sum->max);
+          else
+            g_string_append_printf (report, " %15s", "-");
+        }
+
+      if (pair->spans[HD_STATE_SPAN_BLUR].n)
+        g_string_append_printf (report, "  %.1f blur frames",
+                                (gdouble)pair->spans[HD_STATE_SPAN_BLUR].frames
+                                / pair->spans[HD_STATE_SPAN_BLUR].n);
+      g_string_append_c (report, '\n');
+    }
+  g_free (pairs);
+
+  return g_string_free (report, FALSE);
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_STATE_PROFILE_H__
+#define __HD_STATE_PROFILE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Times the steps of state changes and sums them up per pair of the
+ * old and the new state, to see which step of which state change is
+ * slow.  A span belongs to the state change it was started in, even if
+ * it ends after the next one began, like the blur animation.  It only
+ * knows about numbers and times in milliseconds, the caller says when
+ * things happen and how the states are called.
+ *
+ * The spans are exclusive: a span started while another one is running
+ * takes the time from it until it ends, so the report shows the self
+ * time of each.  A span going on in the background, like an animation,
+ * only counts while no other span is running in the foreground. */
+typedef struct _HdStateProfile HdStateProfile;
+
+typedef enum
+{
+  HD_STATE_SPAN_SET_STATE,    /* the rest of hd_render_manager_set_state() */
+  HD_STATE_SPAN_SYNC_BEFORE,  /* hd_render_manager_sync_clutter_before() */
+  HD_STATE_SPAN_ROTATE,       /* the rotation, until it completes */
+  HD_STATE_SPAN_STACKING,     /* hd_comp_mgr_sync_stacking() */
+  HD_STATE_SPAN_BLUR,         /* the blur animation, until it completes */
+  HD_STATE_SPAN_SYNC_AFTER,   /* hd_render_manager_sync_clutter_after() */
+  HD_STATE_N_SPANS
+} HdStateSpan;
+
+/* Returns the name of @state for the report. */
+typedef const gchar *(*HdStateProfileNameFunc) (guint state);
+
+HdStateProfile *hd_state_profile_new        (void);
+void            hd_state_profile_free       (HdStateProfile *prof);
+
+/* A state change from @from to @to starts, the spans started from now
+ * on belong to it. */
+void            hd_state_profile_begin      (HdStateProfile *prof,
+                                             guint           from,
+                                             guint           to);
+
+/* Starting a span which is running already starts it over.  Ending or
+ * cancelling one which is not running is ignored. */
+void            hd_state_profile_start      (HdStateProfile *prof,
+                                             HdStateSpan     span,
+                                             gdouble         now);
+/* Starts @span for the state change @of was started in, or does
+ * nothing if @of is not running. */
+void            hd_state_profile_start_as   (HdStateProfile *prof,
+                                             HdStateSpan     span,
+                                             HdStateSpan     of,
+                                             gdouble         now);
+/* @span goes on in the background from @now until it's ended. */
+void            hd_state_profile_background (HdStateProfile *prof,
+                                             HdStateSpan     span,
+                                             gdouble         now);
+void            hd_state_profile_end        (HdStateProfile *prof,
+                                             HdStateSpan     span,
+                                             gdouble         now);
+void            hd_state_profile_cancel     (HdStateProfile *prof,
+                                             HdStateSpan     span,
+                                             gdouble         now);
+gboolean        hd_state_profile_is_running (HdStateProfile *prof,
+                                             HdStateSpan     span);
+/* Counts a frame of @span if it's running. */
+void            hd_state_profile_frame      (HdStateProfile *prof,
+                                             HdStateSpan     span);
+
+/* Returns a table of the average and the worst time of each span of
+ * each state change, the slowest state change first.  Free it. */
+gchar          *hd_state_profile_get_report (HdStateProfile        *prof,
+                                             HdStateProfileNameFunc name);
+
+G_END_DECLS
+
+#endif /* __HD_STATE_PROFILE_H__ */
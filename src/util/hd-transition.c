@@ -35,6 +35,8 @@
 #include <canberra.h>
 
 #include "hd-transition.h"
+#include "hd-curve.h"
+#include "hd-animation.h"
 #include "hd-comp-mgr.h"
 #include "hd-gtk-style.h"
 #include "hd-render-manager.h"
@@ -56,7 +58,8 @@
 typedef struct _HDEffectData
 {
   MBWMCompMgrClientEvent   event;
-  ClutterTimeline          *timeline;
+  /* The %HdAnimation tween of the transition, which lasts @duration */
+  guint                     tween, duration;
   MBWMCompMgrClutterClient *cclient;
   ClutterActor             *cclient_actor;
   /* In subview transitions, this is the ORIGINAL (non-subview) view */
@@ -74,6 +77,9 @@ typedef struct _HDEffectData
   /* In Fade effects, final_alpha specifies the alpha value when the
    * window/note if fully faded in. */
   float                     final_alpha;
+  /* Called after the transition is finished */
+  GCallback                 finished_callback;
+  gpointer                  finished_callback_data;
 } HDEffectData;
 
 /* %HPTimer %GSource state. */
@@ -186,6 +192,12 @@ static guint Transitions_running;
  * and we can watch it. */
 static gboolean transitions_ini_is_dirty;
 
+/* Incremented whenever transitions.ini is (re)loaded. */
+static guint transitions_ini_serial;
+
+/* What hd_transition_get_config() returns. */
+static HdTransitionConfig *transitions_config;
+
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
@@ -285,19 +297,61 @@ hptimer_new(unsigned expiry,
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
 
-/* amt goes from 0->1, and the result goes mostly from 0->1 with a bit of
- * overshoot at the end */
+/* The curves below are evaluated for every actor in every frame of
+ * the transitions, so they are baked into HdCurve:s once and looked
+ * up from there.  The functions of hd-curve.c are what we bake. */
+static struct
+{
+  gboolean baked;
+  HdCurve overshoot, smooth_ramp, ease_in, ease_out;
+  /* The portrait notification's bezier paths, along smooth_ramp. */
+  HdCurve notification_in_x, notification_in_y;
+  HdCurve notification_out_x, notification_out_y;
+} curves;
+
+static void
+hd_transition_bake_curves(void)
+{
+  /* In portrait notifications fly from right to left, stay in the
+   * corner then fly away.  At the start the notification's
+   * bottom-center is at the screen's top-right.  By the end the
+   * notification's bottom-right is at the screen's top-left. */
+  static float in_x[]  = {  185,  185,  112,  -32 };
+  static float in_y[]  = {  -88,  -32,    0,    0 };
+  static float out_x[] = {  -32, -176, -478, -478 };
+  static float out_y[] = {    0,    0,  -32,  -88 };
+
+  if (curves.baked)
+    return;
+
+  hd_curve_bake(&curves.overshoot, hd_curve_overshoot, NULL);
+  hd_curve_bake(&curves.smooth_ramp, hd_curve_smooth_ramp, NULL);
+  hd_curve_bake(&curves.ease_in, hd_curve_ease_in, NULL);
+  hd_curve_bake(&curves.ease_out, hd_curve_ease_out, NULL);
+  hd_curve_bake(&curves.notification_in_x,
+                hd_curve_ramped_bezier, in_x);
+  hd_curve_bake(&curves.notification_in_y,
+                hd_curve_ramped_bezier, in_y);
+  hd_curve_bake(&curves.notification_out_x,
+                hd_curve_ramped_bezier, out_x);
+  hd_curve_bake(&curves.notification_out_y,
+                hd_curve_ramped_bezier, out_y);
+  curves.baked = TRUE;
+}
+
 float
 hd_transition_overshoot(float x)
 {
-  float smooth_ramp, converge;
-  float amt;
   int offset;
+  float amt;
+
   offset = (int)x;
   amt = x-offset;
-  smooth_ramp = 1.0f - cos(amt*3.141592); // 0 <= smooth_ramp <= 2
-  converge = sin(0.5*3.141592*(1-amt)); // 0 <= converve <= 1
-  return offset + (smooth_ramp*0.675)*converge + (1-converge);
+  if (amt < 0)
+    return offset + hd_curve_overshoot(amt, NULL);
+  if (G_UNLIKELY(!curves.baked))
+    hd_transition_bake_curves();
+  return offset + hd_curve_eval(&curves.overshoot, amt);
 }
 
 /* amt goes from 0->1, and the result goes from 0->1 smoothly */
@@ -305,7 +359,11 @@ float
 hd_transition_smooth_ramp(float amt)
 {
   if (amt>0 && amt<1)
-    return (1.0f - cos(amt*3.141592)) * 0.5f;
+    {
+      if (G_UNLIKELY(!curves.baked))
+        hd_transition_bake_curves();
+      return hd_curve_eval(&curves.smooth_ramp, amt);
+    }
   return amt;
 }
 
@@ -313,7 +371,11 @@ float
 hd_transition_ease_in(float amt)
 {
   if (amt>0 && amt<1)
-    return (1.0f - cos(amt*3.141592*0.5));
+    {
+      if (G_UNLIKELY(!curves.baked))
+        hd_transition_bake_curves();
+      return hd_curve_eval(&curves.ease_in, amt);
+    }
   return amt;
 }
 
@@ -321,7 +383,11 @@ float
 hd_transition_ease_out(float amt)
 {
   if (amt>0 && amt<1)
-    return cos((1-amt)*3.141592*0.5);
+    {
+      if (G_UNLIKELY(!curves.baked))
+        hd_transition_bake_curves();
+      return hd_curve_eval(&curves.ease_out, amt);
+    }
   return amt;
 }
 
@@ -329,15 +395,12 @@ hd_transition_ease_out(float amt)
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
 
-static ClutterTimeline *
-hd_transition_timeline_new(const gchar *transition,
-                           MBWMCompMgrClientEvent event,
-                           gint default_length)
+static guint
+hd_transition_get_duration(const HdTransitionDurations *durations,
+                           MBWMCompMgrClientEvent event)
 {
-  const char *key =
-    event==MBWMCompMgrClientEventMap ?"duration_in":"duration_out";
-  return clutter_timeline_new (
-      hd_transition_get_int(transition, key, default_length) );
+  return event==MBWMCompMgrClientEventMap
+    ? durations->duration_in : durations->duration_out;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -383,10 +446,8 @@ on_decor_progress_timeline_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_popup_timeline_new_frame(ClutterTimeline *timeline,
-                            gint frame_num, HDEffectData *data)
+on_popup_frame(float amt, HDEffectData *data)
 {
-  float amt;
   ClutterActor *actor, *filler;
   int status_low, status_high;
   float status_pos;
@@ -408,7 +469,6 @@ on_popup_timeline_new_frame(ClutterTimeline *timeline,
   pop_bottom = geo.y+geo.height==hd_comp_mgr_get_current_screen_height();
   if (pop_top && pop_bottom)
     pop_top = FALSE;
-  amt =  (float)clutter_timeline_get_progress(timeline);
   /* reverse if we're removing this */
   if (data->event == MBWMCompMgrClientEventUnmap)
     amt = 1-amt;
@@ -457,10 +517,9 @@ on_popup_timeline_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_fade_timeline_new_frame(ClutterTimeline *timeline,
-                            gint frame_num, HDEffectData *data)
+on_fade_frame(float amt, HDEffectData *data)
 {
-  float amt, ramt;
+  float ramt;
   gint alpha;
   ClutterActor *actor;
 
@@ -478,7 +537,6 @@ on_fade_timeline_new_frame(ClutterTimeline *timeline,
       return;
     }
 
-  amt =  (float)clutter_timeline_get_progress(timeline);
   /* reverse if we're removing this */
   if (data->event == MBWMCompMgrClientEventUnmap)
     amt = 1-amt;
@@ -495,10 +553,8 @@ on_fade_timeline_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_close_timeline_new_frame(ClutterTimeline *timeline,
-                            gint frame_num, HDEffectData *data)
+on_close_frame(float amt, HDEffectData *data)
 {
-  float amt;
   ClutterActor *actor;
   float amtx, amty, amtp;
   int centrex, centrey;
@@ -518,8 +574,6 @@ on_close_timeline_new_frame(ClutterTimeline *timeline,
       return;
     }
 
-  amt = (float)clutter_timeline_get_progress(timeline);
-
   amtx = 1.6 - amt*2.5; // shrink in x
   amty = 1 - amt*2.5; // shrink in y
   amtp = amt*2 - 1; // particles
@@ -567,23 +621,9 @@ on_close_timeline_new_frame(ClutterTimeline *timeline,
 	clutter_actor_hide( data->particles[i] );
 }
 
-/* Returns the cubic bezier curve at @t defined by
- * (@p0, @p1) and (@p2, @p3). */
-static float __attribute__((const))
-bezier(float t, float p0, float p1, float p2, float p3)
-{
-  /* B(t) = (1-t)^3*P0 + (1-t)^2*t*P1 + (1-t)*t^2*P2 + t^3*P3 */
-  return powf((1-t), 3)*p0
-    + 3*powf((1-t), 2)*t*p1
-    + 3*(1-t)*powf(t, 2)*p2
-    + powf(t, 3)*p3;
-}
-
 static void
-on_notification_timeline_new_frame(ClutterTimeline *timeline,
-                                   guint msecs, HDEffectData *data)
+on_notification_frame(float now, HDEffectData *data)
 {
-  float now;
   ClutterActor *actor;
   gfloat width, height;
   gfloat tbw, px, py;
@@ -596,39 +636,23 @@ on_notification_timeline_new_frame(ClutterTimeline *timeline,
                         HD_TITLE_BAR(hd_render_manager_get_title_bar()));
   clutter_actor_get_size(actor, &width, &height);
   clutter_actor_get_position(actor, &px, &py);
-  now = msecs / (float)clutter_timeline_get_duration(timeline);
 
   if (hd_comp_mgr_is_portrait()
-      && hd_transition_get_int("notification", "is_cool", 0))
+      && hd_transition_get_config()->notification_is_cool)
     {
       /* In portrait fly from right to left, stay in the corner
-       * then fly away, following a bezier curve.  At the start
-       * the notification's bottom-center is at the screen's
-       * top-right.  By the end the notification's bottom-right
-       * is at the screen's top-left. */
-      static struct
-      {
-        float x, y;
-      } const cpin[] =
-      { /* Bezier curve control points for the opening part. */
-        {  185, -88 },
-        {  185, -32 },
-        {  112,   0 },
-        {  -32,   0 },
-      }, cpout[] =
-      { /* and for MBWMCompMgrClientEventUnmap. */
-        {  -32,   0 },
-        { -176,   0 },
-        { -478, -32 },
-        { -478, -88 },
-      }, *curve;
-
-      /* Set the position to @curve(@now). */
-      now = hd_transition_smooth_ramp(now);
-      curve = data->event == MBWMCompMgrClientEventUnmap ? cpout : cpin;
-      clutter_actor_set_anchor_point(actor,
-               -bezier(now, curve[0].x, curve[1].x, curve[2].x, curve[3].x),
-               -bezier(now, curve[0].y, curve[1].y, curve[2].y, curve[3].y));
+       * then fly away, following a bezier curve along the smooth
+       * ramp; see hd_transition_bake_curves(). */
+      if (G_UNLIKELY(!curves.baked))
+        hd_transition_bake_curves();
+      if (data->event == MBWMCompMgrClientEventUnmap)
+        clutter_actor_set_anchor_point(actor,
+                 -hd_curve_eval(&curves.notification_out_x, now),
+                 -hd_curve_eval(&curves.notification_out_y, now));
+      else
+        clutter_actor_set_anchor_point(actor,
+                 -hd_curve_eval(&curves.notification_in_x, now),
+                 -hd_curve_eval(&curves.notification_in_y, now));
 
       /* We should restore the opacity and scaling of @actor in case
        * we were switched orientation during the transition somehow
@@ -691,11 +715,12 @@ on_notification_timeline_new_frame(ClutterTimeline *timeline,
        * edge of the screen in an arc */
       float amt = hd_transition_smooth_ramp(now);
       float scale =  1 + (1-amt)*0.5f;
-      float ang = amt * 3.141592f * 0.5f;
+      /* cos() and sin() of amt*PI/2 */
       float corner_x = (hd_comp_mgr_get_current_screen_width()*0.5f
-                        - HD_COMP_MGR_TOP_LEFT_BTN_WIDTH) * cos(ang)
+                        - HD_COMP_MGR_TOP_LEFT_BTN_WIDTH)
+                       * (1 - hd_transition_ease_in(amt))
                        - px + tbw;
-      float corner_y = (sin(ang)-1) * height;
+      float corner_y = (hd_transition_ease_out(amt)-1) * height;
       /* We set anchor point so if the notification resizes/positions
        * in flight, we're ok.  NOTE that the position of the actor
        * (get_position()) still matters, and it is LEFT_BIN_WIDTH. */
@@ -707,11 +732,9 @@ on_notification_timeline_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_subview_timeline_new_frame(ClutterTimeline *timeline,
-                              guint msecs, HDEffectData *data)
+on_subview_frame(float now, HDEffectData *data)
 {
   float amt;
-  guint duration;
   ClutterActor *subview_actor = 0, *main_actor = 0;
 
   if (data->cclient)
@@ -719,9 +742,7 @@ on_subview_timeline_new_frame(ClutterTimeline *timeline,
   if (data->cclient2)
     main_actor = data->cclient2_actor;
 
-  duration = clutter_timeline_get_duration(timeline);
-  amt = msecs / (float)duration;
-  amt = hd_transition_smooth_ramp( amt );
+  amt = hd_transition_smooth_ramp( now );
   if (data->event == MBWMCompMgrClientEventUnmap)
     amt = 1-amt;
 
@@ -746,7 +767,7 @@ on_subview_timeline_new_frame(ClutterTimeline *timeline,
   }
 
   /* if we're at the last frame, return our actors to the correct places) */
-  if (msecs == duration)
+  if (now >= 1)
     {
       if (subview_actor)
         {
@@ -765,17 +786,14 @@ on_subview_timeline_new_frame(ClutterTimeline *timeline,
 }
 
 static void
-on_rotate_screen_timeline_new_frame(ClutterTimeline *timeline,
-                                    guint msecs, HDEffectData *data)
+on_rotate_screen_frame(float now, HDEffectData *data)
 {
   float amt, dim_amt, angle;
-  gint duration;
-  gint use_zaxis = hd_transition_get_int ("thp_tweaks", "zaxisrotation", 0);
+  gint use_zaxis = hd_transition_get_config()->zaxisrotation;
   ClutterActor *actor;
   ClutterRotateAxis axis;
 
-  duration = clutter_timeline_get_duration(timeline);
-  amt = msecs / (float)duration;
+  amt = now;
   // we want to ease in, but speed up as we go - X^3 does this nicely
   amt = amt*amt;
   if (data->event == MBWMCompMgrClientEventUnmap)
@@ -797,7 +815,7 @@ on_rotate_screen_timeline_new_frame(ClutterTimeline *timeline,
   else
     axis = CLUTTER_X_AXIS;
 
-  clutter_actor_set_rotation_angle(actor, axis, msecs < duration ? angle : 0);
+  clutter_actor_set_rotation_angle(actor, axis, now < 1 ? angle : 0);
 
   if (!use_zaxis)
     {
@@ -839,10 +857,15 @@ on_screen_size_changed (ClutterActor *stage, GParamSpec *unused,
 }
 
 static void
-hd_transition_completed (ClutterTimeline* timeline, HDEffectData *data)
+hd_transition_completed (HDEffectData *data)
 {
   gint i;
   HdCompMgr *hmgr = HD_COMP_MGR (data->hmgr);
+  GCallback finished_callback = data->finished_callback;
+  gpointer finished_callback_data = data->finished_callback_data;
+
+  /* In case we're stopped before the end. */
+  hd_animation_remove (data->tween);
 
   if (data->cclient)
     {
@@ -878,9 +901,6 @@ hd_transition_completed (ClutterTimeline* timeline, HDEffectData *data)
 
 /*   dump_clutter_tree (CLUTTER_CONTAINER (clutter_stage_get_default()), 0); */
 
-  if (timeline)
-    g_object_unref ( timeline );
-
   if (hmgr)
     hd_comp_mgr_set_effect_running(hmgr, FALSE);
 
@@ -915,6 +935,21 @@ hd_transition_completed (ClutterTimeline* timeline, HDEffectData *data)
 
   if (hmgr)
     hd_comp_mgr_reconsider_compositing (MB_WM_COMP_MGR (hmgr));
+
+  if (finished_callback)
+    ((void (*)(gpointer))finished_callback) (finished_callback_data);
+}
+
+/* Starts @data's tween, calling @frame_fun in every frame and
+ * hd_transition_completed() at the end. */
+static void
+hd_transition_start (HDEffectData *data,
+                     void (*frame_fun)(float, HDEffectData *))
+{
+  data->tween = hd_animation_add (data->duration,
+                                  (HdAnimationFrameFunc)frame_fun,
+                                  (HdAnimationDoneFunc)hd_transition_completed,
+                                  data);
 }
 
 void
@@ -943,11 +978,8 @@ hd_transition_popup(HdCompMgr                  *mgr,
   data->cclient = mb_wm_object_ref (MB_WM_OBJECT (cclient));
   data->cclient_actor = g_object_ref (actor);
   data->hmgr = HD_COMP_MGR (mgr);
-  data->timeline = hd_transition_timeline_new("popup", event, 250);
-  g_signal_connect (data->timeline, "new-frame",
-                        G_CALLBACK (on_popup_timeline_new_frame), data);
-  g_signal_connect (data->timeline, "completed",
-                        G_CALLBACK (hd_transition_completed), data);
+  data->duration = hd_transition_get_duration(
+                               &hd_transition_get_config()->popup, event);
   data->geo = geo;
   Transitions_running += data->fixup_visibilities = TRUE;
 
@@ -979,8 +1011,8 @@ hd_transition_popup(HdCompMgr                  *mgr,
                               &col);
 
   /* first call to stop flicker */
-  on_popup_timeline_new_frame(data->timeline, 0, data);
-  clutter_timeline_start (data->timeline);
+  on_popup_frame(0, data);
+  hd_transition_start(data, on_popup_frame);
 }
 
 /* For banners, information notes and confirmation notes. */
@@ -1000,38 +1032,32 @@ hd_transition_fade(HdCompMgr                  *mgr,
   data->cclient_actor = g_object_ref (
       mb_wm_comp_mgr_clutter_client_get_actor( data->cclient ) );
   data->hmgr = HD_COMP_MGR (mgr);
-  data->timeline = hd_transition_timeline_new("fade", event, 250);
+  data->duration = hd_transition_get_duration(
+                                &hd_transition_get_config()->fade, event);
   Transitions_running += data->fixup_visibilities = TRUE;
 
   if (HD_IS_BANNER_NOTE(c))
     {
       clutter_actor_get_geometry(data->cclient_actor, &data->geo);
-      data->final_alpha = hd_transition_get_double("fade", "banner_note_alpha",
-                                                   1.0);
+      data->final_alpha = hd_transition_get_config()->banner_note_alpha;
     }
   else if (HD_IS_INFO_NOTE(c))
     {
       clutter_actor_get_geometry(data->cclient_actor, &data->geo);
-      data->final_alpha = hd_transition_get_double("fade", "info_note_alpha",
-                                                   1.0);
+      data->final_alpha = hd_transition_get_config()->info_note_alpha;
     }
   else
     /* Leave @data->geo 0, we needn't move the actor around. */
     data->final_alpha = 1;
 
-  g_signal_connect (data->timeline, "new-frame",
-                        G_CALLBACK (on_fade_timeline_new_frame), data);
-  g_signal_connect (data->timeline, "completed",
-                        G_CALLBACK (hd_transition_completed), data);
-
   mb_wm_comp_mgr_clutter_client_set_flags (cclient,
                               MBWMCompMgrClutterClientDontUpdate |
                               MBWMCompMgrClutterClientEffectRunning);
   hd_comp_mgr_set_effect_running(mgr, TRUE);
 
   /* first call to stop flicker */
-  on_fade_timeline_new_frame(data->timeline, 0, data);
-  clutter_timeline_start (data->timeline);
+  on_fade_frame(0, data);
+  hd_transition_start(data, on_fade_frame);
 }
 void
 hd_transition_fade_out_loading_screen(ClutterActor *loading_image)
@@ -1039,7 +1065,7 @@ hd_transition_fade_out_loading_screen(ClutterActor *loading_image)
     gfloat duration, fade_delay;
     HDEffectData             * data;
 
-    duration = hd_transition_get_int("launcher_launch", "duration_out", 250);
+    duration = hd_transition_get_config()->launcher_launch_duration_out;
     /* If duration is <=0 we just return as the loading screen is already
      * removed */
     if (duration<=0)
@@ -1049,14 +1075,14 @@ hd_transition_fade_out_loading_screen(ClutterActor *loading_image)
     data->event = MBWMCompMgrClientEventUnmap;
     data->cclient_actor = g_object_ref ( loading_image );
     data->hmgr = 0;
-    data->timeline = clutter_timeline_new ( duration );
+    data->duration = duration;
     data->final_alpha = 1;
     /* the delay before we start to fade out. We implement this by setting
      * the final_alpha value to something *past* opaque */
-    fade_delay = hd_transition_get_int("launcher_launch", "delay", 150);
+    fade_delay = hd_transition_get_config()->launcher_launch_delay;
     if (fade_delay>0)
       {
-        gint duration = clutter_timeline_get_duration(data->timeline);
+        gint duration = data->duration;
         if (fade_delay < duration) {
           data->final_alpha = 1 + fade_delay/(float)(duration-fade_delay);
           // safety in case strange values get put in
@@ -1065,15 +1091,11 @@ hd_transition_fade_out_loading_screen(ClutterActor *loading_image)
         }
       }
 
-    g_signal_connect (data->timeline, "new-frame",
-                          G_CALLBACK (on_fade_timeline_new_frame), data);
-    g_signal_connect (data->timeline, "completed",
-                          G_CALLBACK (hd_transition_completed), data);
     clutter_actor_add_child (CLUTTER_ACTOR(hd_render_manager_get_front_group()),
                              loading_image);
     /* first call to stop flicker */
-    on_fade_timeline_new_frame(data->timeline, 0, data);
-    clutter_timeline_start (data->timeline);
+    on_fade_frame(0, data);
+    hd_transition_start(data, on_fade_frame);
 }
 
 void
@@ -1130,14 +1152,9 @@ hd_transition_close_app (HdCompMgr                  *mgr,
   data->cclient = mb_wm_object_ref (MB_WM_OBJECT (cclient));
   data->cclient_actor = g_object_ref (actor);
   data->hmgr = HD_COMP_MGR (mgr);
-  data->timeline = clutter_timeline_new (
-                    hd_transition_get_int("app_close", "duration", 500));
-  g_signal_connect (data->timeline, "new-frame",
-                    G_CALLBACK (on_close_timeline_new_frame), data);
+  data->duration = hd_transition_get_config()->app_close_duration;
   g_signal_connect (clutter_stage_get_default (), "notify::allocation",
                     G_CALLBACK (on_screen_size_changed), data);
-  g_signal_connect (data->timeline, "completed",
-                    G_CALLBACK (hd_transition_completed), data);
   data->geo = geo;
 
   mb_wm_comp_mgr_clutter_client_set_flags (cclient,
@@ -1165,7 +1182,7 @@ hd_transition_close_app (HdCompMgr                  *mgr,
     }
 
   hd_comp_mgr_set_effect_running(mgr, TRUE);
-  clutter_timeline_start (data->timeline);
+  hd_transition_start(data, on_close_frame);
 
   hd_transition_play_sound (HDCM_WINDOW_CLOSED_SOUND);
 }
@@ -1190,12 +1207,8 @@ hd_transition_notification(HdCompMgr                  *mgr,
   data->cclient_actor = g_object_ref (
       mb_wm_comp_mgr_clutter_client_get_actor( data->cclient ) );
   data->hmgr = HD_COMP_MGR (mgr);
-  data->timeline = hd_transition_timeline_new("notification", event, 500);
-
-  g_signal_connect (data->timeline, "new-frame",
-                        G_CALLBACK (on_notification_timeline_new_frame), data);
-  g_signal_connect (data->timeline, "completed",
-                        G_CALLBACK (hd_transition_completed), data);
+  data->duration = hd_transition_get_duration(
+                            &hd_transition_get_config()->notification, event);
 
   mb_wm_comp_mgr_clutter_client_set_flags (cclient,
                               MBWMCompMgrClutterClientDontUpdate |
@@ -1203,12 +1216,12 @@ hd_transition_notification(HdCompMgr                  *mgr,
   hd_comp_mgr_set_effect_running(mgr, TRUE);
 
   /* first call to stop flicker */
-  on_notification_timeline_new_frame(data->timeline, 0, data);
+  on_notification_frame(0, data);
   /* Show the actor and add it to the front group */
   clutter_actor_show(data->cclient_actor);
   hd_render_manager_add_to_front_group(data->cclient_actor);
-  /* Finally start the timeline... */
-  clutter_timeline_start (data->timeline);
+  /* Finally start the transition... */
+  hd_transition_start(data, on_notification_frame);
 }
 
 void
@@ -1327,12 +1340,8 @@ hd_transition_subview(HdCompMgr                  *mgr,
       mb_wm_comp_mgr_clutter_client_get_actor( data->cclient2 ) );
   data->hmgr = HD_COMP_MGR (mgr);
   Transitions_running += data->fixup_visibilities = TRUE;
-  data->timeline = hd_transition_timeline_new("subview", event, 250);
-
-  g_signal_connect (data->timeline, "new-frame",
-                        G_CALLBACK (on_subview_timeline_new_frame), data);
-  g_signal_connect (data->timeline, "completed",
-                        G_CALLBACK (hd_transition_completed), data);
+  data->duration = hd_transition_get_duration(
+                                &hd_transition_get_config()->subview, event);
 
   mb_wm_comp_mgr_clutter_client_set_flags (cclient_subview,
                               MBWMCompMgrClutterClientDontUpdate |
@@ -1346,8 +1355,8 @@ hd_transition_subview(HdCompMgr                  *mgr,
   HD_COMP_MGR_CLIENT (cclient_subview)->effect  = data;
 
   /* first call to stop flicker */
-  on_subview_timeline_new_frame(data->timeline, 0, data);
-  clutter_timeline_start (data->timeline);
+  on_subview_frame(0, data);
+  hd_transition_start(data, on_subview_frame);
 }
 
 /* Stop any currently active transition on the given client (assuming the
@@ -1364,13 +1373,11 @@ hd_transition_stop(HdCompMgr                  *mgr,
 
   if ((data = HD_COMP_MGR_CLIENT (cclient)->effect))
     {
-      guint duration = clutter_timeline_get_duration(data->timeline);
-      clutter_timeline_stop(data->timeline);
+      hd_animation_remove(data->tween);
       /* Make sure we update to the final state for this transition */
-      g_signal_emit_by_name (data->timeline, "new-frame",
-                             duration, NULL);
+      on_subview_frame(1, data);
       /* Call end-of-transition handler */
-      hd_transition_completed(data->timeline, data);
+      hd_transition_completed(data);
     }
 }
 
@@ -1384,21 +1391,16 @@ hd_transition_fade_and_rotate(gboolean first_part,
                               gpointer finished_callback_data)
 {
   ClutterColor black = {0x00, 0x00, 0x00, 0xFF};
-  gint use_zaxis = hd_transition_get_int ("thp_tweaks", "zaxisrotation", 0);
+  gint use_zaxis = hd_transition_get_config()->zaxisrotation;
   HDEffectData *data = g_new0 (HDEffectData, 1);
   data->event = first_part ? MBWMCompMgrClientEventMap :
                              MBWMCompMgrClientEventUnmap;
-  data->timeline = hd_transition_timeline_new("rotate", data->event, 300);
-
-  g_signal_connect (data->timeline, "new-frame",
-                    G_CALLBACK (on_rotate_screen_timeline_new_frame), data);
-  g_signal_connect (data->timeline, "completed",
-                         G_CALLBACK (hd_transition_completed), data);
-  if (finished_callback)
-    g_signal_connect_swapped (data->timeline, "completed",
-                          G_CALLBACK (finished_callback), finished_callback_data);
+  data->duration = hd_transition_get_duration(
+                            &hd_transition_get_config()->rotate, data->event);
+  data->finished_callback = finished_callback;
+  data->finished_callback_data = finished_callback_data;
 
-  data->angle = hd_transition_get_double("rotate", "angle", 40);
+  data->angle = hd_transition_get_config()->rotate_angle;
   /* Set the direction of movement - we want to rotate backwards if we
    * go back to landscape as it looks better */
   if (first_part == goto_portrait)
@@ -1434,8 +1436,8 @@ hd_transition_fade_and_rotate(gboolean first_part,
     }
 
   /* stop flicker by calling the first frame directly */
-  on_rotate_screen_timeline_new_frame(data->timeline, 0, data);
-  clutter_timeline_start (data->timeline);
+  on_rotate_screen_frame(0, data);
+  hd_transition_start(data, on_rotate_screen_frame);
 }
 
 /* Process %_MAEMO_ROTATION_PATIENCE requests. */
@@ -1455,7 +1457,7 @@ patience (XClientMessageEvent *event, void *unused)
       if (Orientation_change.timeout_id)
         {
           /* remaining := max(damage_timeout_max-elapsed, 0) */
-          max  = hd_transition_get_int("rotate", "damage_timeout_max", 1000);
+          max  = hd_transition_get_config()->rotate_damage_timeout_max;
           max -= g_timer_elapsed(Orientation_change.timer, NULL) * 1000.0;
           if (max > 0)
             Orientation_change.timeout_id->remaining = max;
@@ -1639,9 +1641,8 @@ trans_start_error:
             g_assert(!Orientation_change.timeout_id);
             Orientation_change.timeout_id = hptimer_new(
                   Orientation_change.patience_requests
-                    ? hd_transition_get_int("rotate", "damage_timeout_max",
-                                            1000)
-                    : hd_transition_get_int("rotate", "damage_timeout", 50),
+                    ? hd_transition_get_config()->rotate_damage_timeout_max
+                    : hd_transition_get_config()->rotate_damage_timeout,
                   (GSourceFunc)hd_transition_rotating_fsm,
                   &Orientation_change.timeout_id,
                   (GDestroyNotify)g_nullify_pointer);
@@ -1717,6 +1718,7 @@ trans_start_error:
                             Orientation_change.wm->comp_mgr);
               hd_util_set_rotating_property (Orientation_change.wm, FALSE);
               Orientation_change.patience_requests = 0;
+              hd_render_manager_rotation_completed ();
             }
           break;
         }
@@ -1838,14 +1840,13 @@ hd_transition_rotate_ignore_damage()
        * remaining := min(max(remaining, damage_timeout_plus),
        *                  max(damage_timeout_max-elapsed, 0))
        */
-      max  = hd_transition_get_int("rotate", "damage_timeout_max", 1000);
+      max  = hd_transition_get_config()->rotate_damage_timeout_max;
       max -= g_timer_elapsed(Orientation_change.timer, NULL) * 1000.0;
       if (max > 0)
         {
           gint remaining;
 
-          remaining = hd_transition_get_int("rotate", "damage_timeout_plus",
-                                            50);
+          remaining = hd_transition_get_config()->rotate_damage_timeout_plus;
           if (Orientation_change.timeout_id->remaining < remaining)
             Orientation_change.timeout_id->remaining = remaining;
           if (Orientation_change.timeout_id->remaining > max)
@@ -1965,6 +1966,8 @@ transitions_ini_changed(GIOChannel *chnl, GIOCondition cond, gpointer unused)
   return TRUE;
 }
 
+static void hd_transition_config_swap(GKeyFile *ini);
+
 static GKeyFile *
 hd_transition_get_keyfile(void)
 {
@@ -2002,6 +2005,8 @@ hd_transition_get_keyfile(void)
   if (transitions_ini)
     g_key_file_free(transitions_ini);
   transitions_ini = ini;
+  transitions_ini_serial++;
+  hd_transition_config_swap(ini);
 
   if (!transitions_ini_watcher || transitions_ini_is_dirty > TRUE)
     {
@@ -2045,15 +2050,23 @@ out:
   return transitions_ini;
 }
 
-gint
-hd_transition_get_int(const gchar *transition, const char *key,
-                      gint default_val)
+/* Returns a number which changes whenever transitions.ini is reloaded,
+ * for those who derive something from its settings. */
+guint
+hd_transition_get_file_serial(void)
+{
+  hd_transition_get_keyfile();
+  return transitions_ini_serial;
+}
+
+static gint
+hd_transition_keyfile_get_int(GKeyFile *ini, const gchar *transition,
+                              const char *key, gint default_val)
 {
   gint value;
   GError *error;
-  GKeyFile *ini;
 
-  if (!(ini = hd_transition_get_keyfile()))
+  if (!ini)
     return default_val;
 
   error = NULL;
@@ -2069,15 +2082,14 @@ hd_transition_get_int(const gchar *transition, const char *key,
   return value;
 }
 
-gdouble
-hd_transition_get_double(const gchar *transition,
-                         const char *key, gdouble default_val)
+static gdouble
+hd_transition_keyfile_get_double(GKeyFile *ini, const gchar *transition,
+                                 const char *key, gdouble default_val)
 {
   gdouble value;
   GError *error;
-  GKeyFile *ini;
 
-  if (!(ini = hd_transition_get_keyfile()))
+  if (!ini)
     return default_val;
 
   error = NULL;
@@ -2093,16 +2105,14 @@ hd_transition_get_double(const gchar *transition,
   return value;
 }
 
-/* Returns a newly-allocated string that must *always* be freed by the caller */
-gchar *
-hd_transition_get_string(const gchar *transition, const char *key,
-                      gchar *default_val)
+static gchar *
+hd_transition_keyfile_get_string(GKeyFile *ini, const gchar *transition,
+                                 const char *key, gchar *default_val)
 {
   gchar *value;
   GError *error;
-  GKeyFile *ini;
 
-  if (!(ini = hd_transition_get_keyfile())) {
+  if (!ini) {
     /* It sould be a newly allocated string.
      * Fixes BMO #12722: hildon-desktop crashes on malformed transitions.ini.
      */
@@ -2123,20 +2133,194 @@ hd_transition_get_string(const gchar *transition, const char *key,
   return value;
 }
 
-HdKeyFrameList *
-hd_transition_get_keyframes(const gchar *transition, const char *key,
-                            gchar *default_val)
+static HdKeyFrameList *
+hd_transition_keyfile_get_keyframes(GKeyFile *ini, const gchar *transition,
+                                    const char *key, gchar *default_val)
 {
-  char *keyframetext = hd_transition_get_string(transition, key, default_val);
+  char *keyframetext = hd_transition_keyfile_get_string(ini, transition, key,
+                                                        default_val);
   HdKeyFrameList *keyframes = hd_key_frame_list_create(keyframetext);
   g_free(keyframetext);
   return keyframes;
 }
 
+gint
+hd_transition_get_int(const gchar *transition, const char *key,
+                      gint default_val)
+{
+  return hd_transition_keyfile_get_int(hd_transition_get_keyfile(),
+                                       transition, key, default_val);
+}
+
+gdouble
+hd_transition_get_double(const gchar *transition,
+                         const char *key, gdouble default_val)
+{
+  return hd_transition_keyfile_get_double(hd_transition_get_keyfile(),
+                                          transition, key, default_val);
+}
+
+/* Returns a newly-allocated string that must *always* be freed by the caller */
+gchar *
+hd_transition_get_string(const gchar *transition, const char *key,
+                      gchar *default_val)
+{
+  return hd_transition_keyfile_get_string(hd_transition_get_keyfile(),
+                                          transition, key, default_val);
+}
+
+HdKeyFrameList *
+hd_transition_get_keyframes(const gchar *transition, const char *key,
+                            gchar *default_val)
+{
+  return hd_transition_keyfile_get_keyframes(hd_transition_get_keyfile(),
+                                             transition, key, default_val);
+}
+
+static void
+hd_transition_config_get_durations(GKeyFile *ini, const gchar *transition,
+                                   gint default_length,
+                                   HdTransitionDurations *durations)
+{
+  durations->duration_in = hd_transition_keyfile_get_int(ini, transition,
+                                            "duration_in", default_length);
+  durations->duration_out = hd_transition_keyfile_get_int(ini, transition,
+                                            "duration_out", default_length);
+}
+
+static void
+hd_transition_config_get_launcher_in(GKeyFile *ini, const gchar *transition,
+                                     HdTransitionLauncherIn *launcher_in)
+{
+  launcher_in->sequenced = hd_transition_keyfile_get_int(ini, transition,
+                                                         "sequenced", 0);
+  launcher_in->keyframes = hd_transition_keyfile_get_keyframes(ini,
+                                          transition, "keyframes", "0,1");
+  launcher_in->keyframes_icon = hd_transition_keyfile_get_keyframes(ini,
+                                          transition, "keyframes_icon", "0,1");
+  launcher_in->keyframes_label = hd_transition_keyfile_get_keyframes(ini,
+                                          transition, "keyframes_label", "0,1");
+}
+
+/* Reads the config from @ini, or the defaults if it's %NULL. */
+static HdTransitionConfig *
+hd_transition_config_new(GKeyFile *ini)
+{
+  HdTransitionConfig *config = g_new0(HdTransitionConfig, 1);
+
+  config->ref_count = 1;
+  /* The curves don't depend on @ini; bake them before the first
+   * transition rather than during it. */
+  hd_transition_bake_curves();
+
+  hd_transition_config_get_durations(ini, "popup", 250, &config->popup);
+  hd_transition_config_get_durations(ini, "fade", 250, &config->fade);
+  hd_transition_config_get_durations(ini, "notification", 500,
+                                     &config->notification);
+  hd_transition_config_get_durations(ini, "subview", 250, &config->subview);
+  hd_transition_config_get_durations(ini, "rotate", 300, &config->rotate);
+  config->app_close_duration = hd_transition_keyfile_get_int(ini,
+                                          "app_close", "duration", 500);
+  config->launcher_launch_duration_out = hd_transition_keyfile_get_int(ini,
+                                          "launcher_launch", "duration_out", 250);
+  config->launcher_launch_delay = hd_transition_keyfile_get_int(ini,
+                                          "launcher_launch", "delay", 150);
+  config->banner_note_alpha = hd_transition_keyfile_get_double(ini,
+                                          "fade", "banner_note_alpha", 1.0);
+  config->info_note_alpha = hd_transition_keyfile_get_double(ini,
+                                          "fade", "info_note_alpha", 1.0);
+  config->notification_is_cool = hd_transition_keyfile_get_int(ini,
+                                          "notification", "is_cool", 0);
+  config->rotate_angle = hd_transition_keyfile_get_double(ini,
+                                          "rotate", "angle", 40);
+  config->rotate_damage_timeout = hd_transition_keyfile_get_int(ini,
+                                          "rotate", "damage_timeout", 50);
+  config->rotate_damage_timeout_plus = hd_transition_keyfile_get_int(ini,
+                                          "rotate", "damage_timeout_plus", 50);
+  config->rotate_damage_timeout_max = hd_transition_keyfile_get_int(ini,
+                                          "rotate", "damage_timeout_max", 1000);
+  config->home_parallax = hd_transition_keyfile_get_double(ini,
+                                          "home", "parallax", 1.3);
+  config->task_nav_zoom_duration = hd_transition_keyfile_get_int(ini,
+                                          "task_nav", "zoom_duration", 250);
+  config->task_nav_fly_duration = hd_transition_keyfile_get_int(ini,
+                                          "task_nav", "fly_duration", 250);
+  config->task_nav_notifade_in = hd_transition_keyfile_get_int(ini,
+                                          "task_nav", "notifade_in", 250);
+  config->task_nav_notifade_out = hd_transition_keyfile_get_int(ini,
+                                          "task_nav", "notifade_out", 250);
+  config->zaxisrotation = hd_transition_keyfile_get_int(ini,
+                                          "thp_tweaks", "zaxisrotation", 0);
+  config->thumb_desaturation = hd_transition_keyfile_get_int(ini,
+                                          "thp_tweaks", "thumb_desaturation", 0);
+  config->tactilepopups = hd_transition_keyfile_get_int(ini,
+                                          "thp_tweaks", "tactilepopups", 0);
+  hd_transition_config_get_launcher_in(ini, "launcher_in",
+                                       &config->launcher_in);
+  hd_transition_config_get_launcher_in(ini, "launcher_in_sub",
+                                       &config->launcher_in_sub);
+
+  return config;
+}
+
+const HdTransitionConfig *
+hd_transition_config_ref(const HdTransitionConfig *config)
+{
+  ((HdTransitionConfig *)config)->ref_count++;
+  return config;
+}
+
+void
+hd_transition_config_unref(const HdTransitionConfig *cconfig)
+{
+  HdTransitionConfig *config = (HdTransitionConfig *)cconfig;
+
+  if (!config || --config->ref_count > 0)
+    return;
+
+  hd_key_frame_list_free(config->launcher_in.keyframes);
+  hd_key_frame_list_free(config->launcher_in.keyframes_icon);
+  hd_key_frame_list_free(config->launcher_in.keyframes_label);
+  hd_key_frame_list_free(config->launcher_in_sub.keyframes);
+  hd_key_frame_list_free(config->launcher_in_sub.keyframes_icon);
+  hd_key_frame_list_free(config->launcher_in_sub.keyframes_label);
+  g_free(config);
+}
+
+static gboolean
+hd_transition_config_unref_idle(gpointer config)
+{
+  hd_transition_config_unref(config);
+  return FALSE;
+}
+
+/* Replaces @transitions_config with one read from the new @ini.  The old
+ * one is only dropped when we're back in the main loop, so pointers
+ * to it from hd_transition_get_config() remain valid until then. */
+static void
+hd_transition_config_swap(GKeyFile *ini)
+{
+  HdTransitionConfig *old = transitions_config;
+
+  transitions_config = hd_transition_config_new(ini);
+  if (old)
+    g_idle_add(hd_transition_config_unref_idle, old);
+}
+
+const HdTransitionConfig *
+hd_transition_get_config(void)
+{
+  hd_transition_get_keyfile();
+  if (G_UNLIKELY(!transitions_config))
+    /* Couldn't load transitions.ini. */
+    transitions_config = hd_transition_config_new(NULL);
+  return transitions_config;
+}
+
 void
 hd_transition_play_tactile(gboolean is_map, MBWMClientType c_type)
 {
-  if (hd_transition_get_int ("thp_tweaks", "tactilepopups", 0))
+  if (hd_transition_get_config()->tactilepopups)
     {
       gchar *pattern = NULL;
 
@@ -38,6 +38,57 @@
 #define HDCM_WINDOW_OPENED_SOUND    "/usr/share/sounds/ui-window_open.wav"
 #define HDCM_WINDOW_CLOSED_SOUND    "/usr/share/sounds/ui-window_close.wav"
 
+/* Durations of a transition's map and unmap variants. */
+typedef struct
+{
+  gint duration_in, duration_out;
+} HdTransitionDurations;
+
+/* The settings of the sequenced launcher transitions. */
+typedef struct
+{
+  gboolean        sequenced;
+  HdKeyFrameList *keyframes, *keyframes_icon, *keyframes_label;
+} HdTransitionLauncherIn;
+
+/* The settings the transitions use all the time, read from
+ * transitions.ini when it's (re)loaded.  It doesn't change after that;
+ * on reload a new one replaces it.  Get it with hd_transition_get_config()
+ * and don't keep the pointer across main loop iterations unless you
+ * hd_transition_config_ref() it. */
+typedef struct
+{
+  /* private */
+  gint                   ref_count;
+
+  HdTransitionDurations  popup, fade, notification, subview, rotate;
+  gint                   app_close_duration;
+  gint                   launcher_launch_duration_out, launcher_launch_delay;
+  gdouble                banner_note_alpha, info_note_alpha;
+  gboolean               notification_is_cool;
+  gdouble                rotate_angle;
+  gint                   rotate_damage_timeout, rotate_damage_timeout_plus,
+                         rotate_damage_timeout_max;
+
+  /* [home] and [task_nav] */
+  gdouble                home_parallax;
+  gint                   task_nav_zoom_duration, task_nav_fly_duration,
+                         task_nav_notifade_in, task_nav_notifade_out;
+
+  /* [thp_tweaks] */
+  gboolean               zaxisrotation, tactilepopups, thumb_desaturation;
+
+  /* [launcher_in] and [launcher_in_sub] */
+  HdTransitionLauncherIn launcher_in, launcher_in_sub;
+} HdTransitionConfig;
+
+const HdTransitionConfig *
+hd_transition_get_config(void);
+const HdTransitionConfig *
+hd_transition_config_ref(const HdTransitionConfig *config);
+void
+hd_transition_config_unref(const HdTransitionConfig *config);
+
 float
 hd_transition_overshoot(float x);
 
@@ -122,6 +173,9 @@ hd_transition_get_keyframes(const gchar *transition, const char *key,
 void
 hd_transition_set_file_changed(void);
 
+guint
+hd_transition_get_file_serial(void);
+
 void
 hd_transition_play_tactile(gboolean is_map, MBWMClientType c_type);
 
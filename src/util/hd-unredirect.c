@@ -0,0 +1,151 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "hd-unredirect.h"
+
+struct _HdUnredirect
+{
+  guint         min_fps, sustain_ms, cooldown_ms;
+
+  /* The client which could be unredirected, the first and last frame
+   * it was damaged in without a long gap, and the number of frames
+   * in between. */
+  gconstpointer candidate;
+  gint64        streak_start, last_damage;
+  guint         streak_frames;
+
+  /* Nothing qualifies until then. */
+  gint64        blocked_until;
+
+  /* Whether we're composited and since when, -1 if we don't know yet. */
+  gboolean      composited, unredirected_by_us;
+  gint64        since;
+  HdUnredirectStats stats;
+};
+
+HdUnredirect *
+hd_unredirect_new (void)
+{
+  HdUnredirect *unr;
+
+  unr = g_new0 (HdUnredirect, 1);
+  unr->composited = TRUE;
+  unr->streak_start = -1;
+  unr->since = -1;
+  hd_unredirect_configure (unr, 20, 2000, 3000);
+
+  return unr;
+}
+
+void
+hd_unredirect_free (HdUnredirect *unr)
+{
+  g_free (unr);
+}
+
+void
+hd_unredirect_configure (HdUnredirect *unr, guint min_fps,
+                         guint sustain_ms, guint cooldown_ms)
+{
+  unr->min_fps     = MAX (min_fps, 1);
+  unr->sustain_ms  = sustain_ms;
+  unr->cooldown_ms = cooldown_ms;
+}
+
+void
+hd_unredirect_set_candidate (HdUnredirect *unr, gconstpointer candidate)
+{
+  if (candidate != unr->candidate)
+    {
+      unr->candidate = candidate;
+      unr->streak_start = -1;
+    }
+}
+
+gboolean
+hd_unredirect_damage (HdUnredirect *unr, gint64 now)
+{
+  if (!unr->candidate || !unr->composited || now < unr->blocked_until)
+    return FALSE;
+
+  /* Start over after a gap of more than two frames. */
+  if (unr->streak_start < 0
+      || now - unr->last_damage > 2000 / unr->min_fps)
+    {
+      unr->streak_start = now;
+      unr->streak_frames = 0;
+    }
+  unr->last_damage = now;
+  unr->streak_frames++;
+
+  if (now - unr->streak_start < unr->sustain_ms
+      || unr->streak_frames * 1000 < unr->min_fps * (now - unr->streak_start))
+    return FALSE;
+
+  unr->streak_start = -1;
+  return TRUE;
+}
+
+/* Add the time since the last change to the right counter. */
+static void
+hd_unredirect_account (HdUnredirect *unr, gint64 now)
+{
+  if (unr->since >= 0 && now > unr->since)
+    {
+      if (unr->composited)
+        unr->stats.composited_ms += now - unr->since;
+      else
+        unr->stats.unredirected_ms += now - unr->since;
+    }
+  unr->since = now;
+}
+
+void
+hd_unredirect_set_composited (HdUnredirect *unr, gboolean composited,
+                              gboolean automatic, gint64 now)
+{
+  hd_unredirect_account (unr, now);
+  if (composited == unr->composited)
+    return;
+
+  unr->composited = composited;
+  unr->streak_start = -1;
+  if (composited)
+    {
+      if (unr->unredirected_by_us)
+        unr->stats.redirects++;
+      unr->unredirected_by_us = FALSE;
+      unr->blocked_until = now + unr->cooldown_ms;
+    }
+  else if (automatic)
+    {
+      unr->unredirected_by_us = TRUE;
+      unr->stats.unredirects++;
+    }
+}
+
+void
+hd_unredirect_get_stats (HdUnredirect *unr, gint64 now,
+                         HdUnredirectStats *stats)
+{
+  hd_unredirect_account (unr, now);
+  *stats = unr->stats;
+}
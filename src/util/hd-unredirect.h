@@ -0,0 +1,77 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2008 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __HD_UNREDIRECT_H__
+#define __HD_UNREDIRECT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Decides when a fullscreen client nobody asked about should be
+ * unredirected, and keeps count of the time spent composited and not.
+ * A client qualifies if it's damaged in at least @min_fps frames
+ * a second for @sustain_ms without a gap longer than two frames.
+ * After we go back to compositing no client qualifies for
+ * @cooldown_ms, so that a client shown over now and then doesn't make
+ * us switch back and forth.  It only knows about keys and times in
+ * milliseconds, the caller tells it which client could be unredirected
+ * and when it's damaged. */
+typedef struct _HdUnredirect HdUnredirect;
+
+typedef struct
+{
+  /* Milliseconds spent composited and with a client unredirected. */
+  guint64 composited_ms, unredirected_ms;
+  /* Times a client was unredirected because of hd_unredirect_damage()
+   * and times we went back to compositing after that. */
+  guint   unredirects, redirects;
+} HdUnredirectStats;
+
+HdUnredirect *hd_unredirect_new           (void);
+void          hd_unredirect_free          (HdUnredirect *unr);
+
+void          hd_unredirect_configure     (HdUnredirect *unr,
+                                           guint         min_fps,
+                                           guint         sustain_ms,
+                                           guint         cooldown_ms);
+
+/* Tells which client could be unredirected now, %NULL if none. */
+void          hd_unredirect_set_candidate (HdUnredirect *unr,
+                                           gconstpointer candidate);
+/* The candidate was damaged in a frame.  Returns whether it's time
+ * to unredirect it. */
+gboolean      hd_unredirect_damage        (HdUnredirect *unr,
+                                           gint64        now);
+/* Tells whether the screen is composited from now on and if not,
+ * whether it's @automatic, ie. because hd_unredirect_damage() said so. */
+void          hd_unredirect_set_composited (HdUnredirect *unr,
+                                            gboolean      composited,
+                                            gboolean      automatic,
+                                            gint64        now);
+
+void          hd_unredirect_get_stats     (HdUnredirect      *unr,
+                                           gint64             now,
+                                           HdUnredirectStats *stats);
+
+G_END_DECLS
+
+#endif /* __HD_UNREDIRECT_H__ */
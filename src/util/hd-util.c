@@ -14,6 +14,7 @@
 #include "hd-note.h"
 #include "hd-transition.h"
 #include "hd-render-manager.h"
+#include "hd-occlusion.h"
 
 #include <gdk/gdk.h>
 #include <GLES2/gl2.h>
@@ -600,20 +601,147 @@ hd_util_click (const MBWindowManagerClient *c)
   XSendEvent(xdpy, xwin, False, ButtonPressMask, (XEvent *)&ev);
 }
 
+/*
+ * Cache of the actor -> stage transformation used by
+ * hd_util_get_actor_bounds().  Since we only deal with scaling and
+ * translation, the transformation is X = x * scale + offset.  Every
+ * actor on the way to the stage has its own, made of its parent's and
+ * its own position, anchor and scale.  All of them are good as long as
+ * none of the actors we watch moved, so looking one up again costs
+ * O(1) until something does.
+ */
+static const gchar *hd_util_transform_signals[] = {
+  "parent-set", "notify::allocation", "notify::x", "notify::y",
+  "notify::scale-x", "notify::scale-y",
+  "notify::anchor-x", "notify::anchor-y",
+  "notify::rotation-angle-x", "notify::rotation-angle-y",
+  "notify::rotation-angle-z",
+};
+
+/* Bumped whenever an actor with a cached transformation or one of its
+ * ancestors is moved, scaled, rotated or reparented. */
+static guint hd_util_transform_generation = 1;
+
+typedef struct
+{
+  ClutterActor *actor;
+  gulong handlers[G_N_ELEMENTS (hd_util_transform_signals)];
+  /* The generation it was calculated in, 0 if none yet. */
+  guint generation;
+
+  gboolean valid;
+  gdouble  scalex, scaley;
+  gdouble  offx, offy;
+} HdUtilTransform;
+
+/* The arguments of "parent-set" and "notify" differ but we don't look
+ * at them. */
+static void
+hd_util_transform_changed (ClutterActor *actor, gpointer arg, gpointer unused)
+{
+  if (!++hd_util_transform_generation)
+    hd_util_transform_generation++;
+}
+
+static void
+hd_util_transform_free (HdUtilTransform *trans)
+{
+  guint i;
+
+  /* If the actor is being finalized its handlers are gone already. */
+  for (i = 0; i < G_N_ELEMENTS (trans->handlers); i++)
+    if (g_signal_handler_is_connected (trans->actor, trans->handlers[i]))
+      g_signal_handler_disconnect (trans->actor, trans->handlers[i]);
+  g_free (trans);
+}
+
+/* Returns the cached transformation of @actor, making and watching it
+ * if there is none yet. */
+static HdUtilTransform *
+hd_util_transform_lookup (ClutterActor *actor)
+{
+  static GQuark quark;
+  HdUtilTransform *trans;
+  guint i;
+
+  if (G_UNLIKELY (!quark))
+    quark = g_quark_from_static_string ("hd-util-transform");
+  if ((trans = g_object_get_qdata (G_OBJECT (actor), quark)) != NULL)
+    return trans;
+
+  trans = g_new0 (HdUtilTransform, 1);
+  trans->actor = actor;
+  for (i = 0; i < G_N_ELEMENTS (hd_util_transform_signals); i++)
+    trans->handlers[i] = g_signal_connect (actor,
+                                  hd_util_transform_signals[i],
+                                  G_CALLBACK (hd_util_transform_changed),
+                                  NULL);
+  g_object_set_qdata_full (G_OBJECT (actor), quark, trans,
+                           (GDestroyNotify) hd_util_transform_free);
+  return trans;
+}
+
+/* Returns the up-to-date transformation of @actor, recalculating it
+ * and those of its ancestors if anything moved since it was cached.
+ * Returns NULL for the stage. */
+static const HdUtilTransform *
+hd_util_get_actor_transform (ClutterActor *actor)
+{
+  const HdUtilTransform *ptrans;
+  HdUtilTransform *trans;
+  gfloat px,py;
+  gdouble scalex, scaley;
+  gfloat anchorx, anchory;
+
+  if (!actor || CLUTTER_IS_STAGE (actor))
+    return NULL;
+
+  trans = hd_util_transform_lookup (actor);
+  if (trans->generation == hd_util_transform_generation)
+    return trans;
+
+  ptrans = hd_util_get_actor_transform (clutter_actor_get_parent (actor));
+
+  clutter_actor_get_scale(actor, &scalex, &scaley);
+  clutter_actor_get_anchor_point(actor, &anchorx, &anchory);
+  clutter_actor_get_position(actor, &px, &py);
+
+  /* Big safety check here - don't attempt to work out bounds if anything
+   * is rotated, as we'll probably get it wrong. */
+  trans->valid = !ptrans || ptrans->valid;
+  if (clutter_actor_get_rotation_angle(actor, CLUTTER_X_AXIS)!=0 ||
+      clutter_actor_get_rotation_angle(actor, CLUTTER_Y_AXIS)!=0 ||
+      clutter_actor_get_rotation_angle(actor, CLUTTER_Z_AXIS)!=0)
+    trans->valid = FALSE;
+
+  /* X = parent(x * scale - anchor * scale + position) */
+  trans->scalex = scalex;
+  trans->scaley = scaley;
+  trans->offx = px - anchorx * scalex;
+  trans->offy = py - anchory * scaley;
+  if (ptrans)
+    {
+      trans->offx = trans->offx * ptrans->scalex + ptrans->offx;
+      trans->offy = trans->offy * ptrans->scaley + ptrans->offy;
+      trans->scalex *= ptrans->scalex;
+      trans->scaley *= ptrans->scaley;
+    }
+  trans->generation = hd_util_transform_generation;
+
+  return trans;
+}
+
 /* Try and get the translated bounds for an actor (the actual pixel position
  * of it on the screen). If geo is 0 or width/height are 0, this func will
  * use the full bounds of the actor. Otherwise we translate the bounds given
  * in geo (eg. for updating an area of an actor). Returns false if it failed
  * (because the actor or its parents were rotated) */
-static gboolean
+gboolean
 hd_util_get_actor_bounds(ClutterActor *actor, ClutterGeometry *geo, gboolean *is_visible)
 {
   gdouble x, y;
   gdouble width, height;
-  ClutterActor *it = actor;
-  ClutterActor *stage = clutter_actor_get_stage(actor);
-  gboolean visible = TRUE;
-  gboolean valid = TRUE;
+  const HdUtilTransform *trans;
 
   if (geo && geo->width && geo->height)
     {
@@ -632,28 +760,12 @@ hd_util_get_actor_bounds(ClutterActor *actor, ClutterGeometry *geo, gboolean *is
       height = h;
     }
 
-  while (it && it != stage)
+  if ((trans = hd_util_get_actor_transform (actor)) != NULL)
     {
-      gfloat px,py;
-      gdouble scalex, scaley;
-      gfloat anchorx, anchory;
-
-      /* Big safety check here - don't attempt to work out bounds if anything
-       * is rotated, as we'll probably get it wrong. */
-      clutter_actor_get_scale(it, &scalex, &scaley);
-      clutter_actor_get_anchor_point(it, &anchorx, &anchory);
-      if (clutter_actor_get_rotation_angle(it, CLUTTER_X_AXIS)!=0 ||
-          clutter_actor_get_rotation_angle(it, CLUTTER_Y_AXIS)!=0 ||
-          clutter_actor_get_rotation_angle(it, CLUTTER_Z_AXIS)!=0)
-        valid = FALSE;
-
-      clutter_actor_get_position(it, &px, &py);
-      x = (x - anchorx) * scalex + px;
-      y = (y - anchory) * scaley + py;
-      width *= scalex;
-      height *= scaley;
-
-      it = clutter_actor_get_parent(it);
+      x = x * trans->scalex + trans->offx;
+      y = y * trans->scaley + trans->offy;
+      width *= trans->scalex;
+      height *= trans->scaley;
     }
 
   if (geo)
@@ -666,9 +778,9 @@ hd_util_get_actor_bounds(ClutterActor *actor, ClutterGeometry *geo, gboolean *is
     }
   if (is_visible)
     {
-      *is_visible = visible;
+      *is_visible = TRUE;
     }
-  return valid;
+  return !trans || trans->valid;
 }
 
 /* Call this after an actor is updated, and it will ask the stage to redraw
@@ -704,38 +816,59 @@ hd_util_partial_redraw_if_possible(ClutterActor *actor, ClutterGeometry *bounds)
       clutter_actor_queue_redraw(stage);
 }
 
+/* Which clients are covered by the ones above them, see
+ * hd_util_client_obscured().  It is rebuilt when it's needed after
+ * hd_util_client_obscured_invalidate(). */
+static HdOcclusion *obscured_index;
+static gboolean obscured_index_valid;
+
+/* Call when the stacking, the mappedness or the geometry of any
+ * client changes. */
+void
+hd_util_client_obscured_invalidate (void)
+{
+  obscured_index_valid = FALSE;
+}
+
+static void
+hd_util_client_obscured_rebuild (MBWindowManager *wm)
+{
+  MBWindowManagerClient *c;
+
+  if (!obscured_index)
+    obscured_index = hd_occlusion_new ();
+  else
+    hd_occlusion_reset (obscured_index);
+
+  for (c = wm->stack_top; c; c = c->stacked_below)
+    if (c->window) /* be safe */
+      hd_occlusion_push (obscured_index, c,
+                (cairo_rectangle_int_t*)(void*)&c->window->geometry);
+
+  obscured_index_valid = TRUE;
+}
+
 /* Check to see whether clients above this one totally obscure it */
 gboolean hd_util_client_obscured(MBWindowManagerClient *client)
 {
-  cairo_region_t *region;
-  MBWindowManagerClient *obscurer;
-  gboolean empty;
+  HdOcclusionResult result;
+  const cairo_rectangle_int_t *geo;
 
   if (!client->window)
     return FALSE; /* be safe */
 
-  /* Get region representing the current client */
-  region = cairo_region_create_rectangle((cairo_rectangle_int_t*)(void*)&client->window->geometry);
-
-  /* Subtract the region of all clients above */
-  for (obscurer = client->stacked_above;
-       obscurer && !cairo_region_is_empty(region);
-       obscurer = obscurer->stacked_above)
+  geo = (cairo_rectangle_int_t*)(void*)&client->window->geometry;
+  if (!obscured_index_valid
+      || (result = hd_occlusion_lookup (obscured_index, client, geo))
+           == HD_OCCLUSION_UNKNOWN)
     {
-      cairo_region_t *obscure_region;
-      if (!obscurer->window)
-        continue; /* be safe */
-      obscure_region =
-          cairo_region_create_rectangle((cairo_rectangle_int_t*)(void*)&obscurer->window->geometry);
-      cairo_region_subtract(region, obscure_region);
-      cairo_region_destroy(obscure_region);
+      /* We missed an invalidation (eg. the client has been resized
+       * but we haven't been told yet); better to start over. */
+      hd_util_client_obscured_rebuild (client->wmref);
+      result = hd_occlusion_lookup (obscured_index, client, geo);
     }
 
-  /* If there is nothing left, then this can't
-   * be visible */
-  empty = cairo_region_is_empty(region);
-  cairo_region_destroy(region);
-  return empty;
+  return result == HD_OCCLUSION_COVERED;
 }
 
 
@@ -37,10 +37,14 @@ gboolean hd_util_client_has_video_overlay(MBWindowManagerClient *client);
 
 void hd_util_click (const MBWindowManagerClient *c);
 
+gboolean
+hd_util_get_actor_bounds(ClutterActor *actor, ClutterGeometry *geo,
+                         gboolean *is_visible);
 void
 hd_util_partial_redraw_if_possible(ClutterActor *actor, ClutterGeometry *bounds);
 
 gboolean hd_util_client_obscured(MBWindowManagerClient *client);
+void hd_util_client_obscured_invalidate (void);
 
 /* Functions for loading and interpolating from a list of keyframes */
 typedef struct _HdKeyFrameList HdKeyFrameList;
@@ -0,0 +1,173 @@
+/* Micro-benchmark for hd-launcher-index.c: makes a launcher tree of
+ * synthetic .desktop entries and matches a lot of synthetic windows
+ * against it, with the linear scan hd_app_mgr_match_window() used to
+ * do and with HdLauncherIndex.  Both must find the same apps.
+ *
+ * Usage: test-app-match-bench [n-entries] [n-windows] */
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "launcher/hd-launcher-index.h"
+
+typedef struct
+{
+  gchar *id, *service, *wm_class, *exec;
+} Entry;
+
+typedef struct
+{
+  gchar *res_name, *res_class;
+} Window;
+
+static Entry *make_entries(guint n)
+{
+  Entry *entries;
+  guint i;
+
+  entries = g_new0(Entry, n);
+  for (i = 0; i < n; i++)
+    {
+      /* Mostly like osso apps: an id, a D-Bus service and sometimes
+       * a StartupWMClass. */
+      entries[i].id = g_strdup_printf("app-%u-%s", i,
+                                      i % 3 ? "viewer" : "editor");
+      entries[i].service = g_strdup_printf("com.nokia.app%u", i);
+      if (i % 4 == 0)
+        entries[i].wm_class = g_strdup_printf("App%uClass", i);
+      entries[i].exec = g_strdup_printf("app%u", i);
+    }
+
+  return entries;
+}
+
+static Window *make_windows(guint n, guint nentries)
+{
+  Window *windows;
+  guint i;
+
+  windows = g_new0(Window, n);
+  for (i = 0; i < n; i++)
+    {
+      guint e = g_random_int_range(0, nentries * 2);
+
+      switch (g_random_int_range(0, 4))
+        {
+          case 0: /* WM_CLASS from StartupWMClass */
+            windows[i].res_class = g_strdup_printf("App%uClass", e);
+            break;
+          case 1: /* WM_CLASS like the id */
+            windows[i].res_class = g_strdup_printf("App-%u", e);
+            break;
+          case 2: /* only the executable */
+            windows[i].res_name = g_strdup_printf("app%u", e);
+            break;
+          default: /* some unknown program */
+            windows[i].res_name = g_strdup_printf("xterm%u", e);
+            windows[i].res_class = g_strdup("XTerm");
+            break;
+        }
+    }
+
+  return windows;
+}
+
+/* What hd_launcher_app_match_window() does. */
+static gboolean match_one(const Entry *entry, const Window *win)
+{
+  if (!win->res_name && !win->res_class)
+    return FALSE;
+  if (win->res_class && entry->wm_class
+      && !strcmp(entry->wm_class, win->res_class))
+    return TRUE;
+  if (win->res_class
+      && !g_ascii_strncasecmp(win->res_class, entry->id,
+                              strlen(win->res_class)))
+    return TRUE;
+  if (win->res_name && !g_strcmp0(win->res_name, entry->exec))
+    return TRUE;
+  return FALSE;
+}
+
+static gint linear_match(const Entry *entries, guint n, const Window *win)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    if (match_one(&entries[i], win))
+      return i;
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  guint nentries, nwindows, i, nmatched, mismatches;
+  Entry *entries;
+  Window *windows;
+  HdLauncherIndex *index;
+  GPtrArray *apps;
+  GTimer *timer;
+  gdouble t_linear, t_index, t_build;
+
+  nentries = argc > 1 ? atoi(argv[1]) : 500;
+  nwindows = argc > 2 ? atoi(argv[2]) : 5000;
+  entries = make_entries(nentries);
+  windows = make_windows(nwindows, nentries);
+  timer = g_timer_new();
+
+  nmatched = 0;
+  g_timer_start(timer);
+  for (i = 0; i < nwindows; i++)
+    nmatched += linear_match(entries, nentries, &windows[i]) >= 0;
+  t_linear = g_timer_elapsed(timer, NULL);
+
+  g_timer_start(timer);
+  index = hd_launcher_index_new();
+  for (i = 0; i < nentries; i++)
+    hd_launcher_index_add_app(index, &entries[i], entries[i].id,
+                              entries[i].service, entries[i].wm_class,
+                              entries[i].exec);
+  t_build = g_timer_elapsed(timer, NULL);
+
+  apps = g_ptr_array_new();
+  g_timer_start(timer);
+  for (i = 0; i < nwindows; i++)
+    {
+      g_ptr_array_set_size(apps, 0);
+      hd_launcher_index_match_window(index, windows[i].res_name,
+                                     windows[i].res_class, apps);
+    }
+  t_index = g_timer_elapsed(timer, NULL);
+
+  mismatches = 0;
+  for (i = 0; i < nwindows; i++)
+    {
+      gint expected = linear_match(entries, nentries, &windows[i]);
+
+      g_ptr_array_set_size(apps, 0);
+      hd_launcher_index_match_window(index, windows[i].res_name,
+                                     windows[i].res_class, apps);
+      if (expected < 0
+          ? apps->len != 0
+          : !apps->len || apps->pdata[0] != &entries[expected])
+        mismatches++;
+    }
+  for (i = 0; i < nentries; i++)
+    if (hd_launcher_index_find(index, entries[i].id) != &entries[i]
+        || hd_launcher_index_find_service(index, entries[i].service)
+           != &entries[i])
+      mismatches++;
+
+  g_print("%u entries, %u windows, %u matched\n",
+          nentries, nwindows, nmatched);
+  g_print("linear scan: %8.3f us/window\n", t_linear * 1e6 / nwindows);
+  g_print("index:       %8.3f us/window (%.3f ms to build)\n",
+          t_index * 1e6 / nwindows, t_build * 1e3);
+  if (mismatches)
+    g_print("%u MISMATCHES\n", mismatches);
+
+  g_ptr_array_free(apps, TRUE);
+  hd_launcher_index_free(index);
+  g_timer_destroy(timer);
+  return mismatches != 0;
+}
@@ -0,0 +1,205 @@
+/* Software model of the two blur modes of tidy-blur-effect.c: blurring
+ * the half size texture once per unit of blur, and the pyramid, which
+ * halves it a few times, blurs there and scales back up.  Both use the
+ * same 5-tap shader and bilinear filtering, done here on the CPU, so the
+ * times compare the amount of work, not a GPU.  Prints the time of each
+ * mode for each amount of blur and checks they blur about as much.
+ *
+ * Usage: test-blur-bench [width] [height] */
+#include <stdlib.h>
+#include <math.h>
+#include <glib.h>
+
+#include "tidy/tidy-blur-plan.h"
+
+#define LEVELS    TIDY_BLUR_LEVELS
+#define LEVEL_MIN TIDY_BLUR_LEVEL_MIN
+
+typedef struct
+{
+  gint    w, h;
+  gfloat *px;
+} Image;
+
+static Image *image_new(gint w, gint h)
+{
+  Image *img = g_new(Image, 1);
+
+  img->w = w;
+  img->h = h;
+  img->px = g_new0(gfloat, w * h);
+  return img;
+}
+
+static void image_free(Image *img)
+{
+  g_free(img->px);
+  g_free(img);
+}
+
+/* Mirrored repeat, like the pipelines. */
+static gfloat texel(const Image *img, gint x, gint y)
+{
+  if (x < 0) x = -x - 1;
+  if (y < 0) y = -y - 1;
+  if (x >= img->w) x = 2 * img->w - x - 1;
+  if (y >= img->h) y = 2 * img->h - y - 1;
+  return img->px[y * img->w + x];
+}
+
+/* Linear filtering of the point between four texels. */
+static gfloat corner(const Image *img, gint x, gint y)
+{
+  return (texel(img, x-1, y-1) + texel(img, x, y-1)
+          + texel(img, x-1, y) + texel(img, x, y)) * 0.25f;
+}
+
+/* One pass of the shader, which samples half a texel diagonally away. */
+static void blur_pass(const Image *src, Image *dst)
+{
+  gint x, y;
+
+  for (y = 0; y < src->h; y++)
+    for (x = 0; x < src->w; x++)
+      dst->px[y * dst->w + x] = texel(src, x, y) * 0.5f
+        + (corner(src, x, y) + corner(src, x+1, y)
+           + corner(src, x, y+1) + corner(src, x+1, y+1)) * 0.125f;
+}
+
+static void downsample(const Image *src, Image *dst)
+{
+  gint x, y;
+
+  for (y = 0; y < dst->h; y++)
+    for (x = 0; x < dst->w; x++)
+      dst->px[y * dst->w + x] = corner(src, 2*x+1, 2*y+1);
+}
+
+static void upsample(const Image *src, Image *dst)
+{
+  gint x, y;
+
+  for (y = 0; y < dst->h; y++)
+    for (x = 0; x < dst->w; x++)
+      {
+        /* The center of the texel in @src coordinates. */
+        gfloat sx = (x + 0.5f) / 2 - 0.5f, sy = (y + 0.5f) / 2 - 0.5f;
+        gint x0 = floorf(sx), y0 = floorf(sy);
+        gfloat fx = sx - x0, fy = sy - y0;
+
+        dst->px[y * dst->w + x] =
+            (texel(src, x0, y0) * (1-fx) + texel(src, x0+1, y0) * fx) * (1-fy)
+          + (texel(src, x0, y0+1) * (1-fx) + texel(src, x0+1, y0+1) * fx) * fy;
+      }
+}
+
+/* Blurs @img @blur times in place. */
+static void blur_passes(Image *img, guint blur)
+{
+  Image *tmp = image_new(img->w, img->h);
+  gfloat *swap;
+
+  while (blur--)
+    {
+      blur_pass(img, tmp);
+      swap = img->px; img->px = tmp->px; tmp->px = swap;
+    }
+  image_free(tmp);
+}
+
+static void blur_pyramid(Image *img, guint blur)
+{
+  Image *levels[LEVELS+1];
+  guint n, level, passes, l;
+
+  levels[0] = img;
+  for (n = 0; n < LEVELS; n++)
+    {
+      gint w = levels[n]->w / 2, h = levels[n]->h / 2;
+
+      if (w < LEVEL_MIN || h < LEVEL_MIN)
+        break;
+      levels[n+1] = image_new(w, h);
+    }
+
+  level = tidy_blur_plan_pyramid(blur, n, &passes);
+  for (l = 1; l <= level; l++)
+    downsample(levels[l-1], levels[l]);
+  blur_passes(levels[level], passes);
+  for (l = level; l > 0; l--)
+    upsample(levels[l], levels[l-1]);
+
+  for (l = 1; l <= n; l++)
+    image_free(levels[l]);
+}
+
+/* Horizontal variance of a blurred dot in the middle. */
+static gdouble spread(void (*blur_func)(Image *, guint), guint blur,
+                      gint w, gint h)
+{
+  Image *img = image_new(w, h);
+  gdouble sum, var;
+  gint x, y;
+
+  img->px[(h/2) * w + w/2] = 1;
+  blur_func(img, blur);
+  sum = var = 0;
+  for (y = 0; y < h; y++)
+    for (x = 0; x < w; x++)
+      {
+        sum += img->px[y * w + x];
+        var += img->px[y * w + x] * (x - w/2 + 0.5) * (x - w/2 + 0.5);
+      }
+  image_free(img);
+  return var / sum;
+}
+
+static gdouble timed(void (*blur_func)(Image *, guint), guint blur,
+                     gint w, gint h)
+{
+  Image *img = image_new(w, h);
+  GTimer *timer = g_timer_new();
+  gdouble t;
+  gint i;
+
+  for (i = 0; i < w * h; i++)
+    img->px[i] = g_random_double();
+  g_timer_start(timer);
+  blur_func(img, blur);
+  t = g_timer_elapsed(timer, NULL);
+  g_timer_destroy(timer);
+  image_free(img);
+  return t;
+}
+
+int main(int argc, char **argv)
+{
+  static const guint blurs[] = { 1, 2, 4, 8, 12, 16, 24, 32, 48, 64 };
+  gint w, h, failures;
+  guint i;
+
+  /* The half size texture of an 800x480 screen. */
+  w = argc > 1 ? atoi(argv[1]) : 400;
+  h = argc > 2 ? atoi(argv[2]) : 240;
+
+  failures = 0;
+  g_print("%dx%d\n", w, h);
+  g_print("blur   passes ms  pyramid ms  passes var  pyramid var\n");
+  for (i = 0; i < G_N_ELEMENTS(blurs); i++)
+    {
+      gdouble vpass, vpyr;
+
+      vpass = spread(blur_passes, blurs[i], 96, 96);
+      vpyr  = spread(blur_pyramid, blurs[i], 96, 96);
+      g_print("%4u %12.2f %11.2f %11.2f %12.2f\n", blurs[i],
+              timed(blur_passes, blurs[i], w, h) * 1000,
+              timed(blur_pyramid, blurs[i], w, h) * 1000,
+              vpass, vpyr);
+      if (vpyr < vpass / 2 || vpyr > vpass * 2)
+        failures++;
+    }
+
+  if (failures)
+    g_print("%d amounts of blur with a very different spread\n", failures);
+  return failures != 0;
+}
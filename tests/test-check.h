@@ -0,0 +1,25 @@
+/* What the self-checking tests share: check() prints whether each
+ * check passed, and main() returns check_summary(), which is non-zero
+ * if any failed, so that make check notices. */
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <glib.h>
+
+static int failures;
+
+static G_GNUC_UNUSED void check(gboolean ok, const gchar *what)
+{
+  g_print("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok)
+    failures++;
+}
+
+static G_GNUC_UNUSED int check_summary(void)
+{
+  if (failures)
+    g_print("%d FAILURES\n", failures);
+  return failures != 0;
+}
+
+#endif
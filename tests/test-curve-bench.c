@@ -0,0 +1,119 @@
+/* Micro-benchmark for hd-curve.c: evaluates the easing curves a frame
+ * of the transitions needs for a number of actors, with the cos(),
+ * sin() and powf() of the functions hd-transition.c bakes and with
+ * the HdCurve:s baked from them, and checks that they agree.
+ *
+ * The target is a slow ARM-class device, which we can't time here, so
+ * besides the times measured on this machine it prints what share of
+ * a 60 Hz frame the curves would take on a CPU @slowdown times slower.
+ *
+ * Usage: test-curve-bench [n-actors] [n-frames] [slowdown] */
+#include <stdlib.h>
+#include <math.h>
+#include <glib.h>
+
+#include "util/hd-curve.h"
+
+#define FRAME_US 16667.0
+
+/* The control points of the portrait notification's path in
+ * hd-transition.c, in pixels. */
+static float notification_x[] = {  185,  185,  112,  -32 };
+static float notification_y[] = {  -88,  -32,    0,    0 };
+
+typedef struct
+{
+  const char *name;
+  HdCurveFunc func;
+  gpointer user_data;
+  /* How much the baked curve may differ. */
+  float tolerance;
+  HdCurve curve;
+} Curve;
+
+static Curve curves[] =
+{
+  { "overshoot",      hd_curve_overshoot,     NULL,           1e-4 },
+  { "smooth_ramp",    hd_curve_smooth_ramp,   NULL,           1e-4 },
+  { "ease_out",       hd_curve_ease_out,      NULL,           1e-4 },
+  { "notification_x", hd_curve_ramped_bezier, notification_x, 0.1 },
+  { "notification_y", hd_curve_ramped_bezier, notification_y, 0.1 },
+};
+
+int main(int argc, char **argv)
+{
+  guint nactors, nframes, frame, actor, i;
+  gdouble slowdown, t_exact, t_baked, t_bake;
+  volatile float sink;
+  gboolean bad;
+  GTimer *timer;
+
+  nactors = argc > 1 ? atoi(argv[1]) : 20;
+  nframes = argc > 2 ? atoi(argv[2]) : 100000;
+  slowdown = argc > 3 ? atof(argv[3]) : 10;
+  timer = g_timer_new();
+
+  g_timer_start(timer);
+  for (i = 0; i < G_N_ELEMENTS(curves); i++)
+    hd_curve_bake(&curves[i].curve, curves[i].func,
+                  curves[i].user_data);
+  t_bake = g_timer_elapsed(timer, NULL);
+
+  /* Every actor evaluates every curve once a frame, at a slightly
+   * different point of its timeline. */
+  sink = 0;
+  g_timer_start(timer);
+  for (frame = 0; frame < nframes; frame++)
+    for (actor = 0; actor < nactors; actor++)
+      {
+        float t = (float)((frame + actor) % 1000) / 1000;
+        for (i = 0; i < G_N_ELEMENTS(curves); i++)
+          sink += curves[i].func(t, curves[i].user_data);
+      }
+  t_exact = g_timer_elapsed(timer, NULL);
+
+  g_timer_start(timer);
+  for (frame = 0; frame < nframes; frame++)
+    for (actor = 0; actor < nactors; actor++)
+      {
+        float t = (float)((frame + actor) % 1000) / 1000;
+        for (i = 0; i < G_N_ELEMENTS(curves); i++)
+          sink += hd_curve_eval(&curves[i].curve, t);
+      }
+  t_baked = g_timer_elapsed(timer, NULL);
+
+  bad = FALSE;
+  for (i = 0; i < G_N_ELEMENTS(curves); i++)
+    {
+      float maxerr = 0;
+      guint j;
+
+      for (j = 0; j <= 10000; j++)
+        {
+          float t = j / 10000.0f;
+          float err = fabsf(curves[i].func(t, curves[i].user_data)
+                            - hd_curve_eval(&curves[i].curve, t));
+          if (err > maxerr)
+            maxerr = err;
+        }
+      g_print("%-15s max error %g\n", curves[i].name, maxerr);
+      if (maxerr > curves[i].tolerance)
+        bad = TRUE;
+    }
+
+  g_print("%u actors x %u curves, %u frames\n",
+          nactors, (guint)G_N_ELEMENTS(curves), nframes);
+  g_print("exact: %8.3f us/frame, %5.2f%% of a frame at %gx slowdown\n",
+          t_exact * 1e6 / nframes,
+          t_exact * 1e6 / nframes * slowdown / FRAME_US * 100, slowdown);
+  g_print("baked: %8.3f us/frame, %5.2f%% of a frame at %gx slowdown"
+          " (%.3f ms to bake)\n",
+          t_baked * 1e6 / nframes,
+          t_baked * 1e6 / nframes * slowdown / FRAME_US * 100, slowdown,
+          t_bake * 1e3);
+  if (bad)
+    g_print("CURVES DIFFER\n");
+
+  g_timer_destroy(timer);
+  return bad;
+}
@@ -0,0 +1,129 @@
+/* Micro-benchmark for hd-occlusion.c: generates synthetic window stacks
+ * (fullscreen apps with dialogs, menus and notes on top of them) and
+ * compares answering "is this window covered" for every window with
+ * the old cairo_region-per-window linear scan and with HdOcclusion.
+ *
+ * Usage: test-occlusion-bench [n-windows] [rounds] */
+#include <stdlib.h>
+#include <glib.h>
+#include <cairo.h>
+
+#include "util/hd-occlusion.h"
+
+#define SCREEN_W 800
+#define SCREEN_H 480
+
+static cairo_rectangle_int_t *make_stack(guint n)
+{
+  cairo_rectangle_int_t *stack;
+  guint i;
+
+  /* stack[0] is the bottom */
+  stack = g_new(cairo_rectangle_int_t, n);
+  for (i = 0; i < n; i++)
+    switch (g_random_int_range(0, 4))
+      {
+        case 0: /* app */
+          stack[i].x = 0;
+          stack[i].y = 56;
+          stack[i].width = SCREEN_W;
+          stack[i].height = SCREEN_H - 56;
+          break;
+        case 1: /* dialog */
+          stack[i].height = g_random_int_range(100, SCREEN_H - 56);
+          stack[i].x = 0;
+          stack[i].y = SCREEN_H - stack[i].height;
+          stack[i].width = SCREEN_W;
+          break;
+        case 2: /* menu */
+          stack[i].width = g_random_int_range(200, 600);
+          stack[i].height = g_random_int_range(50, 300);
+          stack[i].x = (SCREEN_W - stack[i].width) / 2;
+          stack[i].y = 0;
+          break;
+        default: /* note */
+          stack[i].x = g_random_int_range(0, SCREEN_W - 100);
+          stack[i].y = g_random_int_range(0, SCREEN_H - 50);
+          stack[i].width = g_random_int_range(50, SCREEN_W - stack[i].x);
+          stack[i].height = g_random_int_range(20, SCREEN_H - stack[i].y);
+          break;
+      }
+
+  return stack;
+}
+
+/* What hd_util_client_obscured() used to do. */
+static gboolean linear_obscured(const cairo_rectangle_int_t *stack,
+                                guint n, guint idx)
+{
+  cairo_region_t *region;
+  gboolean empty;
+  guint i;
+
+  region = cairo_region_create_rectangle(&stack[idx]);
+  for (i = idx+1; i < n && !cairo_region_is_empty(region); i++)
+    {
+      cairo_region_t *obscure_region;
+
+      obscure_region = cairo_region_create_rectangle(&stack[i]);
+      cairo_region_subtract(region, obscure_region);
+      cairo_region_destroy(obscure_region);
+    }
+
+  empty = cairo_region_is_empty(region);
+  cairo_region_destroy(region);
+  return empty;
+}
+
+int main(int argc, char *argv[])
+{
+  guint n, rounds, i, r, ncovered, mismatches;
+  cairo_rectangle_int_t *stack;
+  HdOcclusion *occ;
+  GTimer *timer;
+  gdouble t_linear, t_index;
+
+  n = argc > 1 ? atoi(argv[1]) : 30;
+  rounds = argc > 2 ? atoi(argv[2]) : 1000;
+  stack = make_stack(n);
+  occ = hd_occlusion_new();
+  timer = g_timer_new();
+
+  /* A restack asks about every window. */
+  ncovered = 0;
+  g_timer_start(timer);
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < n; i++)
+      ncovered += linear_obscured(stack, n, i);
+  t_linear = g_timer_elapsed(timer, NULL);
+
+  g_timer_start(timer);
+  for (r = 0; r < rounds; r++)
+    {
+      hd_occlusion_reset(occ);
+      for (i = n; i-- > 0; )
+        hd_occlusion_push(occ, &stack[i], &stack[i]);
+      for (i = 0; i < n; i++)
+        hd_occlusion_lookup(occ, &stack[i], &stack[i]);
+    }
+  t_index = g_timer_elapsed(timer, NULL);
+
+  mismatches = 0;
+  for (i = 0; i < n; i++)
+    if (linear_obscured(stack, n, i)
+        != (hd_occlusion_lookup(occ, &stack[i], &stack[i])
+            == HD_OCCLUSION_COVERED))
+      mismatches++;
+
+  g_print("%u windows, %u covered, %u restacks\n",
+          n, ncovered / rounds, rounds);
+  g_print("linear scan: %8.3f us/restack\n", t_linear  * 1e6 / rounds);
+  g_print("index:       %8.3f us/restack\n", t_index   * 1e6 / rounds);
+  if (mismatches)
+    g_print("%u MISMATCHES\n", mismatches);
+
+  g_timer_destroy(timer);
+  hd_occlusion_free(occ);
+  g_free(stack);
+  return mismatches != 0;
+}
@@ -0,0 +1,287 @@
+/* Stand-in for a camera/video-style HildonRemoteTexture client, to see
+ * what frame rate it can reach through hildon-desktop.
+ *
+ * Usage: test-remote-texture [buffers [seconds [width height]]]
+ *
+ * With 2 buffers it uses the buffered protocol: each frame is
+ * written into a buffer hildon-desktop has released, then presented.
+ * With 1 (or if hildon-desktop doesn't answer) it writes into the single
+ * buffer and sends damage, like HildonRemoteTexture does. */
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define MAX_BUFFERS 2
+#define BPP         4
+
+static Atom shm_atom, damage_atom, show_atom, position_atom, parent_atom;
+static Atom buffers_atom, present_atom, release_atom, ready_atom;
+
+static double now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void send_message (Display *dpy, Window w, Atom type,
+                          long l0, long l1, long l2, long l3, long l4)
+{
+  XClientMessageEvent xclient;
+
+  memset (&xclient, 0, sizeof (xclient));
+  xclient.type = ClientMessage;
+  xclient.window = w;
+  xclient.message_type = type;
+  xclient.format = 32;
+  xclient.data.l[0] = l0;
+  xclient.data.l[1] = l1;
+  xclient.data.l[2] = l2;
+  xclient.data.l[3] = l3;
+  xclient.data.l[4] = l4;
+
+  XSendEvent (dpy, w, False, StructureNotifyMask, (XEvent *)&xclient);
+}
+
+static void set_window_type (Display *dpy, Window w, const char *type)
+{
+  Atom w_type, atom;
+
+  w_type = XInternAtom (dpy, "_NET_WM_WINDOW_TYPE", False);
+  atom = XInternAtom (dpy, type, False);
+
+  XChangeProperty (dpy, w, w_type,
+                   XA_ATOM, 32, PropModeReplace,
+                   (unsigned char *) &atom, 1);
+}
+
+/* Wait until hildon-desktop has set up the texture window. */
+static void wait_ready (Display *dpy, Window w)
+{
+  for (;;)
+    {
+      Atom type;
+      int format;
+      unsigned long nitems, left;
+      unsigned char *data = NULL;
+      XEvent ev;
+
+      if (XGetWindowProperty (dpy, w, ready_atom, 0, 1, False,
+                              XA_ATOM, &type, &format, &nitems, &left,
+                              &data) == Success && data)
+        {
+          XFree (data);
+          if (nitems)
+            return;
+        }
+      XWindowEvent (dpy, w, PropertyChangeMask, &ev);
+    }
+}
+
+/* Returns the buffer released by the next RELEASE message, or -1 if
+ * there was none within @timeout seconds. */
+static int wait_release (Display *dpy, Window w, double timeout)
+{
+  double until = now () + timeout;
+
+  for (;;)
+    {
+      XEvent ev;
+
+      while (XCheckTypedWindowEvent (dpy, w, ClientMessage, &ev))
+        if (ev.xclient.message_type == release_atom)
+          return ev.xclient.data.l[0];
+
+      if (now () > until)
+        return -1;
+
+      /* Sleep until the X connection is readable. */
+      {
+        fd_set fds;
+        struct timeval tv = { 0, 10000 };
+
+        FD_ZERO (&fds);
+        FD_SET (ConnectionNumber (dpy), &fds);
+        select (ConnectionNumber (dpy) + 1, &fds, NULL, NULL, &tv);
+        XEventsQueued (dpy, QueuedAfterReading);
+      }
+    }
+}
+
+/* A bar sweeping across, so tearing is easy to see. */
+static void draw_frame (unsigned char *pixels, int width, int height,
+                        unsigned frame)
+{
+  int x, y, bar;
+
+  bar = (frame * 8) % width;
+  for (y = 0; y < height; y++)
+    {
+      unsigned *row = (unsigned *)(pixels + y * width * BPP);
+
+      for (x = 0; x < width; x++)
+        row[x] = x >= bar && x < bar + 32 ? 0xffffffff : 0xff000000 | frame;
+    }
+}
+
+int main (int argc, char **argv)
+{
+  Display *dpy;
+  Window app, tex;
+  int nbuffers, seconds, width, height, shmid, i;
+  key_t key;
+  int free_buffers[MAX_BUFFERS], nfree;
+  unsigned char *shm;
+  size_t frame_size;
+  unsigned frames, frames_this_second;
+  double start, second, waited;
+
+  nbuffers = argc > 1 ? atoi (argv[1]) : 2;
+  seconds  = argc > 2 ? atoi (argv[2]) : 10;
+  width    = argc > 4 ? atoi (argv[3]) : 800;
+  height   = argc > 4 ? atoi (argv[4]) : 480;
+  if (nbuffers < 1 || nbuffers > MAX_BUFFERS)
+    {
+      fprintf (stderr, "%s: buffers must be 1..%d\n", argv[0], MAX_BUFFERS);
+      return 1;
+    }
+
+  if (!(dpy = XOpenDisplay (NULL)))
+    {
+      fprintf (stderr, "%s: can't open display\n", argv[0]);
+      return 1;
+    }
+
+  shm_atom      = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_SHM", False);
+  damage_atom   = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_DAMAGE", False);
+  show_atom     = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_SHOW", False);
+  position_atom = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_POSITION", False);
+  parent_atom   = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_PARENT", False);
+  buffers_atom  = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_BUFFERS", False);
+  present_atom  = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_PRESENT", False);
+  release_atom  = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_MESSAGE_RELEASE", False);
+  ready_atom    = XInternAtom (dpy, "_HILDON_TEXTURE_CLIENT_READY", False);
+
+  /* The application window the texture is shown in. */
+  app = XCreateSimpleWindow (dpy, DefaultRootWindow (dpy), 0, 0,
+                             width, height, 0, 0,
+                             BlackPixel (dpy, DefaultScreen (dpy)));
+  XStoreName (dpy, app, "test-remote-texture");
+  set_window_type (dpy, app, "_NET_WM_WINDOW_TYPE_NORMAL");
+  XMapWindow (dpy, app);
+
+  tex = XCreateSimpleWindow (dpy, DefaultRootWindow (dpy), 0, 0,
+                             width, height, 0, 0, 0);
+  XSelectInput (dpy, tex, PropertyChangeMask);
+  set_window_type (dpy, tex, "_HILDON_WM_WINDOW_TYPE_REMOTE_TEXTURE");
+  XMapWindow (dpy, tex);
+  wait_ready (dpy, tex);
+
+  frame_size = (size_t)width * height * BPP;
+  key = 0x48440000 | (getpid () & 0xffff);
+  if ((shmid = shmget (key, frame_size * nbuffers,
+                       IPC_CREAT | IPC_EXCL | 0666)) < 0
+      || (shm = shmat (shmid, NULL, 0)) == (void *)-1)
+    {
+      perror ("shm");
+      return 1;
+    }
+
+  /* Ask for the buffered protocol; it's accepted by releasing
+   * all the buffers. */
+  nfree = 0;
+  if (nbuffers > 1)
+    {
+      send_message (dpy, tex, buffers_atom, key, width, height, BPP,
+                    nbuffers);
+      while (nfree < nbuffers
+             && (i = wait_release (dpy, tex, 1)) >= 0)
+        free_buffers[nfree++] = i;
+      if (!nfree)
+        {
+          printf ("buffered protocol not supported, using one buffer\n");
+          nbuffers = 1;
+        }
+    }
+  if (nbuffers == 1)
+    send_message (dpy, tex, shm_atom, key, width, height, BPP, 0);
+
+  send_message (dpy, tex, parent_atom, app, 0, 0, 0, 0);
+  send_message (dpy, tex, position_atom, 0, 0, width, height, 0);
+  send_message (dpy, tex, show_atom, 1, 255, 0, 0, 0);
+  XFlush (dpy);
+
+  printf ("%d buffer(s) of %dx%d for %d seconds\n",
+          nbuffers, width, height, seconds);
+  frames = frames_this_second = 0;
+  waited = 0;
+  start = second = now ();
+  while (now () < start + seconds)
+    {
+      int buffer;
+
+      if (nbuffers > 1)
+        {
+          double t;
+
+          /* Take what was released meanwhile, wait if there's nothing. */
+          t = now ();
+          while (!nfree || XPending (dpy))
+            {
+              if ((buffer = wait_release (dpy, tex, nfree ? 0 : 1)) < 0)
+                break;
+              free_buffers[nfree++] = buffer;
+            }
+          waited += now () - t;
+          if (!nfree)
+            {
+              fprintf (stderr, "no buffer released in a second\n");
+              break;
+            }
+
+          buffer = free_buffers[--nfree];
+          draw_frame (shm + buffer * frame_size, width, height, frames);
+          send_message (dpy, tex, present_atom, buffer, frames,
+                        0, (width << 16) | height, 0);
+        }
+      else
+        {
+          draw_frame (shm, width, height, frames);
+          send_message (dpy, tex, damage_atom, 0, 0, width, height, 0);
+          XSync (dpy, False);
+        }
+      XFlush (dpy);
+
+      frames++;
+      frames_this_second++;
+      if (now () - second >= 1)
+        {
+          printf ("%u frames/s\n", frames_this_second);
+          frames_this_second = 0;
+          second = now ();
+        }
+    }
+
+  printf ("%u frames in %.1f s: %.1f frames/s, %.1f ms/frame waiting "
+          "for buffers\n", frames, now () - start,
+          frames / (now () - start), frames ? waited * 1000 / frames : 0);
+
+  send_message (dpy, tex, show_atom, 0, 0, 0, 0, 0);
+  XDestroyWindow (dpy, tex);
+  XDestroyWindow (dpy, app);
+  XCloseDisplay (dpy);
+  shmdt (shm);
+  shmctl (shmid, IPC_RMID, NULL);
+
+  return 0;
+}
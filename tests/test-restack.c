@@ -0,0 +1,176 @@
+/* Checks hd-restack.c on a fake group of actors: whatever the old and
+ * the new stacking, the group ends up in the new one, and the usual
+ * changes of the window stack, like raising one window or mapping a
+ * dialog, cost a move or two instead of raising every window like
+ * hd_render_manager_restack() used to.
+ *
+ * Usage: test-restack [n-windows] */
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "util/hd-restack.h"
+
+#include "test-check.h"
+
+/* HdRestackMoveFunc for a GPtrArray of children from the bottom up. */
+static void move(gpointer child, gpointer below, gpointer group)
+{
+  GPtrArray *children = group;
+  guint i;
+
+  g_ptr_array_remove(children, child);
+  g_ptr_array_add(children, NULL);
+  for (i = children->len-1; i > 0 && children->pdata[i-1] != below; i--)
+    children->pdata[i] = children->pdata[i-1];
+  children->pdata[i] = child;
+}
+
+/* Reorders @group to @want and returns the number of moves, or -1 if
+ * it didn't get there. */
+static gint reorder(GPtrArray *group, GPtrArray *want)
+{
+  GPtrArray *have;
+  guint n;
+
+  have = g_ptr_array_sized_new(group->len);
+  for (n = 0; n < group->len; n++)
+    g_ptr_array_add(have, group->pdata[n]);
+  n = hd_restack_reorder(have->pdata, want->pdata, want->len, move, group);
+  g_ptr_array_free(have, TRUE);
+
+  return memcmp(group->pdata, want->pdata, want->len * sizeof(gpointer))
+    ? -1 : (gint)n;
+}
+
+static GPtrArray *make_stack(guint n)
+{
+  GPtrArray *stack;
+  guint i;
+
+  stack = g_ptr_array_sized_new(n);
+  for (i = 0; i < n; i++)
+    g_ptr_array_add(stack, GUINT_TO_POINTER(i + 1));
+  return stack;
+}
+
+static GPtrArray *copy_stack(GPtrArray *stack)
+{
+  GPtrArray *copy;
+  guint i;
+
+  copy = g_ptr_array_sized_new(stack->len);
+  for (i = 0; i < stack->len; i++)
+    g_ptr_array_add(copy, stack->pdata[i]);
+  return copy;
+}
+
+static void test_random(void)
+{
+  guint round, i, n;
+  gint moves;
+  gboolean ok;
+
+  ok = TRUE;
+  for (round = 0; round < 1000 && ok; round++)
+    {
+      GPtrArray *group, *want;
+
+      n = g_random_int_range(0, 20);
+      group = make_stack(n);
+      want = copy_stack(group);
+      for (i = n; i > 1; i--)
+        {
+          guint j = g_random_int_range(0, i);
+          gpointer tmp = want->pdata[i-1];
+
+          want->pdata[i-1] = want->pdata[j];
+          want->pdata[j] = tmp;
+        }
+      moves = reorder(group, want);
+      ok = moves >= 0 && moves < (gint)MAX(n, 1);
+      g_ptr_array_free(want, TRUE);
+      g_ptr_array_free(group, TRUE);
+    }
+  check(ok, "random stackings are reached");
+}
+
+/* Applies the change of @want to @group and checks it took @expected
+ * moves, where hd_render_manager_restack() used to take @n. */
+static void scenario(GPtrArray *group, GPtrArray *want, gint expected,
+                     const gchar *what)
+{
+  gchar *msg;
+  gint moves;
+
+  moves = reorder(group, want);
+  g_print("      %s: %d moves instead of %u\n", what, moves, want->len);
+  msg = g_strdup_printf("%s in %d moves", what, expected);
+  check(moves == expected, msg);
+  g_free(msg);
+}
+
+static void test_window_stack(guint n)
+{
+  GPtrArray *group, *want;
+  gpointer dialog;
+
+  group = make_stack(n);
+
+  want = copy_stack(group);
+  scenario(group, want, 0, "nothing changed");
+  g_ptr_array_free(want, TRUE);
+
+  /* The user switches to an app in the middle of the stack. */
+  want = copy_stack(group);
+  g_ptr_array_remove(want, group->pdata[n / 2]);
+  g_ptr_array_add(want, group->pdata[n / 2]);
+  scenario(group, want, 1, "raising one window");
+  g_ptr_array_free(want, TRUE);
+
+  /* The one at the bottom, which moves everything else relatively. */
+  want = copy_stack(group);
+  g_ptr_array_remove(want, group->pdata[0]);
+  g_ptr_array_add(want, group->pdata[0]);
+  scenario(group, want, 1, "raising the bottom window");
+  g_ptr_array_free(want, TRUE);
+
+  /* A dialog is mapped; the new actor was added to the top. */
+  dialog = GUINT_TO_POINTER(n + 1);
+  g_ptr_array_add(group, dialog);
+  want = copy_stack(group);
+  scenario(group, want, 0, "mapping a dialog");
+  g_ptr_array_free(want, TRUE);
+
+  /* Its parent is raised to just below it. */
+  want = copy_stack(group);
+  g_ptr_array_remove(want, group->pdata[1]);
+  g_ptr_array_remove_index(want, want->len-1);
+  g_ptr_array_add(want, group->pdata[1]);
+  g_ptr_array_add(want, dialog);
+  scenario(group, want, 1, "raising the dialog's parent");
+  g_ptr_array_free(want, TRUE);
+
+  /* blur_front goes from the top to just below the dialog. */
+  want = copy_stack(group);
+  g_ptr_array_remove(want, group->pdata[2]);
+  g_ptr_array_remove(want, dialog);
+  g_ptr_array_add(want, group->pdata[2]);
+  g_ptr_array_add(want, dialog);
+  scenario(group, want, 1, "moving one below the top");
+  g_ptr_array_free(want, TRUE);
+
+  g_ptr_array_free(group, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+  guint n;
+
+  n = argc > 1 ? atoi(argv[1]) : 100;
+
+  test_random();
+  test_window_stack(MAX(n, 4));
+
+  return check_summary();
+}
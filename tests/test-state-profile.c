@@ -0,0 +1,114 @@
+/* Checks the sums of hd-state-profile.c on a made up sequence of state
+ * changes, where the blur of one is still running when the next one
+ * begins and spans nest, and prints the report.
+ *
+ * Usage: test-state-profile */
+#include <string.h>
+#include <glib.h>
+
+#include "util/hd-state-profile.h"
+
+#include "test-check.h"
+
+enum { HOME = 1, APP = 2, TASK_NAV = 4 };
+
+static const gchar *name(guint state)
+{
+  return state == HOME ? "HOME" : state == APP ? "APP" : "TASK_NAV";
+}
+
+/* A state change taking @took ms in set_state() and @blur ms of blur
+ * in @frames frames, starting at @now. */
+static void change(HdStateProfile *prof, guint from, guint to,
+                   gdouble now, gdouble took, gdouble blur, guint frames)
+{
+  guint i;
+
+  hd_state_profile_begin(prof, from, to);
+  hd_state_profile_start(prof, HD_STATE_SPAN_SET_STATE, now);
+  hd_state_profile_start(prof, HD_STATE_SPAN_BLUR, now + 1);
+  hd_state_profile_background(prof, HD_STATE_SPAN_BLUR, now + 1);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SET_STATE, now + took);
+  for (i = 0; i < frames; i++)
+    hd_state_profile_frame(prof, HD_STATE_SPAN_BLUR);
+  hd_state_profile_end(prof, HD_STATE_SPAN_BLUR, now + 1 + blur);
+}
+
+int main(int argc, char **argv)
+{
+  HdStateProfile *prof;
+  gchar *report, *line;
+
+  prof = hd_state_profile_new();
+  change(prof, HOME, TASK_NAV, 0, 10, 250, 15);
+  change(prof, TASK_NAV, APP, 1000, 5, 250, 15);
+  change(prof, HOME, TASK_NAV, 2000, 30, 350, 5);
+
+  /* The blur of APP -> HOME is cut short by HOME -> TASK_NAV. */
+  hd_state_profile_begin(prof, APP, HOME);
+  hd_state_profile_start(prof, HD_STATE_SPAN_BLUR, 3000);
+  hd_state_profile_begin(prof, HOME, TASK_NAV);
+  hd_state_profile_cancel(prof, HD_STATE_SPAN_BLUR, 3050);
+  hd_state_profile_end(prof, HD_STATE_SPAN_BLUR, 3100);
+  check(!hd_state_profile_is_running(prof, HD_STATE_SPAN_BLUR),
+        "a cancelled span isn't running");
+
+  /* A span started in APP -> HOME and ended after the next begin. */
+  hd_state_profile_begin(prof, APP, HOME);
+  hd_state_profile_start(prof, HD_STATE_SPAN_STACKING, 4000);
+  hd_state_profile_begin(prof, HOME, APP);
+  hd_state_profile_end(prof, HD_STATE_SPAN_STACKING, 4007);
+
+  /* Nested spans take their time from the outer one, and the blur
+   * only counts while nothing else runs.  What follows the blur belongs
+   * to TASK_NAV -> HOME even though HOME -> APP began meanwhile. */
+  hd_state_profile_begin(prof, TASK_NAV, HOME);
+  hd_state_profile_start(prof, HD_STATE_SPAN_SET_STATE, 5000);
+  hd_state_profile_start(prof, HD_STATE_SPAN_SYNC_BEFORE, 5002);
+  hd_state_profile_start(prof, HD_STATE_SPAN_SYNC_AFTER, 5004);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SYNC_AFTER, 5008);
+  hd_state_profile_start(prof, HD_STATE_SPAN_BLUR, 5009);
+  hd_state_profile_background(prof, HD_STATE_SPAN_BLUR, 5010);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SYNC_BEFORE, 5012);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SET_STATE, 5013);
+  hd_state_profile_begin(prof, HOME, APP);
+  hd_state_profile_start(prof, HD_STATE_SPAN_SET_STATE, 5100);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SET_STATE, 5150);
+  hd_state_profile_start_as(prof, HD_STATE_SPAN_SYNC_AFTER,
+                            HD_STATE_SPAN_BLUR, 5300);
+  hd_state_profile_end(prof, HD_STATE_SPAN_BLUR, 5300);
+  hd_state_profile_end(prof, HD_STATE_SPAN_SYNC_AFTER, 5320);
+  hd_state_profile_start_as(prof, HD_STATE_SPAN_SYNC_AFTER,
+                            HD_STATE_SPAN_BLUR, 5400);
+  check(!hd_state_profile_is_running(prof, HD_STATE_SPAN_SYNC_AFTER),
+        "nothing to start as if the blur isn't running");
+
+  report = hd_state_profile_get_report(prof, name);
+  g_print("%s", report);
+
+  line = strstr(report, "HOME -> TASK_NAV");
+  check(line == strstr(report, "\n") + 1, "the slowest change first");
+  check(line && g_str_has_prefix(line + 36, "     3    20.0/   30.0"),
+        "HOME -> TASK_NAV: 3 changes, 20 ms on average, at most 30");
+  check(line && strstr(line, "  10.0 blur frames"),
+        "10 blur frames on average");
+  line = strstr(report, "APP -> HOME");
+  check(line && strstr(line, "7.0/    7.0"),
+        "a span counts for the change it started in");
+  check(strstr(report, "HOME -> APP") != NULL, "changes with nothing timed");
+  line = strstr(report, "TASK_NAV -> HOME");
+  /* set_state 2+1, before 2+1+2, blur 1+87+150, after 4 and 20 */
+  check(line && g_str_has_prefix(line + 36,
+                                 "     1     3.0/    3.0     5.0/    5.0"),
+        "the self time of set_state() and sync_clutter_before()");
+  check(line && strstr(line, "238.0/  238.0    12.0/   20.0"),
+        "the blur counts in the background, the after of the blur is its");
+  line = strstr(report, "HOME -> APP");
+  check(line && g_str_has_prefix(line + 36, "     2    50.0/   50.0"),
+        "HOME -> APP: only set_state() timed");
+
+  g_free(report);
+  hd_state_profile_free(prof);
+
+  return check_summary();
+}
@@ -0,0 +1,177 @@
+/* Checks tidy-target-pool.c: targets given back are handed out again
+ * for the same size and format, idle ones are freed least recently
+ * released first when over the budget and leased ones never are, and
+ * sizes without targets are forgotten.
+ * Then counts the allocations of going between the blurred and the
+ * unblurred home and rotating, with and without keeping targets.
+ *
+ * Usage: test-target-pool */
+#include <glib.h>
+
+#include "tidy/tidy-target-pool.h"
+
+#include "test-check.h"
+
+/* Targets made and freed by the pool. */
+static guint created, destroyed;
+
+/* Fails for empty targets. */
+static gboolean create(TidyTarget *target, gpointer unused)
+{
+  if (!target->width)
+    return FALSE;
+  target->texture = GUINT_TO_POINTER(++created);
+  target->fb = target->texture;
+  target->bytes = target->width * target->height * 4;
+  return TRUE;
+}
+
+static void destroy(TidyTarget *target, gpointer unused)
+{
+  destroyed++;
+}
+
+static void test_reuse(void)
+{
+  TidyTargetPool *pool;
+  TidyTargetPoolStats stats;
+  TidyTarget *a, *b, *c;
+
+  created = destroyed = 0;
+  pool = tidy_target_pool_new(1 << 20, create, destroy, NULL);
+
+  a = tidy_target_pool_lease(pool, 100, 100, 1);
+  tidy_target_pool_release(pool, a);
+  b = tidy_target_pool_lease(pool, 100, 100, 1);
+  check(a == b && created == 1, "a released target is leased again");
+
+  c = tidy_target_pool_lease(pool, 100, 100, 1);
+  check(c != b && created == 2, "a leased one is not");
+  tidy_target_pool_release(pool, c);
+
+  a = tidy_target_pool_lease(pool, 100, 100, 2);
+  check(a != c && created == 3, "another format is another target");
+  tidy_target_pool_release(pool, a);
+  a = tidy_target_pool_lease(pool, 100, 50, 1);
+  check(a != c && created == 4, "another size is another target");
+
+  tidy_target_pool_get_stats(pool, &stats);
+  check(stats.hits == 1 && stats.misses == 4, "1 hit, 4 misses");
+  check(stats.leased == 2 && stats.idle == 2
+        && stats.bytes_leased == 60000 && stats.bytes_idle == 80000,
+        "2 leased and 2 idle");
+
+  check(!tidy_target_pool_lease(pool, 0, 100, 1), "create() can fail");
+  tidy_target_pool_get_stats(pool, &stats);
+  check(stats.slots == 3, "no slot is left for a failed target");
+
+  tidy_target_pool_release(pool, a);
+  tidy_target_pool_release(pool, b);
+  tidy_target_pool_free(pool);
+  check(destroyed == created, "everything freed with the pool");
+}
+
+static void test_budget(void)
+{
+  TidyTargetPool *pool;
+  TidyTargetPoolStats stats;
+  TidyTarget *a, *b, *c, *d;
+
+  created = destroyed = 0;
+  /* Room for two 100x100 targets. */
+  pool = tidy_target_pool_new(80000, create, destroy, NULL);
+
+  a = tidy_target_pool_lease(pool, 100, 100, 1);
+  b = tidy_target_pool_lease(pool, 100, 100, 2);
+  c = tidy_target_pool_lease(pool, 100, 100, 3);
+  check(destroyed == 0, "leased targets are kept over the budget");
+
+  tidy_target_pool_release(pool, a);
+  check(destroyed == 1, "an idle one is freed over the budget");
+  tidy_target_pool_release(pool, b);
+  tidy_target_pool_release(pool, c);
+  check(destroyed == 1, "idle ones are kept within the budget");
+
+  d = tidy_target_pool_lease(pool, 100, 100, 2);
+  check(d == b, "b is still there");
+  tidy_target_pool_release(pool, d);
+
+  /* c is the least recently released now. */
+  tidy_target_pool_set_budget(pool, 40000);
+  d = tidy_target_pool_lease(pool, 100, 100, 2);
+  check(d == b && destroyed == 2, "c went first");
+
+  tidy_target_pool_get_stats(pool, &stats);
+  check(stats.evictions == 2, "2 evictions");
+  check(stats.slots == 1, "the slots of the evicted ones are freed");
+
+  tidy_target_pool_release(pool, d);
+  tidy_target_pool_free(pool);
+  check(destroyed == created, "everything freed with the pool");
+}
+
+/* What TidyBlurEffect leases: two half size textures and the levels
+ * of the pyramid down to 8 pixels. */
+static guint blur(TidyTargetPool *pool, guint width, guint height,
+                  TidyTarget **leased)
+{
+  guint n, i;
+
+  n = 0;
+  for (width /= 2, height /= 2; width >= 8 && height >= 8 && n < 12;
+       width /= 2, height /= 2)
+    for (i = 0; i < 2; i++)
+      leased[n++] = tidy_target_pool_lease(pool, width, height, 1);
+  return n;
+}
+
+static void unblur(TidyTargetPool *pool, TidyTarget **leased, guint n)
+{
+  while (n--)
+    tidy_target_pool_release(pool, leased[n]);
+}
+
+static guint home_and_back(gsize budget)
+{
+  TidyTargetPool *pool;
+  TidyTarget *leased[12], *cache;
+  guint round, n;
+
+  created = destroyed = 0;
+  pool = tidy_target_pool_new(budget, create, destroy, NULL);
+  for (round = 0; round < 10; round++)
+    {
+      guint width = round % 2 ? 480 : 800, height = round % 2 ? 800 : 480;
+
+      /* to the switcher and back */
+      n = blur(pool, width, height, leased);
+      unblur(pool, leased, n);
+
+      /* rotate: the render manager caches the screen meanwhile */
+      cache = tidy_target_pool_lease(pool, width / 2, height / 2, 2);
+      tidy_target_pool_release(pool, cache);
+    }
+  tidy_target_pool_free(pool);
+
+  return created;
+}
+
+static void test_home_and_back(void)
+{
+  guint without, with;
+
+  without = home_and_back(0);
+  with = home_and_back(4096 * 1024);
+  g_print("      switcher and rotation 10 times: %u targets made "
+          "without keeping them, %u with 4 MB\n", without, with);
+  check(with * 5 <= without, "at most a fifth of the allocations");
+}
+
+int main(int argc, char **argv)
+{
+  test_reuse();
+  test_budget();
+  test_home_and_back();
+
+  return check_summary();
+}
@@ -0,0 +1,150 @@
+/* Checks the decisions of hd-unredirect.c on synthetic timelines:
+ * a game updating steadily gets unredirected after the sustain time,
+ * a clock updating once a second never does, and a note popping up
+ * over the game every now and then doesn't make us switch back and
+ * forth on every frame.
+ *
+ * Usage: test-unredirect */
+#include <glib.h>
+
+#include "util/hd-unredirect.h"
+
+#include "test-check.h"
+
+#define MIN_FPS     20
+#define SUSTAIN_MS  2000
+#define COOLDOWN_MS 3000
+
+/* Damages the candidate every @period ms from @start until @end or
+ * until the policy says yes.  Returns when that happened or -1. */
+static gint64 run(HdUnredirect *unr, gint64 start, gint64 end, guint period)
+{
+  gint64 now;
+
+  for (now = start; now < end; now += period)
+    if (hd_unredirect_damage(unr, now))
+      return now;
+  return -1;
+}
+
+static HdUnredirect *new_policy(gconstpointer candidate)
+{
+  HdUnredirect *unr;
+
+  unr = hd_unredirect_new();
+  hd_unredirect_configure(unr, MIN_FPS, SUSTAIN_MS, COOLDOWN_MS);
+  hd_unredirect_set_composited(unr, TRUE, FALSE, 1);
+  hd_unredirect_set_candidate(unr, candidate);
+  return unr;
+}
+
+static void test_steady(void)
+{
+  static const int game = 0;
+  HdUnredirect *unr;
+  gint64 at;
+
+  unr = new_policy(&game);
+  at = run(unr, 1, 10000, 33);
+  check(at >= SUSTAIN_MS && at < SUSTAIN_MS + 100,
+        "30 fps is unredirected after the sustain time");
+  hd_unredirect_free(unr);
+
+  unr = new_policy(&game);
+  check(run(unr, 1, 10000, 1000) < 0, "1 fps is never unredirected");
+  hd_unredirect_free(unr);
+
+  unr = new_policy(NULL);
+  check(run(unr, 1, 10000, 16) < 0, "nothing without a candidate");
+  hd_unredirect_free(unr);
+}
+
+static void test_candidate_change(void)
+{
+  static const int game = 0, other = 0;
+  HdUnredirect *unr;
+  gint64 at;
+
+  unr = new_policy(&game);
+  check(run(unr, 1, SUSTAIN_MS / 2, 33) < 0, "not yet");
+  hd_unredirect_set_candidate(unr, &other);
+  at = run(unr, SUSTAIN_MS / 2, 10000, 33);
+  check(at >= SUSTAIN_MS / 2 + SUSTAIN_MS,
+        "a new candidate starts over");
+  hd_unredirect_free(unr);
+}
+
+/* A note shows up over the game for 300 ms every second. */
+static void test_flapping(void)
+{
+  static const int game = 0;
+  HdUnredirectStats stats;
+  HdUnredirect *unr;
+  gboolean composited, covered;
+  gint64 now;
+
+  unr = new_policy(&game);
+  composited = TRUE;
+  for (now = 1; now < 60000; now += 10)
+    {
+      covered = now % 1000 < 300;
+      if (covered && !composited)
+        {
+          hd_unredirect_set_composited(unr, TRUE, FALSE, now);
+          composited = TRUE;
+        }
+      hd_unredirect_set_candidate(unr, covered ? NULL : &game);
+      if (composited && now % 30 < 10 && hd_unredirect_damage(unr, now))
+        {
+          hd_unredirect_set_composited(unr, FALSE, TRUE, now);
+          composited = FALSE;
+        }
+    }
+
+  hd_unredirect_get_stats(unr, now, &stats);
+  g_print("      flapping note: %u unredirects, %u redirects, "
+          "%.1f s composited, %.1f s unredirected\n",
+          stats.unredirects, stats.redirects,
+          stats.composited_ms / 1000.0, stats.unredirected_ms / 1000.0);
+  /* The note is gone for 700 ms at a time only, less than the sustain
+   * time, so the game is never unredirected. */
+  check(stats.unredirects == 0, "no unredirection between notes");
+  hd_unredirect_free(unr);
+}
+
+/* The game is covered once and then left alone. */
+static void test_cooldown(void)
+{
+  static const int game = 0;
+  HdUnredirectStats stats;
+  HdUnredirect *unr;
+  gint64 at, covered_at;
+
+  unr = new_policy(&game);
+  at = run(unr, 1, 10000, 33);
+  hd_unredirect_set_composited(unr, FALSE, TRUE, at);
+
+  covered_at = at + 5000;
+  hd_unredirect_set_composited(unr, TRUE, FALSE, covered_at);
+  hd_unredirect_set_candidate(unr, NULL);
+  hd_unredirect_set_candidate(unr, &game);
+  at = run(unr, covered_at + 100, covered_at + 20000, 33);
+  check(at >= covered_at + COOLDOWN_MS + SUSTAIN_MS,
+        "unredirected again only after the cooldown and sustain time");
+
+  hd_unredirect_get_stats(unr, at, &stats);
+  check(stats.unredirects == 1 && stats.redirects == 1,
+        "one unredirection undone");
+  check(stats.unredirected_ms == 5000, "5 s spent unredirected");
+  hd_unredirect_free(unr);
+}
+
+int main(int argc, char **argv)
+{
+  test_steady();
+  test_candidate_change();
+  test_flapping();
+  test_cooldown();
+
+  return check_summary();
+}
@@ -0,0 +1,134 @@
+/* Checks tidy-upload-schedule.c on a made up texture of tiles: runs
+ * of adjacent dirty tiles are uploaded as a whole within the budget,
+ * and a client damaging the top of the texture on every frame doesn't
+ * keep the bottom from being uploaded.
+ *
+ * Usage: test-upload-schedule */
+#include <glib.h>
+
+#include "tidy/tidy-upload-schedule.h"
+
+#include "test-check.h"
+
+#define TILES_X   3
+#define TILES_Y   6
+#define TILE_COST 100
+
+static gboolean dirty[TILES_X * TILES_Y];
+/* The frame each tile was last uploaded in. */
+static gint uploaded_in[TILES_X * TILES_Y];
+static gint frame;
+
+static gsize cost(gint tile, gpointer unused)
+{
+  return dirty[tile] ? TILE_COST : 0;
+}
+
+static void upload(gint tile, gpointer unused)
+{
+  dirty[tile] = FALSE;
+  uploaded_in[tile] = frame;
+}
+
+static void damage_all(void)
+{
+  gint i;
+
+  for (i = 0; i < TILES_X * TILES_Y; i++)
+    {
+      dirty[i] = TRUE;
+      uploaded_in[i] = -1;
+    }
+}
+
+static void damage_row(gint y)
+{
+  gint x;
+
+  for (x = 0; x < TILES_X; x++)
+    dirty[y * TILES_X + x] = TRUE;
+}
+
+/* Returns how many of the tiles of row @y were uploaded in @in. */
+static gint row_uploaded(gint y, gint in)
+{
+  gint x, n;
+
+  for (x = n = 0; x < TILES_X; x++)
+    n += uploaded_in[y * TILES_X + x] == in;
+  return n;
+}
+
+static void test_runs(void)
+{
+  gint cursor;
+  gboolean stopped;
+
+  /* A budget of less than a row: the first run is done anyway,
+   * but not split. */
+  damage_all();
+  cursor = 0;
+  frame = 0;
+  stopped = tidy_upload_schedule_run(TILES_X, TILES_Y, &cursor,
+                                     TILE_COST, cost, upload, NULL);
+  check(stopped && row_uploaded(0, 0) == TILES_X && row_uploaded(1, 0) == 0,
+        "a run over the budget is uploaded as a whole when it's the first");
+  check(cursor == TILES_X, "the next frame starts at the next row");
+
+  damage_all();
+  cursor = 0;
+  stopped = tidy_upload_schedule_run(TILES_X, TILES_Y, &cursor,
+                                     0, cost, upload, NULL);
+  check(!stopped && row_uploaded(TILES_Y-1, 0) == TILES_X,
+        "no budget uploads everything");
+
+  damage_all();
+  cursor = TILES_X * TILES_Y + 5;
+  stopped = tidy_upload_schedule_run(TILES_X, TILES_Y, &cursor,
+                                     TILES_X * TILE_COST, cost, upload, NULL);
+  check(row_uploaded(0, 0) == TILES_X,
+        "a cursor past the end starts from the top");
+}
+
+/* Everything is damaged once, then the top row on every frame.  Returns
+ * the frame the bottom row was uploaded in, or -1.  If @restart every
+ * frame starts at the top, like it used to. */
+static gint bottom_reached(gboolean restart)
+{
+  gint cursor;
+
+  damage_all();
+  cursor = 0;
+  for (frame = 0; frame < TILES_Y * 4; frame++)
+    {
+      if (restart)
+        cursor = 0;
+      /* Room for a row a frame. */
+      tidy_upload_schedule_run(TILES_X, TILES_Y, &cursor,
+                               TILES_X * TILE_COST, cost, upload, NULL);
+      if (row_uploaded(TILES_Y-1, frame) == TILES_X)
+        return frame;
+      damage_row(0);
+    }
+  return -1;
+}
+
+static void test_top_damaged(void)
+{
+  gint with, without;
+
+  without = bottom_reached(TRUE);
+  with = bottom_reached(FALSE);
+  g_print("      top row damaged every frame: bottom row uploaded in "
+          "frame %d\n", with);
+  check(with >= 0 && with < TILES_Y, "the bottom row is reached");
+  check(without < 0, "which it wasn't when starting at the top");
+}
+
+int main(int argc, char **argv)
+{
+  test_runs();
+  test_top_damaged();
+
+  return check_summary();
+}